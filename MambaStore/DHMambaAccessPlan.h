@@ -0,0 +1,95 @@
+//
+//  DHMambaAccessPlan.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+typedef NS_ENUM(uint8_t, DHMambaAccessType) {
+    DHMambaAccessTypeObject = 0,
+    DHMambaAccessTypeChar,
+    DHMambaAccessTypeShort,
+    DHMambaAccessTypeInt,
+    DHMambaAccessTypeLong,
+    DHMambaAccessTypeLongLong,
+    DHMambaAccessTypeUnsignedChar,
+    DHMambaAccessTypeUnsignedShort,
+    DHMambaAccessTypeUnsignedInt,
+    DHMambaAccessTypeUnsignedLong,
+    DHMambaAccessTypeUnsignedLongLong,
+    DHMambaAccessTypeBool,
+    DHMambaAccessTypeFloat,
+    DHMambaAccessTypeDouble,
+    DHMambaAccessTypeKeyValue
+};
+
+/** How to read and write one property. Scalars with a setter go through
+ * getterIMP and setterIMP, so custom accessors run the same way in both
+ * directions. Readonly scalars are read and written at the ivar offset. Objects go through the getter and setter
+ * so memory management (strong, copy, weak) is done by the class. Anything
+ * else, and objects without a setter, use key value coding. The cached IMPs
+ * are the class's own, so DHMambaCoder uses key value coding for objects that
+ * are being observed.
+ */
+typedef struct {
+    __unsafe_unretained NSString *name;
+    const char *utf8Name;
+    NSUInteger utf8Length;
+    DHMambaAccessType type;
+    ptrdiff_t offset;
+    SEL getter;
+    IMP getterIMP;
+    SEL setter;
+    IMP setterIMP;
+} DHMambaAccessField;
+
+/** The properties of a class that are stored automatically, and how to
+ * get at each of them without going through key value coding. Plans are
+ * built once per class and cached.
+ */
+@interface DHMambaAccessPlan : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) Class objectClass;
+@property (nonatomic,readonly) NSArray *propertyNames;
+@property (nonatomic,readonly) NSUInteger fieldCount;
+@property (nonatomic,readonly) const DHMambaAccessField *fields;
+
+#pragma mark - Public Methods
+
+/** Returns the cached plan for a class, creating it the first time.
+ * @param objectClass The class to build the plan for
+ * @return The plan
+ */
++ (instancetype)planForClass:(Class)objectClass;
+
+/** Finds the field for a property name.
+ * @param name The property name as UTF8 bytes
+ * @param length The number of bytes in the name
+ * @param hint The field to check first
+ * @return The index of the field, or NSNotFound
+ */
+- (NSUInteger)indexOfFieldNamed:(const void *)name length:(NSUInteger)length hint:(NSUInteger)hint;
+
+@end
@@ -0,0 +1,205 @@
+//
+//  DHMambaAccessPlan.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaAccessPlan.h"
+#import <objc/runtime.h>
+
+static NSMutableDictionary *staticPlans;
+
+@implementation DHMambaAccessPlan
+
+#pragma mark - Initialization
+- (id)initWithClass:(Class)objectClass {
+    
+    if ( self = [super init] ) {
+        
+        _objectClass = objectClass;
+        
+        // Loop through our superclasses until we hit NSObject, keeping the
+        // properties that have a KVC compliant backing ivar.
+        NSMutableArray *names = [[NSMutableArray alloc] init];
+        NSMutableData *fields = [[NSMutableData alloc] init];
+        Class subclass = objectClass;
+        while ( subclass && subclass != [NSObject class] ) {
+            
+            unsigned int propertyCount;
+            objc_property_t *properties = class_copyPropertyList(subclass, &propertyCount);
+            for ( unsigned int i = 0; i < propertyCount; i++ ) {
+                
+                DHMambaAccessField field;
+                if ( [self describeProperty:properties[i] ofClass:subclass field:&field] ) {
+                    [names addObject:field.name];
+                    [fields appendBytes:&field length:sizeof(field)];
+                }
+            }
+            free(properties);
+            subclass = [subclass superclass];
+        }
+        
+        _propertyNames = names;
+        _fieldCount = names.count;
+        _fields = calloc(MAX(_fieldCount, 1), sizeof(DHMambaAccessField));
+        memcpy((void *)_fields, fields.bytes, fields.length);
+        
+        // The names array keeps the strings alive for the fields
+        for ( NSUInteger index = 0; index < _fieldCount; index++ ) {
+            ((DHMambaAccessField *)_fields)[index].name = names[index];
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    
+    for ( NSUInteger index = 0; index < _fieldCount; index++ ) {
+        free((void *)_fields[index].utf8Name);
+    }
+    free((void *)_fields);
+}
+
+#pragma mark - Public Methods
++ (instancetype)planForClass:(Class)objectClass {
+    
+    NSString *className = NSStringFromClass(objectClass);
+    @synchronized(self) {
+        
+        if ( !staticPlans ) {
+            staticPlans = [[NSMutableDictionary alloc] init];
+        }
+        
+        DHMambaAccessPlan *plan = staticPlans[className];
+        if ( !plan ) {
+            plan = [[DHMambaAccessPlan alloc] initWithClass:objectClass];
+            staticPlans[className] = plan;
+        }
+        return plan;
+    }
+}
+
+- (NSUInteger)indexOfFieldNamed:(const void *)name length:(NSUInteger)length hint:(NSUInteger)hint {
+    
+    for ( NSUInteger checked = 0; checked < _fieldCount; checked++ ) {
+        
+        NSUInteger index = (hint + checked) % _fieldCount;
+        if ( _fields[index].utf8Length == length && memcmp(_fields[index].utf8Name, name, length) == 0 ) {
+            return index;
+        }
+    }
+    return NSNotFound;
+}
+
+#pragma mark - Private Methods
+- (BOOL)describeProperty:(objc_property_t)property ofClass:(Class)subclass field:(DHMambaAccessField *)field {
+    
+    NSString *key = @(property_getName(property));
+    
+    // Check if there is a backing ivar with a KVC compliant name
+    char *ivarName = property_copyAttributeValue(property, "V");
+    if ( !ivarName ) {
+        return NO;
+    }
+    NSString *ivarKey = @(ivarName);
+    Ivar ivar = class_getInstanceVariable(subclass, ivarName);
+    free(ivarName);
+    if ( !ivar || !([ivarKey isEqualToString:key] || [ivarKey isEqualToString:[@"_" stringByAppendingString:key]]) ) {
+        return NO;
+    }
+    
+    memset(field, 0, sizeof(DHMambaAccessField));
+    field->name = key;
+    field->utf8Length = strlen(property_getName(property));
+    field->utf8Name = strdup(property_getName(property));
+    field->offset = ivar_getOffset(ivar);
+    field->type = [DHMambaAccessPlan accessTypeForEncoding:ivar_getTypeEncoding(ivar)];
+    
+    // Object accessors, honoring custom getter and setter names
+    char *getterName = property_copyAttributeValue(property, "G");
+    field->getter = getterName ? sel_registerName(getterName) : NSSelectorFromString(key);
+    free(getterName);
+    
+    char *readonly = property_copyAttributeValue(property, "R");
+    if ( readonly ) {
+        free(readonly);
+    }
+    else {
+        char *setterName = property_copyAttributeValue(property, "S");
+        if ( setterName ) {
+            field->setter = sel_registerName(setterName);
+            free(setterName);
+        }
+        else {
+            NSString *capitalized = [[[key substringToIndex:1] uppercaseString] stringByAppendingString:[key substringFromIndex:1]];
+            field->setter = NSSelectorFromString([NSString stringWithFormat:@"set%@:",capitalized]);
+        }
+    }
+    
+    if ( field->type == DHMambaAccessTypeObject ) {
+        
+        if ( ![_objectClass instancesRespondToSelector:field->getter] || !field->setter || ![_objectClass instancesRespondToSelector:field->setter] ) {
+            field->type = DHMambaAccessTypeKeyValue;
+        }
+        else {
+            field->getterIMP = class_getMethodImplementation(_objectClass, field->getter);
+            field->setterIMP = class_getMethodImplementation(_objectClass, field->setter);
+        }
+    }
+    else if ( field->type != DHMambaAccessTypeKeyValue && field->setter && [_objectClass instancesRespondToSelector:field->setter] ) {
+        
+        // Scalars go through the accessors too, in case the class has its own.
+        // Reading through the getter keeps saving symmetric with loading.
+        field->setterIMP = class_getMethodImplementation(_objectClass, field->setter);
+        if ( [_objectClass instancesRespondToSelector:field->getter] ) {
+            field->getterIMP = class_getMethodImplementation(_objectClass, field->getter);
+        }
+    }
+    return YES;
+}
+
++ (DHMambaAccessType)accessTypeForEncoding:(const char *)encoding {
+    
+    if ( !encoding || strlen(encoding) == 0 ) {
+        return DHMambaAccessTypeKeyValue;
+    }
+    switch ( encoding[0] ) {
+        case '@': return strcmp(encoding, "@?") == 0 ? DHMambaAccessTypeKeyValue : DHMambaAccessTypeObject;
+        case 'c': return DHMambaAccessTypeChar;
+        case 's': return DHMambaAccessTypeShort;
+        case 'i': return DHMambaAccessTypeInt;
+        case 'l': return DHMambaAccessTypeLong;
+        case 'q': return DHMambaAccessTypeLongLong;
+        case 'C': return DHMambaAccessTypeUnsignedChar;
+        case 'S': return DHMambaAccessTypeUnsignedShort;
+        case 'I': return DHMambaAccessTypeUnsignedInt;
+        case 'L': return DHMambaAccessTypeUnsignedLong;
+        case 'Q': return DHMambaAccessTypeUnsignedLongLong;
+        case 'B': return DHMambaAccessTypeBool;
+        case 'f': return DHMambaAccessTypeFloat;
+        case 'd': return DHMambaAccessTypeDouble;
+        default: return DHMambaAccessTypeKeyValue;
+    }
+}
+
+@end
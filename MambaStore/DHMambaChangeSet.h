@@ -0,0 +1,79 @@
+//
+//  DHMambaChangeSet.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** The changes made to one class of objects since the last change set was
+ * posted. Changes to the same object are merged, so an object inserted and
+ * then updated is only listed as inserted, and an object inserted and then
+ * deleted isn't listed at all.
+ */
+@interface DHMambaChangeSet : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) Class objectClass;
+@property (nonatomic,readonly) NSSet *insertedIDs;
+@property (nonatomic,readonly) NSSet *updatedIDs;
+@property (nonatomic,readonly) NSSet *deletedIDs;
+
+/** YES if all the objects of the class were deleted. The objects deleted
+ * that way aren't listed in deletedIDs, and the other sets only list changes
+ * made afterwards.
+ */
+@property (nonatomic,readonly) BOOL emptied;
+
+#pragma mark - Public Methods
+
+/** Creates an empty change set.
+ * @param objectClass The class of the changed objects
+ * @return The change set
+ */
+- (id)initWithClass:(Class)objectClass;
+
+/** Records inserted objects.
+ * @param objIDs The IDs of the objects
+ */
+- (void)addInsertedIDs:(NSArray *)objIDs;
+
+/** Records updated objects.
+ * @param objIDs The IDs of the objects
+ */
+- (void)addUpdatedIDs:(NSArray *)objIDs;
+
+/** Records deleted objects.
+ * @param objIDs The IDs of the objects
+ */
+- (void)addDeletedIDs:(NSArray *)objIDs;
+
+/** Records that every object of the class was deleted. */
+- (void)addEmptied;
+
+/** Checks if there is anything to tell observers about.
+ * @return YES if nothing changed
+ */
+- (BOOL)isEmpty;
+
+@end
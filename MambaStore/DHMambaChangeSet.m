@@ -0,0 +1,117 @@
+//
+//  DHMambaChangeSet.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaChangeSet.h"
+
+@interface DHMambaChangeSet()
+
+@property (nonatomic,strong) NSMutableSet *inserted;
+@property (nonatomic,strong) NSMutableSet *updated;
+@property (nonatomic,strong) NSMutableSet *deleted;
+
+@end
+
+@implementation DHMambaChangeSet
+
+#pragma mark - Initialization
+- (id)initWithClass:(Class)objectClass {
+    
+    if ( self = [super init] ) {
+        _objectClass = objectClass;
+        _inserted = [[NSMutableSet alloc] init];
+        _updated = [[NSMutableSet alloc] init];
+        _deleted = [[NSMutableSet alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - Properties
+- (NSSet *)insertedIDs {
+    return self.inserted;
+}
+
+- (NSSet *)updatedIDs {
+    return self.updated;
+}
+
+- (NSSet *)deletedIDs {
+    return self.deleted;
+}
+
+#pragma mark - Public Methods
+- (void)addInsertedIDs:(NSArray *)objIDs {
+    
+    for ( NSString *objID in objIDs ) {
+        
+        // Deleted and stored again is a change to an object observers know about
+        if ( [self.deleted containsObject:objID] ) {
+            [self.deleted removeObject:objID];
+            [self.updated addObject:objID];
+        }
+        else {
+            [self.inserted addObject:objID];
+        }
+    }
+}
+
+- (void)addUpdatedIDs:(NSArray *)objIDs {
+    
+    for ( NSString *objID in objIDs ) {
+        if ( ![self.inserted containsObject:objID] ) {
+            [self.updated addObject:objID];
+        }
+    }
+}
+
+- (void)addDeletedIDs:(NSArray *)objIDs {
+    
+    for ( NSString *objID in objIDs ) {
+        
+        // Observers never heard about an object inserted since the last change set
+        if ( [self.inserted containsObject:objID] ) {
+            [self.inserted removeObject:objID];
+        }
+        else {
+            [self.updated removeObject:objID];
+            [self.deleted addObject:objID];
+        }
+    }
+}
+
+- (void)addEmptied {
+    
+    _emptied = YES;
+    [self.inserted removeAllObjects];
+    [self.updated removeAllObjects];
+    [self.deleted removeAllObjects];
+}
+
+- (BOOL)isEmpty {
+    
+    return !self.emptied && self.inserted.count == 0 && self.updated.count == 0 && self.deleted.count == 0;
+}
+
+@end
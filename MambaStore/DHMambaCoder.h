@@ -0,0 +1,86 @@
+//
+//  DHMambaCoder.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Compact binary encoding for objects that don't implement NSCoding. The
+ * data starts with a marker byte and a version byte, followed by each
+ * property as its name, a type tag and the value. Numbers, strings, dates
+ * and data are written directly; anything else falls back to a keyed
+ * archive of just that value. Properties are read and written through the
+ * class's DHMambaAccessPlan, so scalars are never boxed.
+ */
+@interface DHMambaCoder : NSObject
+
+/** Encodes the properties of an object, as listed by its DHMambaAccessPlan.
+ * @param object The object to encode
+ * @param ignoreList Names of properties to leave out (NSString), or nil
+ * @return The encoded data
+ */
++ (NSData *)encodeObject:(id)object ignoring:(NSArray *)ignoreList;
+
+/** Encodes an object like encodeObject:ignoring:, and also fills in a digest
+ * of each encoded property so later saves can tell which ones changed.
+ * @param object The object to encode
+ * @param ignoreList Names of properties to leave out (NSString), or nil
+ * @param digests Filled with one uint64_t per field of the DHMambaAccessPlan,
+ * 0 for ignored properties
+ * @return The encoded data
+ */
++ (NSData *)encodeObject:(id)object ignoring:(NSArray *)ignoreList fieldDigests:(NSMutableData *)digests;
+
+/** Checks if data was written by this coder. Anything else is assumed to
+ * be a keyed archive from an older version of the store.
+ * @param data The stored data
+ * @return YES if decodeData:intoObject:properties: can read it
+ */
++ (BOOL)canDecodeData:(NSData *)data;
+
+/** Decodes data into an object. Values for properties the class no longer
+ * has are skipped.
+ * @param data The encoded data
+ * @param object The object to set the property values on
+ * @return NO if the data could not be read
+ */
++ (BOOL)decodeData:(NSData *)data intoObject:(id)object;
+
+/** Decodes data into an object like decodeData:intoObject:, and also fills in
+ * the same digests encodeObject:ignoring:fieldDigests: would for the values read.
+ * @param data The encoded data
+ * @param object The object to set the property values on
+ * @param digests Filled with one uint64_t per field of the DHMambaAccessPlan,
+ * 0 for properties that weren't in the data
+ * @return NO if the data could not be read
+ */
++ (BOOL)decodeData:(NSData *)data intoObject:(id)object fieldDigests:(NSMutableData *)digests;
+
+/** Returns a 64 bit FNV-1a digest of some data.
+ * @param data The data
+ * @return The digest
+ */
++ (uint64_t)digestOfData:(NSData *)data;
+
+@end
@@ -0,0 +1,554 @@
+//
+//  DHMambaCoder.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaCoder.h"
+#import "DHMambaAccessPlan.h"
+#import <objc/runtime.h>
+
+static const uint8_t kDHMambaCoderMarker = 0xDB;
+static const uint8_t kDHMambaCoderVersion = 1;
+
+typedef NS_ENUM(uint8_t, DHMambaCoderType) {
+    DHMambaCoderTypeNil = 0,
+    DHMambaCoderTypeInteger = 1,
+    DHMambaCoderTypeDouble = 2,
+    DHMambaCoderTypeBool = 3,
+    DHMambaCoderTypeString = 4,
+    DHMambaCoderTypeDate = 5,
+    DHMambaCoderTypeData = 6,
+    DHMambaCoderTypeArchive = 7
+};
+
+typedef struct {
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger offset;
+    BOOL failed;
+} DHMambaCoderReader;
+
+// A decoded number, kept unboxed until we know where it is going
+typedef struct {
+    DHMambaCoderType type;
+    int64_t integer;
+    double real;
+} DHMambaCoderNumber;
+
+#pragma mark - Digests
+static uint64_t DHMambaCoderDigest(const uint8_t *bytes, NSUInteger length) {
+    
+    uint64_t digest = 14695981039346656037ULL;
+    for ( NSUInteger index = 0; index < length; index++ ) {
+        digest ^= bytes[index];
+        digest *= 1099511628211ULL;
+    }
+    return digest;
+}
+
+#pragma mark - Writing
+static void DHMambaCoderWriteVarint(NSMutableData *data, uint64_t value) {
+    
+    uint8_t buffer[10];
+    NSUInteger length = 0;
+    do {
+        uint8_t byte = value & 0x7f;
+        value >>= 7;
+        if ( value ) {
+            byte |= 0x80;
+        }
+        buffer[length++] = byte;
+    } while ( value );
+    [data appendBytes:buffer length:length];
+}
+
+static void DHMambaCoderWriteDouble(NSMutableData *data, double value) {
+    
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bits = CFSwapInt64HostToLittle(bits);
+    [data appendBytes:&bits length:sizeof(bits)];
+}
+
+static void DHMambaCoderWriteBytes(NSMutableData *data, const void *bytes, NSUInteger length) {
+    
+    DHMambaCoderWriteVarint(data, length);
+    [data appendBytes:bytes length:length];
+}
+
+static void DHMambaCoderWriteString(NSMutableData *data, NSString *string) {
+    
+    DHMambaCoderWriteBytes(data, [string UTF8String], [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+}
+
+static void DHMambaCoderWriteInteger(NSMutableData *data, int64_t number) {
+    
+    // Zigzag encoded so small negative values stay small
+    uint8_t type = DHMambaCoderTypeInteger;
+    [data appendBytes:&type length:1];
+    DHMambaCoderWriteVarint(data, ((uint64_t)number << 1) ^ (uint64_t)(number >> 63));
+}
+
+static void DHMambaCoderWriteReal(NSMutableData *data, double number) {
+    
+    uint8_t type = DHMambaCoderTypeDouble;
+    [data appendBytes:&type length:1];
+    DHMambaCoderWriteDouble(data, number);
+}
+
+static void DHMambaCoderWriteBool(NSMutableData *data, BOOL flag) {
+    
+    uint8_t bytes[2] = { DHMambaCoderTypeBool, flag ? 1 : 0 };
+    [data appendBytes:bytes length:sizeof(bytes)];
+}
+
+static void DHMambaCoderWriteUnsigned(NSMutableData *data, unsigned long long number) {
+    
+    // Too big for a signed 64 bit integer, so keep what we can as a double
+    if ( number > LLONG_MAX ) {
+        DHMambaCoderWriteReal(data, (double)number);
+    }
+    else {
+        DHMambaCoderWriteInteger(data, (int64_t)number);
+    }
+}
+
+static void DHMambaCoderWriteValue(NSMutableData *data, id value) {
+    
+    uint8_t type;
+    if ( !value || value == [NSNull null] ) {
+        type = DHMambaCoderTypeNil;
+        [data appendBytes:&type length:1];
+    }
+    else if ( [value isKindOfClass:[NSString class]] ) {
+        type = DHMambaCoderTypeString;
+        [data appendBytes:&type length:1];
+        DHMambaCoderWriteString(data, value);
+    }
+    else if ( value == (id)kCFBooleanTrue || value == (id)kCFBooleanFalse ) {
+        DHMambaCoderWriteBool(data, [value boolValue]);
+    }
+    else if ( [value isKindOfClass:[NSNumber class]] ) {
+        
+        // Floats, doubles and decimals are written as doubles
+        char objCType = *[value objCType];
+        if ( objCType == 'Q' ) {
+            DHMambaCoderWriteUnsigned(data, [value unsignedLongLongValue]);
+        }
+        else if ( strchr("cislqCISLB", objCType) ) {
+            DHMambaCoderWriteInteger(data, [value longLongValue]);
+        }
+        else {
+            DHMambaCoderWriteReal(data, [value doubleValue]);
+        }
+    }
+    else if ( [value isKindOfClass:[NSDate class]] ) {
+        type = DHMambaCoderTypeDate;
+        [data appendBytes:&type length:1];
+        DHMambaCoderWriteDouble(data, [value timeIntervalSinceReferenceDate]);
+    }
+    else if ( [value isKindOfClass:[NSData class]] ) {
+        type = DHMambaCoderTypeData;
+        [data appendBytes:&type length:1];
+        DHMambaCoderWriteBytes(data, [value bytes], [value length]);
+    }
+    else {
+        NSData *archive = [NSKeyedArchiver archivedDataWithRootObject:value];
+        type = DHMambaCoderTypeArchive;
+        [data appendBytes:&type length:1];
+        DHMambaCoderWriteBytes(data, [archive bytes], [archive length]);
+    }
+}
+
+// Scalars loaded through their setter are saved through their getter, and
+// the rest are read straight from the ivar
+#define DHMambaCoderLoad(type) \
+    (field->getterIMP ? ((type (*)(id, SEL))field->getterIMP)(object, field->getter) : *(const type *)ivar)
+
+static void DHMambaCoderWriteField(NSMutableData *data, id object, const DHMambaAccessField *field) {
+    
+    const uint8_t *ivar = (const uint8_t *)(__bridge void *)object + field->offset;
+    switch ( field->type ) {
+        case DHMambaAccessTypeObject:
+            DHMambaCoderWriteValue(data, ((id (*)(id, SEL))field->getterIMP)(object, field->getter));
+            break;
+        case DHMambaAccessTypeChar:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(char));
+            break;
+        case DHMambaAccessTypeShort:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(short));
+            break;
+        case DHMambaAccessTypeInt:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(int));
+            break;
+        case DHMambaAccessTypeLong:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(long));
+            break;
+        case DHMambaAccessTypeLongLong:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(long long));
+            break;
+        case DHMambaAccessTypeUnsignedChar:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(unsigned char));
+            break;
+        case DHMambaAccessTypeUnsignedShort:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(unsigned short));
+            break;
+        case DHMambaAccessTypeUnsignedInt:
+            DHMambaCoderWriteInteger(data, DHMambaCoderLoad(unsigned int));
+            break;
+        case DHMambaAccessTypeUnsignedLong:
+            DHMambaCoderWriteUnsigned(data, DHMambaCoderLoad(unsigned long));
+            break;
+        case DHMambaAccessTypeUnsignedLongLong:
+            DHMambaCoderWriteUnsigned(data, DHMambaCoderLoad(unsigned long long));
+            break;
+        case DHMambaAccessTypeBool:
+            DHMambaCoderWriteBool(data, DHMambaCoderLoad(bool));
+            break;
+        case DHMambaAccessTypeFloat:
+            DHMambaCoderWriteReal(data, DHMambaCoderLoad(float));
+            break;
+        case DHMambaAccessTypeDouble:
+            DHMambaCoderWriteReal(data, DHMambaCoderLoad(double));
+            break;
+        case DHMambaAccessTypeKeyValue:
+            DHMambaCoderWriteValue(data, [object valueForKey:field->name]);
+            break;
+    }
+}
+
+#undef DHMambaCoderLoad
+
+#pragma mark - Reading
+static uint8_t DHMambaCoderReadByte(DHMambaCoderReader *reader) {
+    
+    if ( reader->offset >= reader->length ) {
+        reader->failed = YES;
+        return 0;
+    }
+    return reader->bytes[reader->offset++];
+}
+
+static uint64_t DHMambaCoderReadVarint(DHMambaCoderReader *reader) {
+    
+    uint64_t value = 0;
+    for ( NSUInteger shift = 0; shift < 64; shift += 7 ) {
+        uint8_t byte = DHMambaCoderReadByte(reader);
+        if ( reader->failed ) {
+            return 0;
+        }
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if ( !(byte & 0x80) ) {
+            return value;
+        }
+    }
+    reader->failed = YES;
+    return 0;
+}
+
+static double DHMambaCoderReadDouble(DHMambaCoderReader *reader) {
+    
+    if ( reader->length - reader->offset < sizeof(uint64_t) ) {
+        reader->failed = YES;
+        return 0;
+    }
+    uint64_t bits;
+    memcpy(&bits, reader->bytes + reader->offset, sizeof(bits));
+    reader->offset += sizeof(bits);
+    bits = CFSwapInt64LittleToHost(bits);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static const uint8_t *DHMambaCoderReadBytes(DHMambaCoderReader *reader, NSUInteger *length) {
+    
+    uint64_t byteCount = DHMambaCoderReadVarint(reader);
+    if ( reader->failed || byteCount > reader->length - reader->offset ) {
+        reader->failed = YES;
+        return NULL;
+    }
+    const uint8_t *bytes = reader->bytes + reader->offset;
+    reader->offset += byteCount;
+    *length = (NSUInteger)byteCount;
+    return bytes;
+}
+
+static id DHMambaCoderReadValue(DHMambaCoderReader *reader, DHMambaCoderNumber *number) {
+    
+    NSUInteger length = 0;
+    const uint8_t *bytes = NULL;
+    number->type = DHMambaCoderReadByte(reader);
+    switch ( number->type ) {
+            
+        case DHMambaCoderTypeNil:
+            return nil;
+            
+        case DHMambaCoderTypeInteger: {
+            uint64_t zigzag = DHMambaCoderReadVarint(reader);
+            number->integer = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            number->real = (double)number->integer;
+            return nil;
+        }
+            
+        case DHMambaCoderTypeDouble:
+            number->real = DHMambaCoderReadDouble(reader);
+            number->integer = (int64_t)number->real;
+            return nil;
+            
+        case DHMambaCoderTypeBool:
+            number->integer = DHMambaCoderReadByte(reader) != 0;
+            number->real = (double)number->integer;
+            return nil;
+            
+        case DHMambaCoderTypeString:
+            bytes = DHMambaCoderReadBytes(reader, &length);
+            return bytes ? [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding] : nil;
+            
+        case DHMambaCoderTypeDate:
+            return [NSDate dateWithTimeIntervalSinceReferenceDate:DHMambaCoderReadDouble(reader)];
+            
+        case DHMambaCoderTypeData:
+            bytes = DHMambaCoderReadBytes(reader, &length);
+            return bytes ? [NSData dataWithBytes:bytes length:length] : nil;
+            
+        case DHMambaCoderTypeArchive:
+            bytes = DHMambaCoderReadBytes(reader, &length);
+            return bytes ? [NSKeyedUnarchiver unarchiveObjectWithData:[NSData dataWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO]] : nil;
+            
+        default:
+            reader->failed = YES;
+            return nil;
+    }
+}
+
+static BOOL DHMambaCoderIsNumber(const DHMambaCoderNumber *number) {
+    
+    return number->type == DHMambaCoderTypeInteger || number->type == DHMambaCoderTypeDouble || number->type == DHMambaCoderTypeBool;
+}
+
+static id DHMambaCoderBoxNumber(const DHMambaCoderNumber *number) {
+    
+    switch ( number->type ) {
+        case DHMambaCoderTypeInteger:
+            return [NSNumber numberWithLongLong:number->integer];
+        case DHMambaCoderTypeDouble:
+            return [NSNumber numberWithDouble:number->real];
+        case DHMambaCoderTypeBool:
+            return [NSNumber numberWithBool:number->integer != 0];
+        default:
+            return nil;
+    }
+}
+
+// Scalars with a setter go through it, so custom setters run. Readonly
+// scalars are written straight to the ivar.
+#define DHMambaCoderStore(type, value) \
+    if ( field->setterIMP ) { \
+        ((void (*)(id, SEL, type))field->setterIMP)(object, field->setter, (type)(value)); \
+    } \
+    else { \
+        *(type *)ivar = (type)(value); \
+    } \
+    return YES
+
+static BOOL DHMambaCoderStoreScalar(id object, const DHMambaAccessField *field, const DHMambaCoderNumber *number) {
+    
+    uint8_t *ivar = (uint8_t *)(__bridge void *)object + field->offset;
+    int64_t integer = number->integer;
+    switch ( field->type ) {
+        case DHMambaAccessTypeChar:
+            DHMambaCoderStore(char, integer);
+        case DHMambaAccessTypeShort:
+            DHMambaCoderStore(short, integer);
+        case DHMambaAccessTypeInt:
+            DHMambaCoderStore(int, integer);
+        case DHMambaAccessTypeLong:
+            DHMambaCoderStore(long, integer);
+        case DHMambaAccessTypeLongLong:
+            DHMambaCoderStore(long long, integer);
+        case DHMambaAccessTypeUnsignedChar:
+            DHMambaCoderStore(unsigned char, integer);
+        case DHMambaAccessTypeUnsignedShort:
+            DHMambaCoderStore(unsigned short, integer);
+        case DHMambaAccessTypeUnsignedInt:
+            DHMambaCoderStore(unsigned int, integer);
+        case DHMambaAccessTypeUnsignedLong:
+            DHMambaCoderStore(unsigned long, number->type == DHMambaCoderTypeDouble ? (unsigned long)number->real : (unsigned long)integer);
+        case DHMambaAccessTypeUnsignedLongLong:
+            DHMambaCoderStore(unsigned long long, number->type == DHMambaCoderTypeDouble ? (unsigned long long)number->real : (unsigned long long)integer);
+        case DHMambaAccessTypeBool:
+            DHMambaCoderStore(bool, integer != 0);
+        case DHMambaAccessTypeFloat:
+            DHMambaCoderStore(float, number->real);
+        case DHMambaAccessTypeDouble:
+            DHMambaCoderStore(double, number->real);
+        default:
+            return NO;
+    }
+}
+
+#undef DHMambaCoderStore
+
+static void DHMambaCoderSetField(id object, const DHMambaAccessField *field, id value, const DHMambaCoderNumber *number, BOOL observed) {
+    
+    if ( DHMambaCoderIsNumber(number) ) {
+        if ( !observed && DHMambaCoderStoreScalar(object, field, number) ) {
+            return;
+        }
+        value = DHMambaCoderBoxNumber(number);
+    }
+    
+    // Decoded objects start out empty, so there is nothing to do for nil
+    if ( !value ) {
+        return;
+    }
+    if ( field->type == DHMambaAccessTypeObject && !observed ) {
+        ((void (*)(id, SEL, id))field->setterIMP)(object, field->setter, value);
+    }
+    else {
+        [object setValue:value forKey:field->name];
+    }
+}
+
+@implementation DHMambaCoder
+
+#pragma mark - Public Methods
++ (NSData *)encodeObject:(id)object ignoring:(NSArray *)ignoreList {
+    
+    return [DHMambaCoder encodeObject:object ignoring:ignoreList fieldDigests:nil];
+}
+
++ (NSData *)encodeObject:(id)object ignoring:(NSArray *)ignoreList fieldDigests:(NSMutableData *)digests {
+    
+    DHMambaAccessPlan *plan = [DHMambaAccessPlan planForClass:[object class]];
+    const DHMambaAccessField *fields = plan.fields;
+    
+    NSUInteger fieldCount = plan.fieldCount;
+    if ( ignoreList.count > 0 ) {
+        for ( NSUInteger index = 0; index < plan.fieldCount; index++ ) {
+            if ( [ignoreList containsObject:fields[index].name] ) {
+                fieldCount--;
+            }
+        }
+    }
+    
+    NSMutableData *data = [NSMutableData dataWithCapacity:64 + fieldCount * 16];
+    uint8_t header[2] = { kDHMambaCoderMarker, kDHMambaCoderVersion };
+    [data appendBytes:header length:sizeof(header)];
+    DHMambaCoderWriteVarint(data, fieldCount);
+    
+    uint64_t *fieldDigests = NULL;
+    if ( digests ) {
+        [digests setLength:plan.fieldCount * sizeof(uint64_t)];
+        [digests resetBytesInRange:NSMakeRange(0, digests.length)];
+        fieldDigests = [digests mutableBytes];
+    }
+    
+    for ( NSUInteger index = 0; index < plan.fieldCount; index++ ) {
+        
+        if ( ignoreList.count > 0 && [ignoreList containsObject:fields[index].name] ) {
+            continue;
+        }
+        NSUInteger fieldStart = data.length;
+        DHMambaCoderWriteBytes(data, fields[index].utf8Name, fields[index].utf8Length);
+        DHMambaCoderWriteField(data, object, &fields[index]);
+        if ( fieldDigests ) {
+            fieldDigests[index] = DHMambaCoderDigest((const uint8_t *)[data bytes] + fieldStart, data.length - fieldStart);
+        }
+    }
+    return data;
+}
+
++ (BOOL)canDecodeData:(NSData *)data {
+    
+    if ( [data length] < 2 ) {
+        return NO;
+    }
+    const uint8_t *bytes = [data bytes];
+    return bytes[0] == kDHMambaCoderMarker && bytes[1] <= kDHMambaCoderVersion;
+}
+
++ (BOOL)decodeData:(NSData *)data intoObject:(id)object {
+    
+    return [DHMambaCoder decodeData:data intoObject:object fieldDigests:nil];
+}
+
++ (BOOL)decodeData:(NSData *)data intoObject:(id)object fieldDigests:(NSMutableData *)digests {
+    
+    if ( ![DHMambaCoder canDecodeData:data] ) {
+        return NO;
+    }
+    
+    DHMambaAccessPlan *plan = [DHMambaAccessPlan planForClass:[object class]];
+    
+    // Key value observing swaps in a subclass with setters that notify, which
+    // the plan's cached setters would skip, so observed objects use KVC.
+    BOOL observed = object_getClass(object) != plan.objectClass;
+    uint64_t *fieldDigests = NULL;
+    if ( digests ) {
+        [digests setLength:plan.fieldCount * sizeof(uint64_t)];
+        [digests resetBytesInRange:NSMakeRange(0, digests.length)];
+        fieldDigests = [digests mutableBytes];
+    }
+    DHMambaCoderReader reader = { [data bytes], [data length], 2, NO };
+    uint64_t fieldCount = DHMambaCoderReadVarint(&reader);
+    NSUInteger nextField = 0;
+    
+    for ( uint64_t field = 0; field < fieldCount && !reader.failed; field++ ) {
+        
+        NSUInteger fieldStart = reader.offset;
+        NSUInteger nameLength = 0;
+        const uint8_t *name = DHMambaCoderReadBytes(&reader, &nameLength);
+        DHMambaCoderNumber number;
+        id value = DHMambaCoderReadValue(&reader, &number);
+        if ( reader.failed ) {
+            break;
+        }
+        
+        // Fields are written in plan order, so the next field is checked
+        // first. Properties that have since been removed are skipped.
+        NSUInteger index = plan.fieldCount > 0 ? [plan indexOfFieldNamed:name length:nameLength hint:nextField] : NSNotFound;
+        if ( index != NSNotFound ) {
+            DHMambaCoderSetField(object, &plan.fields[index], value, &number, observed);
+            nextField = index + 1;
+            if ( fieldDigests ) {
+                fieldDigests[index] = DHMambaCoderDigest(reader.bytes + fieldStart, reader.offset - fieldStart);
+            }
+        }
+    }
+    
+    if ( reader.failed ) {
+        NSLog(@"error decoding %@, data is truncated or corrupt",NSStringFromClass([object class]));
+        return NO;
+    }
+    return YES;
+}
+
++ (uint64_t)digestOfData:(NSData *)data {
+    
+    return DHMambaCoderDigest([data bytes], [data length]);
+}
+
+@end
@@ -0,0 +1,261 @@
+//
+//  DHMambaCollection.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "FMDatabase.h"
+#import "DHMambaCompressor.h"
+
+/** Describes the table used to store a class of objects. The SQL for the
+ * fixed insert, update, delete and lookup statements is built once per
+ * collection so the same string (and the prepared statement FMDB caches
+ * for it) is reused on every call.
+ */
+@interface DHMambaCollection : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) Class objectClass;
+@property (nonatomic,readonly) NSString *name;
+@property (nonatomic,readonly) NSArray *indexedColumns;
+@property (nonatomic,readonly) NSArray *indexedProperties;
+@property (nonatomic,readonly) NSArray *relationships;
+
+/** The built in columns and indexed properties that hold dates, stored as
+ * seconds since 1970.
+ */
+@property (nonatomic,readonly) NSArray *dateColumns;
+
+#pragma mark - Full text search
+@property (nonatomic,readonly) NSArray *fullTextColumns;
+@property (nonatomic,readonly) NSString *fullTextName;
+@property (nonatomic,readonly) BOOL fullTextEnabled;
+
+/** YES if objKey is unique in the collection, see mambaObjectUniqueKey. */
+@property (nonatomic,readonly) BOOL uniqueKey;
+
+/** YES if saves only write what changed, see mambaObjectTracksChanges. */
+@property (nonatomic,readonly) BOOL tracksChanges;
+
+#pragma mark - Compression
+@property (nonatomic,readonly) DHMambaCompression compression;
+@property (nonatomic,readonly) NSData *compressionDictionary;
+
+#pragma mark - Object cache
+@property (nonatomic,readonly) BOOL cacheEnabled;
+@property (nonatomic,readonly) NSUInteger cacheHits;
+@property (nonatomic,readonly) NSUInteger cacheMisses;
+
+#pragma mark - Statements
+@property (nonatomic,readonly) NSString *insertSQL;
+@property (nonatomic,readonly) NSString *updateSQL;
+
+/** Takes the insertSQL arguments and returns the objID and createTime of the
+ * row written, which is the stored row with the same key if there is one.
+ * Needs SQLite 3.35 or later.
+ */
+@property (nonatomic,readonly) NSString *upsertSQL;
+@property (nonatomic,readonly) NSString *selectIDWithKeySQL;
+@property (nonatomic,readonly) NSString *deleteSQL;
+@property (nonatomic,readonly) NSString *selectWithIDSQL;
+@property (nonatomic,readonly) NSString *selectWithKeySQL;
+
+#pragma mark - Public Methods
+
+/** Returns the cached collection for a class, creating it the first time.
+ * @param objectClass The class of objects stored in the collection
+ * @return The collection
+ */
++ (instancetype)collectionForClass:(Class)objectClass;
+
+/** Returns a collection that has already been created by name.
+ * @param name The collection name
+ * @return The collection, or nil if it hasn't been used yet
+ */
++ (instancetype)existingCollectionNamed:(NSString *)name;
+
+/** Returns the table name used for a class.
+ * @param objectClass The class of objects stored in the collection
+ * @return The collection name
+ */
++ (NSString *)collectionNameForClass:(Class)objectClass;
+
+/** Creates the table if needed and brings its indexes in line with
+ * indexedColumns. Indexes this collection manages that are no longer wanted
+ * are dropped, and stores created by older versions are migrated. Columns
+ * for new indexedProperties are added, and listed in unfilledProperties until
+ * they have been filled in from the stored objects.
+ * @param db The database to create the collection in
+ */
+- (void)createSchemaInDatabase:(FMDatabase *)db;
+
+/** The indexed properties whose columns createSchemaInDatabase added, which
+ * are empty for objects saved before they existed, or nil.
+ */
+@property (nonatomic,readonly) NSArray *unfilledProperties;
+
+/** Returns SQL that fills in the unfilledProperties of a row. It takes the
+ * values from fillValuesForBody, then the objID and the updateTime the body
+ * was read with, so rows saved again in the meantime are left alone.
+ * @return The update statement
+ */
+- (NSString *)fillSQL;
+
+/** Decodes a stored body and returns the values of its unfilledProperties.
+ * Only the coder runs, so no load hooks, caches or snapshots see the object.
+ * @param body The objBody column
+ * @return The column values, or nil if the body can't be read
+ */
+- (NSArray *)fillValuesForBody:(NSData *)body;
+
+/** Called once every row has been filled in. */
+- (void)finishFilling;
+
+/** Checks if a column can be used in queries. Only the built in columns and
+ * the indexed properties are stored as columns.
+ * @param column The column name
+ * @return YES if the collection has the column
+ */
+- (BOOL)hasColumn:(NSString *)column;
+
+/** Checks if a search for a value in a column can use the full text index.
+ * The trigram index can only match terms of at least three characters.
+ * @param column The column being searched
+ * @param term The value being searched for
+ * @return YES if the full text index can be used
+ */
+- (BOOL)canSearchFullText:(NSString *)column term:(NSString *)term;
+
+/** Returns a full text query that matches a term anywhere in a column.
+ * @param column The column to search, or nil for all full text columns
+ * @param term The value being searched for
+ * @return The query to pass to match
+ */
+- (NSString *)fullTextQueryForColumn:(NSString *)column term:(NSString *)term;
+
+/** Looks up an object in the cache by objID, counting a hit or a miss.
+ * @param objID The object ID
+ * @return The cached object, or nil
+ */
+- (id)cachedObjectWithID:(NSString *)objID;
+
+/** Looks up an object in the cache by the key it was found with, counting
+ * a hit or a miss. Objects whose key has changed since are not returned.
+ * @param key The object key
+ * @return The cached object, or nil
+ */
+- (id)cachedObjectWithKey:(NSString *)key;
+
+/** Adds an object that was just loaded to the cache. If the cache already
+ * has an instance with the same objID, that instance is kept and returned
+ * so each stored object has a single instance.
+ * @param object The loaded object
+ * @param key The key it was found with, or nil
+ * @return The object to use
+ */
+- (id)cacheLoadedObject:(id)object key:(NSString *)key;
+
+/** Updates the cache after an object has been inserted or updated.
+ * @param object The saved object
+ */
+- (void)cacheSavedObject:(id)object;
+
+/** Removes an object from the cache after it has been deleted.
+ * @param object The deleted object
+ */
+- (void)removeCachedObject:(id)object;
+
+/** Removes every object from the cache. */
+- (void)removeAllCachedObjects;
+
+/** Removes every object from the cache of every collection. Used when the
+ * store is closed.
+ */
++ (void)removeAllCachedObjectsFromCollections;
+
+/** Returns the positional arguments for insertSQL.
+ * @param object The object being inserted
+ * @param now The create and update time to store
+ * @return An array of arguments in column order
+ */
+- (NSArray *)insertArgumentsForObject:(id)object time:(NSDate *)now;
+
+/** Returns the positional arguments for updateSQL.
+ * @param object The object being updated
+ * @param now The update time to store
+ * @return An array of arguments in statement order
+ */
+- (NSArray *)updateArgumentsForObject:(id)object time:(NSDate *)now;
+
+/** Returns the statement and arguments to update an object. If the collection
+ * tracks changes and the object has been loaded or saved before, the
+ * statement only sets updateTime and the columns that changed since. Its
+ * first argument is the update time and the last is the objID.
+ * @param object The object being updated
+ * @param now The update time to store
+ * @param arguments Set to the arguments for the statement
+ * @return updateSQL, a statement for just the changed columns, or nil if
+ * nothing changed
+ */
+- (NSString *)updateSQLForObject:(id)object time:(NSDate *)now arguments:(NSArray **)arguments;
+
+/** Remembers what a loaded object looks like in the store, so saving it can
+ * tell what changed. Does nothing unless the collection tracks changes.
+ * @param object The loaded object
+ * @param results The row it was loaded from
+ * @param body The uncompressed body
+ * @param digests The field digests from decoding the body, or nil
+ */
+- (void)rememberLoadedObject:(id)object results:(FMResultSet *)results body:(NSData *)body fieldDigests:(NSData *)digests;
+
+/** Forgets what an object looks like in the store, so the next save writes
+ * all of it. Used when a write fails.
+ * @param object The object
+ */
+- (void)forgetSnapshotOfObject:(id)object;
+
+/** Returns the properties that changed since an object was loaded or saved.
+ * @param object The object
+ * @return The names of the changed properties, or nil if the collection
+ * doesn't track changes or the object hasn't been stored
+ */
+- (NSSet *)changedPropertiesOfObject:(id)object;
+
+/** Rearranges insertSQL arguments into updateSQL arguments, so an object that
+ * turns out to be stored already can be updated without archiving it again.
+ * @param arguments The insertSQL arguments
+ * @param objID The objID of the row to update
+ * @return An array of arguments in statement order
+ */
+- (NSArray *)updateArgumentsFromInsertArguments:(NSArray *)arguments objID:(NSString *)objID;
+
+/** Rearranges updateSQL arguments into insertSQL arguments, so an object whose
+ * row has gone missing can be inserted again. The update time is also used
+ * as the create time.
+ * @param arguments The updateSQL arguments
+ * @return An array of arguments in column order
+ */
+- (NSArray *)insertArgumentsFromUpdateArguments:(NSArray *)arguments;
+
+@end
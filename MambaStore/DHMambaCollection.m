@@ -0,0 +1,895 @@
+//
+//  DHMambaCollection.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaCollection.h"
+#import "NSObject+DHMambaObject.h"
+#import "DHMambaRelationship.h"
+#import "DHMambaMetrics.h"
+#import "DHMambaCoder.h"
+#import "DHMambaSnapshot.h"
+#import "DHMambaAccessPlan.h"
+#import "DHMambaObjectCache.h"
+#import <objc/runtime.h>
+
+static NSMutableDictionary *staticCollections;
+static char const * const DHMambaCollectionSnapshotKey = "MambaSnapshot";
+
+@interface NSObject (DHMambaObjectLoading)
+- (id)MB_unarchive_withResults:(FMResultSet *)results;
+@end
+
+@interface DHMambaCollection()
+
+// index name -> array of column names
+@property (nonatomic,strong) NSDictionary *indexes;
+
+// indexed property name -> column type
+@property (nonatomic,strong) NSDictionary *propertyTypes;
+
+// objID -> object, and objKey -> object for MB_findWithKey
+@property (nonatomic,strong) DHMambaObjectCache *objectCache;
+@property (nonatomic,strong) DHMambaObjectCache *keyCache;
+
+// The columns a save can write on their own, in snapshot order
+@property (nonatomic,strong) NSArray *trackedColumns;
+
+@end
+
+@implementation DHMambaCollection
+
+#pragma mark - Initialization
+- (id)initWithClass:(Class)objectClass {
+    
+    if ( self = [super init] ) {
+        
+        _objectClass = objectClass;
+        _name = [DHMambaCollection collectionNameForClass:objectClass];
+        
+        // Index every built in column the find methods use unless the class
+        // tells us which ones it actually needs.
+        NSArray *builtInColumns = @[@"objKey",@"objForeignKey",@"objTitle",@"orderNumber",@"createTime",@"updateTime"];
+        NSArray *requestedColumns = builtInColumns;
+        if ( [objectClass respondsToSelector:@selector(mambaObjectIndexedColumns)] ) {
+            requestedColumns = [objectClass performSelector:@selector(mambaObjectIndexedColumns)];
+        }
+        
+        NSMutableArray *indexedColumns = [[NSMutableArray alloc] init];
+        NSMutableDictionary *indexes = [[NSMutableDictionary alloc] init];
+        for ( NSString *column in requestedColumns ) {
+            if ( ![builtInColumns containsObject:column] ) {
+                NSLog(@"Ignoring index on %@ for %@, only built in columns can be indexed",column,_name);
+                continue;
+            }
+            [indexedColumns addObject:column];
+            
+            // objID is included so paging can seek straight to the next row
+            indexes[[NSString stringWithFormat:@"%@_idx_%@",_name,column]] = @[column,@"objID"];
+        }
+        _indexedColumns = indexedColumns;
+        
+        // Properties the class wants to query on get their own typed column,
+        // copied out of the object every time it is saved.
+        NSArray *reservedColumns = @[@"objid",@"objkey",@"objforeignkey",@"objtitle",@"createtime",@"updatetime",@"ordernumber",@"objbody",@"objtextid",@"rowid"];
+        NSMutableArray *indexedProperties = [[NSMutableArray alloc] init];
+        NSMutableDictionary *propertyTypes = [[NSMutableDictionary alloc] init];
+        if ( [objectClass respondsToSelector:@selector(mambaObjectIndexedProperties)] ) {
+            for ( NSString *property in [objectClass performSelector:@selector(mambaObjectIndexedProperties)] ) {
+                
+                if ( [reservedColumns containsObject:[property lowercaseString]] ) {
+                    NSLog(@"Ignoring indexed property %@ for %@, the name is used by a built in column",property,_name);
+                    continue;
+                }
+                NSString *columnType = [DHMambaCollection columnTypeForProperty:property ofClass:objectClass];
+                if ( !columnType ) {
+                    NSLog(@"Ignoring indexed property %@ for %@, only numbers, strings and dates can be indexed",property,_name);
+                    continue;
+                }
+                [indexedProperties addObject:property];
+                propertyTypes[property] = columnType;
+                indexes[[NSString stringWithFormat:@"%@_idx_%@",_name,property]] = @[property];
+            }
+        }
+        _indexedProperties = indexedProperties;
+        _propertyTypes = propertyTypes;
+        
+        NSMutableArray *dateColumns = [NSMutableArray arrayWithObjects:@"createTime",@"updateTime",nil];
+        for ( NSString *property in indexedProperties ) {
+            objc_property_t classProperty = class_getProperty(objectClass, [property UTF8String]);
+            if ( strncmp(property_getAttributes(classProperty), "T@\"NSDate\"", 10) == 0 ) {
+                [dateColumns addObject:property];
+            }
+        }
+        _dateColumns = dateColumns;
+        _indexes = indexes;
+        
+        // Full text search is opt in since it costs extra work on every write
+        NSArray *textColumns = @[@"objKey",@"objTitle",@"objForeignKey"];
+        NSMutableArray *fullTextColumns = [[NSMutableArray alloc] init];
+        if ( [objectClass respondsToSelector:@selector(mambaObjectFullTextColumns)] ) {
+            for ( NSString *column in [objectClass performSelector:@selector(mambaObjectFullTextColumns)] ) {
+                if ( ![textColumns containsObject:column] ) {
+                    NSLog(@"Ignoring full text search on %@ for %@, only objKey, objTitle and objForeignKey can be searched",column,_name);
+                    continue;
+                }
+                [fullTextColumns addObject:column];
+            }
+        }
+        _fullTextColumns = fullTextColumns;
+        _fullTextName = [NSString stringWithFormat:@"%@_fts",_name];
+        
+        // Relationships are checked against the child collection when they
+        // are first used, since a class can be its own child.
+        NSMutableArray *relationships = [[NSMutableArray alloc] init];
+        if ( [objectClass respondsToSelector:@selector(mambaObjectRelationships)] ) {
+            for ( DHMambaRelationship *relationship in [objectClass performSelector:@selector(mambaObjectRelationships)] ) {
+                if ( ![relationship isKindOfClass:[DHMambaRelationship class]] || !relationship.childClass ) {
+                    NSLog(@"Ignoring relationship %@ for %@, it needs a child class",relationship,_name);
+                    continue;
+                }
+                [relationships addObject:relationship];
+            }
+        }
+        _relationships = relationships;
+        
+        // A unique key is only meaningful when the class supplies its own
+        // keys, otherwise the key is the objID and already unique.
+        if ( [objectClass respondsToSelector:@selector(mambaObjectUniqueKey)] && [objectClass mambaObjectUniqueKey] ) {
+            if ( [objectClass instancesRespondToSelector:@selector(mambaObjectKey)] ) {
+                _uniqueKey = YES;
+            }
+            else {
+                NSLog(@"Ignoring unique key for %@, it doesn't implement mambaObjectKey",_name);
+            }
+        }
+        
+        NSMutableString *insertColumns = [NSMutableString stringWithString:@"objID, objKey, objForeignKey, objTitle, createTime, updateTime, orderNumber, objBody"];
+        NSMutableString *insertValues = [NSMutableString stringWithString:@"?, ?, ?, ?, ?, ?, ?, ?"];
+        NSMutableString *updateColumns = [NSMutableString stringWithString:@"objKey = ?, objForeignKey = ?, objTitle = ?, orderNumber = ?, updateTime = ?, objBody = ?"];
+        NSMutableString *upsertColumns = [NSMutableString stringWithString:@"objForeignKey = excluded.objForeignKey, objTitle = excluded.objTitle, orderNumber = excluded.orderNumber, updateTime = excluded.updateTime, objBody = excluded.objBody"];
+        for ( NSString *property in _indexedProperties ) {
+            [insertColumns appendFormat:@", \"%@\"",property];
+            [insertValues appendString:@", ?"];
+            [updateColumns appendFormat:@", \"%@\" = ?",property];
+            [upsertColumns appendFormat:@", \"%@\" = excluded.\"%@\"",property,property];
+        }
+        
+        _insertSQL = [NSString stringWithFormat:@"insert into %@ (%@) VALUES ( %@ )",_name,insertColumns,insertValues];
+        _updateSQL = [NSString stringWithFormat:@"update %@ set %@ where objID = ?",_name,updateColumns];
+        
+        // The stored row keeps its objID and createTime
+        _upsertSQL = [NSString stringWithFormat:@"%@ on conflict(objKey) do update set %@ returning objID, createTime",_insertSQL,upsertColumns];
+        _selectIDWithKeySQL = [NSString stringWithFormat:@"select objID, createTime from %@ where objKey = ? limit 1",_name];
+        if ( [objectClass respondsToSelector:@selector(mambaObjectCompression)] ) {
+            _compression = [objectClass mambaObjectCompression];
+        }
+        if ( _compression == DHMambaCompressionZlib && [objectClass respondsToSelector:@selector(mambaObjectCompressionDictionary)] ) {
+            _compressionDictionary = [[objectClass mambaObjectCompressionDictionary] copy];
+        }
+        
+        // Tracking changes is opt in, since it costs a digest of every
+        // object loaded.
+        if ( [objectClass respondsToSelector:@selector(mambaObjectTracksChanges)] ) {
+            _tracksChanges = [objectClass mambaObjectTracksChanges];
+        }
+        _trackedColumns = [@[@"objKey",@"objForeignKey",@"objTitle",@"orderNumber"] arrayByAddingObjectsFromArray:_indexedProperties];
+        
+        // Caching is opt in, since callers get back the same instance and
+        // see each other's unsaved changes.
+        if ( [objectClass respondsToSelector:@selector(mambaObjectCacheLimit)] ) {
+            NSUInteger cacheLimit = [objectClass mambaObjectCacheLimit];
+            if ( cacheLimit > 0 ) {
+                _cacheEnabled = YES;
+                _objectCache = [[DHMambaObjectCache alloc] initWithCountLimit:cacheLimit];
+                _keyCache = [[DHMambaObjectCache alloc] initWithCountLimit:cacheLimit];
+            }
+        }
+        
+        _deleteSQL = [NSString stringWithFormat:@"delete from %@ where objID = ?",_name];
+        _selectWithIDSQL = [NSString stringWithFormat:@"select * from %@ where objID = ?",_name];
+        _selectWithKeySQL = [NSString stringWithFormat:@"select * from %@ where objKey = ? order by orderNumber",_name];
+    }
+    return self;
+}
+
+#pragma mark - Public Methods
++ (instancetype)collectionForClass:(Class)objectClass {
+    
+    NSString *className = NSStringFromClass(objectClass);
+    @synchronized(self) {
+        
+        if ( !staticCollections ) {
+            staticCollections = [[NSMutableDictionary alloc] init];
+        }
+        
+        DHMambaCollection *collection = staticCollections[className];
+        if ( !collection ) {
+            collection = [[DHMambaCollection alloc] initWithClass:objectClass];
+            staticCollections[className] = collection;
+        }
+        return collection;
+    }
+}
+
++ (instancetype)existingCollectionNamed:(NSString *)name {
+    
+    @synchronized(self) {
+        
+        for ( DHMambaCollection *collection in [staticCollections allValues] ) {
+            if ( [collection.name isEqualToString:name] ) {
+                return collection;
+            }
+        }
+        return nil;
+    }
+}
+
++ (NSString *)collectionNameForClass:(Class)objectClass {
+    
+    return [NSStringFromClass(objectClass) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+}
+
+- (void)createSchemaInDatabase:(FMDatabase *)db {
+    
+    // create a table for this collection
+    NSMutableString *propertyColumns = [[NSMutableString alloc] init];
+    for ( NSString *property in self.indexedProperties ) {
+        [propertyColumns appendFormat:@", \"%@\" %@",property,self.propertyTypes[property]];
+    }
+    NSString *createSQL = [NSString stringWithFormat:@"create table if not exists %@ (objID text primary key not null, objKey text, objForeignKey text, objTitle text, createTime real, updateTime real, orderNumber integer, objBody blob%@)",_name,propertyColumns];
+    if ( ![db executeUpdate:createSQL] ) {
+        NSLog(@"error creating table: %@",[db lastErrorMessage]);
+        return;
+    }
+    
+    // Add columns for any indexed properties the table doesn't have yet
+    NSArray *existingColumns = [self columnsOfTable:_name inDatabase:db];
+    NSMutableArray *addedProperties = [[NSMutableArray alloc] init];
+    for ( NSString *property in self.indexedProperties ) {
+        
+        if ( ![existingColumns containsObject:property] ) {
+            NSString *alterSQL = [NSString stringWithFormat:@"alter table %@ add column \"%@\" %@",_name,property,self.propertyTypes[property]];
+            if ( ![db executeUpdate:alterSQL] ) {
+                NSLog(@"error adding column %@: %@",property,[db lastErrorMessage]);
+                continue;
+            }
+            [addedProperties addObject:property];
+        }
+    }
+    if ( addedProperties.count > 0 ) {
+        _unfilledProperties = addedProperties;
+    }
+    
+    // Tables created by older versions don't have objID as their primary key,
+    // so give them a unique index instead. Once that exists the old _pk index
+    // (which was also on objID) isn't needed.
+    if ( ![self objIDIsPrimaryKeyInDatabase:db] ) {
+        
+        NSString *uniqueIndexSQL = [NSString stringWithFormat:@"create unique index if not exists %@_objID ON %@ (objID)",_name,_name];
+        if ( ![db executeUpdate:uniqueIndexSQL] ) {
+            NSLog(@"error creating objID index: %@",[db lastErrorMessage]);
+        }
+        else if ( ![db executeUpdate:[NSString stringWithFormat:@"drop index if exists %@_pk",_name]] ) {
+            NSLog(@"error dropping old PK index: %@",[db lastErrorMessage]);
+        }
+    }
+    
+    // Drop managed indexes that are no longer wanted or have changed
+    NSDictionary *existingIndexes = [self managedIndexesInDatabase:db];
+    for ( NSString *indexName in existingIndexes ) {
+        
+        if ( ![self.indexes[indexName] isEqualToArray:existingIndexes[indexName]] ) {
+            if ( ![db executeUpdate:[NSString stringWithFormat:@"drop index if exists %@",indexName]] ) {
+                NSLog(@"error dropping index %@: %@",indexName,[db lastErrorMessage]);
+            }
+        }
+    }
+    
+    // and create any that are missing
+    for ( NSString *indexName in self.indexes ) {
+        
+        NSArray *columns = self.indexes[indexName];
+        if ( ![existingIndexes[indexName] isEqualToArray:columns] ) {
+            NSString *indexSQL = [NSString stringWithFormat:@"create index %@ ON %@ (\"%@\")",indexName,_name,[columns componentsJoinedByString:@"\", \""]];
+            if ( ![db executeUpdate:indexSQL] ) {
+                NSLog(@"error creating index %@: %@",indexName,[db lastErrorMessage]);
+            }
+        }
+    }
+    
+    // The upsert needs a unique index on objKey to conflict on. It can't be
+    // created while the collection holds objects with the same key, so those
+    // go back to being saved without one.
+    NSString *uniqueIndexName = [NSString stringWithFormat:@"%@_objKey_unique",_name];
+    if ( self.uniqueKey ) {
+        if ( ![db executeUpdate:[NSString stringWithFormat:@"create unique index if not exists %@ ON %@ (objKey)",uniqueIndexName,_name]] ) {
+            NSLog(@"error creating unique key index, %@ has objects with the same key: %@",_name,[db lastErrorMessage]);
+            _uniqueKey = NO;
+        }
+    }
+    else if ( ![db executeUpdate:[NSString stringWithFormat:@"drop index if exists %@",uniqueIndexName]] ) {
+        NSLog(@"error dropping unique key index: %@",[db lastErrorMessage]);
+    }
+    
+    [self createFullTextIndexInDatabase:db];
+}
+
+- (NSString *)fillSQL {
+    
+    NSMutableArray *setColumns = [[NSMutableArray alloc] init];
+    for ( NSString *property in self.unfilledProperties ) {
+        [setColumns addObject:[NSString stringWithFormat:@"\"%@\" = ?",property]];
+    }
+    return [NSString stringWithFormat:@"update %@ set %@ where objID = ? and updateTime is ?",_name,[setColumns componentsJoinedByString:@", "]];
+}
+
+- (NSArray *)fillValuesForBody:(NSData *)body {
+    
+    if ( [DHMambaCompressor isCompressedData:body] ) {
+        body = [DHMambaCompressor decompressData:body dictionary:self.compressionDictionary];
+    }
+    if ( !body ) {
+        return nil;
+    }
+    
+    id object = nil;
+    if ( [self.objectClass conformsToProtocol:@protocol(NSCoding)] ) {
+        object = [NSKeyedUnarchiver unarchiveObjectWithData:body];
+    }
+    else if ( [DHMambaCoder canDecodeData:body] ) {
+        object = [[self.objectClass alloc] init];
+        [DHMambaCoder decodeData:body intoObject:object];
+    }
+    else {
+        
+        // Rows saved by older versions of the store are keyed archives
+        object = [[self.objectClass alloc] init];
+        NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:body];
+        for ( NSString *property in self.unfilledProperties ) {
+            [object setValue:[unarchiver decodeObjectForKey:property] forKey:property];
+        }
+        [unarchiver finishDecoding];
+    }
+    return object ? [self propertyValuesForObject:object properties:self.unfilledProperties] : nil;
+}
+
+- (void)finishFilling {
+    
+    _unfilledProperties = nil;
+}
+- (BOOL)hasColumn:(NSString *)column {
+    
+    NSArray *builtInColumns = @[@"objID",@"objKey",@"objForeignKey",@"objTitle",@"orderNumber",@"createTime",@"updateTime"];
+    return [builtInColumns containsObject:column] || [self.indexedProperties containsObject:column];
+}
+
+- (BOOL)canSearchFullText:(NSString *)column term:(NSString *)term {
+    
+    return self.fullTextEnabled && [self.fullTextColumns containsObject:column] && term.length >= 3;
+}
+
+- (NSString *)fullTextQueryForColumn:(NSString *)column term:(NSString *)term {
+    
+    // Quote the term so it is matched as a plain string
+    NSString *quotedTerm = [NSString stringWithFormat:@"\"%@\"",[term stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+    if ( column ) {
+        return [NSString stringWithFormat:@"%@ : %@",column,quotedTerm];
+    }
+    return quotedTerm;
+}
+
+- (id)cachedObjectWithID:(NSString *)objID {
+    
+    if ( !self.cacheEnabled || !objID ) {
+        return nil;
+    }
+    @synchronized(self) {
+        return [self countLookup:[self.objectCache objectForKey:objID]];
+    }
+}
+
+- (id)cachedObjectWithKey:(NSString *)key {
+    
+    if ( !self.cacheEnabled || !key ) {
+        return nil;
+    }
+    
+    // The cached instance may have been given a new key since
+    @synchronized(self) {
+        id object = [self.keyCache objectForKey:key];
+        if ( object && ![[object MB_objKey] isEqualToString:key] ) {
+            [self.keyCache removeObjectForKey:key];
+            object = nil;
+        }
+        return [self countLookup:object];
+    }
+}
+
+- (id)cacheLoadedObject:(id)object key:(NSString *)key {
+    
+    if ( !self.cacheEnabled || !object ) {
+        return object;
+    }
+    
+    NSString *objID = [object MB_objID];
+    @synchronized(self) {
+        id existing = [self.objectCache objectForKey:objID];
+        if ( existing ) {
+            object = existing;
+        }
+        else {
+            [self.objectCache setObject:object forKey:objID];
+        }
+        if ( key ) {
+            [self.keyCache setObject:object forKey:key];
+        }
+    }
+    return object;
+}
+
+- (void)cacheSavedObject:(id)object {
+    
+    if ( !self.cacheEnabled ) {
+        return;
+    }
+    
+    // A save can change which object is first for its key
+    NSString *key = [object MB_objKey];
+    @synchronized(self) {
+        [self.objectCache setObject:object forKey:[object MB_objID]];
+        if ( key ) {
+            [self.keyCache removeObjectForKey:key];
+        }
+    }
+}
+
+- (void)removeCachedObject:(id)object {
+    
+    if ( !self.cacheEnabled ) {
+        return;
+    }
+    
+    NSString *key = [object MB_objKey];
+    @synchronized(self) {
+        [self.objectCache removeObjectForKey:[object MB_objID]];
+        if ( key ) {
+            [self.keyCache removeObjectForKey:key];
+        }
+    }
+}
+
+- (void)removeAllCachedObjects {
+    
+    @synchronized(self) {
+        [self.objectCache removeAllObjects];
+        [self.keyCache removeAllObjects];
+    }
+}
+
++ (void)removeAllCachedObjectsFromCollections {
+    
+    @synchronized(self) {
+        
+        for ( DHMambaCollection *collection in [staticCollections allValues] ) {
+            [collection removeAllCachedObjects];
+        }
+    }
+}
+
+- (NSArray *)insertArgumentsForObject:(id)object time:(NSDate *)now {
+    
+    NSNumber *time = [NSNumber numberWithDouble:[now timeIntervalSince1970]];
+    NSArray *columnValues = [self columnValuesForObject:object];
+    DHMambaSnapshot *snapshot = nil;
+    NSData *body = [self bodyForObject:object columnValues:columnValues snapshot:&snapshot];
+    if ( snapshot ) {
+        objc_setAssociatedObject(object, DHMambaCollectionSnapshotKey, snapshot, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    
+    NSMutableArray *arguments = [NSMutableArray arrayWithObjects:
+                                 [object MB_objID],
+                                 columnValues[0],
+                                 columnValues[1],
+                                 columnValues[2],
+                                 time,
+                                 time,
+                                 columnValues[3],
+                                 body,
+                                 nil];
+    [arguments addObjectsFromArray:[columnValues subarrayWithRange:NSMakeRange(4, columnValues.count - 4)]];
+    return arguments;
+}
+
+- (NSArray *)updateArgumentsForObject:(id)object time:(NSDate *)now {
+    
+    NSArray *arguments = nil;
+    [self updateSQLForObject:object time:now changedOnly:NO arguments:&arguments];
+    return arguments;
+}
+
+- (NSString *)updateSQLForObject:(id)object time:(NSDate *)now arguments:(NSArray **)arguments {
+    
+    return [self updateSQLForObject:object time:now changedOnly:self.tracksChanges arguments:arguments];
+}
+
+- (void)rememberLoadedObject:(id)object results:(FMResultSet *)results body:(NSData *)body fieldDigests:(NSData *)digests {
+    
+    if ( !self.tracksChanges || !object ) {
+        return;
+    }
+    
+    NSMutableArray *columnValues = [[NSMutableArray alloc] initWithCapacity:self.trackedColumns.count];
+    for ( NSString *column in self.trackedColumns ) {
+        id value = [results objectForColumnName:column];
+        [columnValues addObject:value ? value : [NSNull null]];
+    }
+    DHMambaSnapshot *snapshot = [[DHMambaSnapshot alloc] initWithColumnValues:columnValues body:body fieldDigests:digests];
+    objc_setAssociatedObject(object, DHMambaCollectionSnapshotKey, snapshot, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+- (void)forgetSnapshotOfObject:(id)object {
+    
+    if ( self.tracksChanges ) {
+        objc_setAssociatedObject(object, DHMambaCollectionSnapshotKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+}
+
+- (NSSet *)changedPropertiesOfObject:(id)object {
+    
+    DHMambaSnapshot *previous = self.tracksChanges ? objc_getAssociatedObject(object, DHMambaCollectionSnapshotKey) : nil;
+    if ( !previous ) {
+        return nil;
+    }
+    
+    DHMambaSnapshot *snapshot = nil;
+    [self bodyForObject:object columnValues:[self columnValuesForObject:object] snapshot:&snapshot];
+    return [snapshot propertiesChangedFrom:previous plan:[DHMambaAccessPlan planForClass:[object class]]];
+}
+
+- (NSArray *)updateArgumentsFromInsertArguments:(NSArray *)arguments objID:(NSString *)objID {
+    
+    // objID, objKey, objForeignKey, objTitle, createTime, updateTime, orderNumber, objBody, properties
+    NSMutableArray *updateArguments = [NSMutableArray arrayWithObjects:
+                                       arguments[1],
+                                       arguments[2],
+                                       arguments[3],
+                                       arguments[6],
+                                       arguments[5],
+                                       arguments[7],
+                                       nil];
+    [updateArguments addObjectsFromArray:[arguments subarrayWithRange:NSMakeRange(8, arguments.count - 8)]];
+    [updateArguments addObject:objID];
+    return updateArguments;
+}
+
+- (NSArray *)insertArgumentsFromUpdateArguments:(NSArray *)arguments {
+    
+    // objKey, objForeignKey, objTitle, orderNumber, updateTime, objBody, properties, objID
+    NSMutableArray *insertArguments = [NSMutableArray arrayWithObjects:
+                                       [arguments lastObject],
+                                       arguments[0],
+                                       arguments[1],
+                                       arguments[2],
+                                       arguments[4],
+                                       arguments[4],
+                                       arguments[3],
+                                       arguments[5],
+                                       nil];
+    [insertArguments addObjectsFromArray:[arguments subarrayWithRange:NSMakeRange(6, arguments.count - 7)]];
+    return insertArguments;
+}
+
+#pragma mark - Private Methods
+- (id)countLookup:(id)object {
+    
+    @synchronized(self) {
+        if ( object ) {
+            _cacheHits++;
+        }
+        else {
+            _cacheMisses++;
+        }
+    }
+    return object;
+}
+
++ (NSString *)columnTypeForProperty:(NSString *)property ofClass:(Class)objectClass {
+    
+    objc_property_t classProperty = class_getProperty(objectClass, [property UTF8String]);
+    if ( !classProperty ) {
+        return nil;
+    }
+    
+    // The type encoding is the first attribute, T followed by the type
+    NSString *attributes = [NSString stringWithUTF8String:property_getAttributes(classProperty)];
+    NSString *typeEncoding = [[attributes componentsSeparatedByString:@","] firstObject];
+    if ( [typeEncoding length] == 2 ) {
+        
+        unichar type = [typeEncoding characterAtIndex:1];
+        if ( strchr("cislqCISLQB", type) ) {
+            return @"integer";
+        }
+        else if ( strchr("fd", type) ) {
+            return @"real";
+        }
+    }
+    else if ( [typeEncoding isEqualToString:@"T@\"NSString\""] ) {
+        return @"text";
+    }
+    else if ( [typeEncoding isEqualToString:@"T@\"NSNumber\""] ) {
+        return @"numeric";
+    }
+    else if ( [typeEncoding isEqualToString:@"T@\"NSDate\""] ) {
+        return @"real";
+    }
+    return nil;
+}
+
+- (NSData *)bodyForObject:(id)object columnValues:(NSArray *)columnValues snapshot:(DHMambaSnapshot **)snapshot {
+    
+    CFAbsoluteTime start = [DHMambaMetrics start];
+    NSData *body = nil;
+    NSMutableData *digests = nil;
+    if ( !self.tracksChanges || [object conformsToProtocol:@protocol(NSCoding)] ) {
+        body = [object MB_objData];
+    }
+    else {
+        
+        // The same encoding as MB_objData, with a digest of each property
+        NSArray *ignoreList = nil;
+        if ( [object respondsToSelector:@selector(mambaObjectIgnoreProperties)] ) {
+            ignoreList = [object performSelector:@selector(mambaObjectIgnoreProperties)];
+        }
+        digests = [[NSMutableData alloc] init];
+        body = [DHMambaCoder encodeObject:object ignoring:ignoreList fieldDigests:digests];
+    }
+    
+    // Snapshots are of the uncompressed body, which is what loading sees
+    if ( self.tracksChanges ) {
+        *snapshot = [[DHMambaSnapshot alloc] initWithColumnValues:columnValues body:body fieldDigests:digests];
+    }
+    if ( self.compression != DHMambaCompressionNone ) {
+        body = [DHMambaCompressor compressData:body compression:self.compression dictionary:self.compressionDictionary];
+    }
+    [DHMambaMetrics record:DHMambaMetricEncode collection:_name since:start];
+    return body;
+}
+
+- (NSArray *)columnValuesForObject:(id)object {
+    
+    NSString *objKey = [object MB_objKey];
+    NSString *objForeignKey = [object MB_objForeignKey];
+    NSString *objTitle = [object MB_objTitle];
+    NSNumber *objOrderNumber = [object MB_objOrderNumber];
+    NSMutableArray *values = [NSMutableArray arrayWithObjects:
+                              objKey ? objKey : [NSNull null],
+                              objForeignKey ? objForeignKey : [NSNull null],
+                              objTitle ? objTitle : [NSNull null],
+                              objOrderNumber ? objOrderNumber : [NSNull null],
+                              nil];
+    [values addObjectsFromArray:[self propertyValuesForObject:object properties:self.indexedProperties]];
+    return values;
+}
+
+- (NSString *)updateSQLForObject:(id)object time:(NSDate *)now changedOnly:(BOOL)changedOnly arguments:(NSArray **)arguments {
+    
+    NSNumber *time = [NSNumber numberWithDouble:[now timeIntervalSince1970]];
+    NSArray *columnValues = [self columnValuesForObject:object];
+    DHMambaSnapshot *snapshot = nil;
+    NSData *body = [self bodyForObject:object columnValues:columnValues snapshot:&snapshot];
+    DHMambaSnapshot *previous = nil;
+    if ( snapshot ) {
+        previous = objc_getAssociatedObject(object, DHMambaCollectionSnapshotKey);
+        objc_setAssociatedObject(object, DHMambaCollectionSnapshotKey, snapshot, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    
+    // Without a snapshot there is no telling what changed, so write it all
+    if ( !changedOnly || !previous ) {
+        
+        NSMutableArray *updateArguments = [NSMutableArray arrayWithObjects:
+                                           columnValues[0],
+                                           columnValues[1],
+                                           columnValues[2],
+                                           columnValues[3],
+                                           time,
+                                           body,
+                                           nil];
+        [updateArguments addObjectsFromArray:[columnValues subarrayWithRange:NSMakeRange(4, columnValues.count - 4)]];
+        [updateArguments addObject:[object MB_objID]];
+        *arguments = updateArguments;
+        return self.updateSQL;
+    }
+    
+    NSIndexSet *changedColumns = [snapshot columnsChangedFrom:previous];
+    BOOL bodyChanged = [snapshot bodyChangedFrom:previous];
+    if ( changedColumns.count == 0 && !bodyChanged ) {
+        *arguments = nil;
+        return nil;
+    }
+    
+    // updateTime comes first so the store can find it
+    NSMutableString *updateColumns = [NSMutableString stringWithString:@"updateTime = ?"];
+    NSMutableArray *updateArguments = [NSMutableArray arrayWithObject:time];
+    [changedColumns enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+        [updateColumns appendFormat:@", \"%@\" = ?",self.trackedColumns[index]];
+        [updateArguments addObject:columnValues[index]];
+    }];
+    if ( bodyChanged ) {
+        [updateColumns appendString:@", objBody = ?"];
+        [updateArguments addObject:body];
+    }
+    [updateArguments addObject:[object MB_objID]];
+    *arguments = updateArguments;
+    return [NSString stringWithFormat:@"update %@ set %@ where objID = ?",_name,updateColumns];
+}
+
+- (NSArray *)propertyValuesForObject:(id)object properties:(NSArray *)properties {
+    
+    NSMutableArray *values = [[NSMutableArray alloc] initWithCapacity:properties.count];
+    for ( NSString *property in properties ) {
+        
+        // Dates are stored the same way as createTime and updateTime so
+        // they can be compared with NSDate parameters.
+        id value = [object valueForKey:property];
+        if ( [value isKindOfClass:[NSDate class]] ) {
+            value = [NSNumber numberWithDouble:[value timeIntervalSince1970]];
+        }
+        [values addObject:value ? value : [NSNull null]];
+    }
+    return values;
+}
+
+- (BOOL)objIDIsPrimaryKeyInDatabase:(FMDatabase *)db {
+    
+    BOOL primaryKey = NO;
+    FMResultSet *results = [db executeQuery:[NSString stringWithFormat:@"PRAGMA table_info(%@)",_name]];
+    while ( [results next] ) {
+        if ( [[results stringForColumn:@"name"] isEqualToString:@"objID"] ) {
+            primaryKey = [results intForColumn:@"pk"] > 0;
+        }
+    }
+    return primaryKey;
+}
+
+- (void)createFullTextIndexInDatabase:(FMDatabase *)db {
+    
+    _fullTextEnabled = NO;
+    
+    // Start over if the indexed columns have changed
+    NSArray *existingColumns = [self columnsOfTable:self.fullTextName inDatabase:db];
+    if ( existingColumns.count > 0 && ![existingColumns isEqualToArray:self.fullTextColumns] ) {
+        [self dropFullTextIndexInDatabase:db];
+        existingColumns = @[];
+    }
+    
+    if ( self.fullTextColumns.count == 0 ) {
+        return;
+    }
+    
+    // objID is the primary key, so the table's rowid isn't stable and VACUUM
+    // can renumber it. The index is keyed on objTextID instead, which every
+    // row is given when it is inserted. Indexes keyed on the rowid by older
+    // versions are rebuilt.
+    if ( ![[self columnsOfTable:_name inDatabase:db] containsObject:@"objTextID"] ) {
+        
+        if ( ![db executeUpdate:[NSString stringWithFormat:@"alter table %@ add column objTextID integer",_name]] ||
+             ![db executeUpdate:[NSString stringWithFormat:@"update %@ set objTextID = rowid",_name]] ) {
+            NSLog(@"full text search not available for %@, using like instead: %@",_name,[db lastErrorMessage]);
+            return;
+        }
+        [self dropFullTextIndexInDatabase:db];
+        existingColumns = @[];
+    }
+    if ( ![db executeUpdate:[NSString stringWithFormat:@"create unique index if not exists %@_objTextID ON %@ (objTextID)",_name,_name]] ) {
+        NSLog(@"full text search not available for %@, using like instead: %@",_name,[db lastErrorMessage]);
+        return;
+    }
+    
+    if ( existingColumns.count == 0 ) {
+        
+        // The trigram tokenizer lets the index answer substring searches,
+        // not just whole words.
+        NSString *columns = [self.fullTextColumns componentsJoinedByString:@", "];
+        NSString *createSQL = [NSString stringWithFormat:@"create virtual table %@ using fts5(%@, content='%@', content_rowid='objTextID', tokenize='trigram')",self.fullTextName,columns,_name];
+        if ( ![db executeUpdate:createSQL] ) {
+            NSLog(@"full text search not available for %@, using like instead: %@",_name,[db lastErrorMessage]);
+            return;
+        }
+        
+        // Keep the index in sync with the collection. New rows are numbered
+        // after the highest objTextID, which the unique index finds directly.
+        NSString *newValues = [@"new." stringByAppendingString:[self.fullTextColumns componentsJoinedByString:@", new."]];
+        NSString *oldValues = [@"old." stringByAppendingString:[self.fullTextColumns componentsJoinedByString:@", old."]];
+        NSString *numberRow = [NSString stringWithFormat:@"update %@ set objTextID = (select coalesce(max(objTextID), 0) + 1 from %@) where objID = new.objID;",_name,_name];
+        NSString *insertNewValues = [NSString stringWithFormat:@"insert into %@ (rowid, %@) values ((select objTextID from %@ where objID = new.objID), %@);",self.fullTextName,columns,_name,newValues];
+        NSString *insertValues = [NSString stringWithFormat:@"insert into %@ (rowid, %@) values (new.objTextID, %@);",self.fullTextName,columns,newValues];
+        NSString *deleteValues = [NSString stringWithFormat:@"insert into %@ (%@, rowid, %@) values ('delete', old.objTextID, %@);",self.fullTextName,self.fullTextName,columns,oldValues];
+        NSArray *triggers = @[ [NSString stringWithFormat:@"create trigger %@_insert after insert on %@ begin %@ %@ end",self.fullTextName,_name,numberRow,insertNewValues],
+                               [NSString stringWithFormat:@"create trigger %@_delete after delete on %@ begin %@ end",self.fullTextName,_name,deleteValues],
+                               [NSString stringWithFormat:@"create trigger %@_update after update of %@ on %@ begin %@ %@ end",self.fullTextName,columns,_name,deleteValues,insertValues] ];
+        for ( NSString *triggerSQL in triggers ) {
+            if ( ![db executeUpdate:triggerSQL] ) {
+                NSLog(@"error creating full text trigger: %@",[db lastErrorMessage]);
+                [self dropFullTextIndexInDatabase:db];
+                return;
+            }
+        }
+        
+        // Index anything that was already in the collection
+        if ( ![db executeUpdate:[NSString stringWithFormat:@"insert into %@ (%@) values ('rebuild')",self.fullTextName,self.fullTextName]] ) {
+            NSLog(@"error building full text index: %@",[db lastErrorMessage]);
+        }
+    }
+    _fullTextEnabled = YES;
+}
+
+- (void)dropFullTextIndexInDatabase:(FMDatabase *)db {
+    
+    for ( NSString *trigger in @[@"insert",@"delete",@"update"] ) {
+        [db executeUpdate:[NSString stringWithFormat:@"drop trigger if exists %@_%@",self.fullTextName,trigger]];
+    }
+    if ( ![db executeUpdate:[NSString stringWithFormat:@"drop table if exists %@",self.fullTextName]] ) {
+        NSLog(@"error dropping full text index: %@",[db lastErrorMessage]);
+    }
+}
+
+- (NSArray *)columnsOfTable:(NSString *)table inDatabase:(FMDatabase *)db {
+    
+    NSMutableArray *columns = [[NSMutableArray alloc] init];
+    FMResultSet *results = [db executeQuery:[NSString stringWithFormat:@"PRAGMA table_info(%@)",table]];
+    while ( [results next] ) {
+        [columns addObject:[results stringForColumn:@"name"]];
+    }
+    return columns;
+}
+
+- (NSDictionary *)managedIndexesInDatabase:(FMDatabase *)db {
+    
+    // Find the indexes on this table that follow our naming scheme
+    NSString *prefix = [NSString stringWithFormat:@"%@_idx_",_name];
+    NSMutableArray *indexNames = [[NSMutableArray alloc] init];
+    FMResultSet *results = [db executeQuery:@"select name from sqlite_master where type = 'index' and tbl_name = ?",_name];
+    while ( [results next] ) {
+        NSString *indexName = [results stringForColumnIndex:0];
+        if ( [indexName hasPrefix:prefix] ) {
+            [indexNames addObject:indexName];
+        }
+    }
+    
+    // and the columns each of them covers
+    NSMutableDictionary *indexes = [[NSMutableDictionary alloc] init];
+    for ( NSString *indexName in indexNames ) {
+        
+        NSMutableArray *columns = [[NSMutableArray alloc] init];
+        results = [db executeQuery:[NSString stringWithFormat:@"PRAGMA index_info(%@)",indexName]];
+        while ( [results next] ) {
+            [columns addObject:[results stringForColumn:@"name"]];
+        }
+        indexes[indexName] = columns;
+    }
+    return indexes;
+}
+
+@end
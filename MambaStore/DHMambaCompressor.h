@@ -0,0 +1,73 @@
+//
+//  DHMambaCompressor.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** How a collection compresses the bodies of its objects. */
+typedef NS_ENUM(uint8_t, DHMambaCompression) {
+    DHMambaCompressionNone = 0,
+    
+    /** Fast enough to use on every load. Needs iOS 9, earlier versions use
+     * zlib instead.
+     */
+    DHMambaCompressionLZ4 = 1,
+    
+    /** Smaller than LZ4 but slower, and can use a preset dictionary. */
+    DHMambaCompressionZlib = 2
+};
+
+/** Compresses object bodies. Compressed data starts with a marker byte that
+ * neither DHMambaCoder nor keyed archives use, then the codec and the
+ * uncompressed length, so compressed and uncompressed rows can be read from
+ * the same collection. Data compressed with a dictionary also records the
+ * dictionary's Adler-32, since it can only be read with exactly the same one.
+ */
+@interface DHMambaCompressor : NSObject
+
+/** Compresses data. Data that is too short to gain anything, or that doesn't
+ * get any smaller, is returned as is.
+ * @param data The data to compress
+ * @param compression The codec to use
+ * @param dictionary Sample data for zlib to start from, or nil
+ * @return The compressed data, or the data itself
+ */
++ (NSData *)compressData:(NSData *)data compression:(DHMambaCompression)compression dictionary:(NSData *)dictionary;
+
+/** Checks if data was written by compressData:compression:dictionary:.
+ * @param data The stored data
+ * @return YES if the data is compressed
+ */
++ (BOOL)isCompressedData:(NSData *)data;
+
+/** Decompresses data. Data that isn't compressed is returned as is.
+ * @param data The stored data
+ * @param dictionary The dictionary the data was compressed with, or nil
+ * @return The uncompressed data, or nil if it could not be decompressed or
+ * was compressed with a different dictionary
+ */
++ (NSData *)decompressData:(NSData *)data dictionary:(NSData *)dictionary;
+
+@end
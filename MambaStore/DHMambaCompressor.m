@@ -0,0 +1,211 @@
+//
+//  DHMambaCompressor.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaCompressor.h"
+#import <compression.h>
+#import <zlib.h>
+
+// Marker, codec, then the uncompressed length as 4 little endian bytes. With a
+// dictionary the codec has its high bit set and the length is followed by the
+// dictionary's Adler-32, so data is never inflated with the wrong one.
+static const uint8_t kDHMambaCompressorMarker = 0xDC;
+static const uint8_t kDHMambaCompressorDictionaryFlag = 0x80;
+static const NSUInteger kDHMambaCompressorHeaderLength = 6;
+static const NSUInteger kDHMambaCompressorDictionaryIDLength = 4;
+
+// Bodies shorter than this don't compress enough to be worth decompressing
+static const NSUInteger kDHMambaCompressorMinimumLength = 64;
+
+static void DHMambaCompressorWriteUInt32(uint8_t *bytes, uint32_t value) {
+    
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+    bytes[2] = (value >> 16) & 0xFF;
+    bytes[3] = (value >> 24) & 0xFF;
+}
+
+static uint32_t DHMambaCompressorReadUInt32(const uint8_t *bytes) {
+    
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+@implementation DHMambaCompressor
+
+#pragma mark - Public Methods
++ (NSData *)compressData:(NSData *)data compression:(DHMambaCompression)compression dictionary:(NSData *)dictionary {
+    
+    if ( compression == DHMambaCompressionNone || data.length < kDHMambaCompressorMinimumLength || data.length > UINT32_MAX ) {
+        return data;
+    }
+    
+    // libcompression is weakly linked, so it is missing before iOS 9
+    if ( compression == DHMambaCompressionLZ4 && &compression_encode_buffer == NULL ) {
+        compression = DHMambaCompressionZlib;
+    }
+    
+    // Only zlib uses the dictionary
+    BOOL usesDictionary = compression == DHMambaCompressionZlib && dictionary.length > 0;
+    NSUInteger headerLength = kDHMambaCompressorHeaderLength + (usesDictionary ? kDHMambaCompressorDictionaryIDLength : 0);
+    
+    // Anything bigger than the original isn't worth keeping
+    NSMutableData *compressed = [NSMutableData dataWithLength:headerLength + data.length];
+    uint8_t *bytes = [compressed mutableBytes];
+    bytes[0] = kDHMambaCompressorMarker;
+    bytes[1] = compression | (usesDictionary ? kDHMambaCompressorDictionaryFlag : 0);
+    DHMambaCompressorWriteUInt32(bytes + 2, (uint32_t)data.length);
+    if ( usesDictionary ) {
+        DHMambaCompressorWriteUInt32(bytes + kDHMambaCompressorHeaderLength, [DHMambaCompressor identifierForDictionary:dictionary]);
+    }
+    
+    size_t compressedLength = 0;
+    if ( compression == DHMambaCompressionLZ4 ) {
+        compressedLength = compression_encode_buffer(bytes + headerLength, data.length, [data bytes], data.length, NULL, COMPRESSION_LZ4);
+    }
+    else if ( compression == DHMambaCompressionZlib ) {
+        compressedLength = [DHMambaCompressor deflate:data into:bytes + headerLength capacity:data.length dictionary:usesDictionary ? dictionary : nil];
+    }
+    
+    if ( compressedLength == 0 || compressedLength >= data.length - headerLength ) {
+        return data;
+    }
+    [compressed setLength:headerLength + compressedLength];
+    return compressed;
+}
+
++ (BOOL)isCompressedData:(NSData *)data {
+    
+    if ( data.length < kDHMambaCompressorHeaderLength ) {
+        return NO;
+    }
+    const uint8_t *bytes = [data bytes];
+    return bytes[0] == kDHMambaCompressorMarker;
+}
+
++ (NSData *)decompressData:(NSData *)data dictionary:(NSData *)dictionary {
+    
+    if ( ![DHMambaCompressor isCompressedData:data] ) {
+        return data;
+    }
+    
+    const uint8_t *bytes = [data bytes];
+    DHMambaCompression compression = bytes[1] & ~kDHMambaCompressorDictionaryFlag;
+    uint32_t length = DHMambaCompressorReadUInt32(bytes + 2);
+    NSUInteger headerLength = kDHMambaCompressorHeaderLength;
+    
+    // Data written before dictionaries were identified is left to zlib to check
+    if ( bytes[1] & kDHMambaCompressorDictionaryFlag ) {
+        
+        headerLength += kDHMambaCompressorDictionaryIDLength;
+        if ( data.length < headerLength ) {
+            NSLog(@"error decompressing data, it is truncated");
+            return nil;
+        }
+        // Adler-32 is never 0, so 0 means no dictionary was given
+        uint32_t dictionaryID = DHMambaCompressorReadUInt32(bytes + kDHMambaCompressorHeaderLength);
+        uint32_t givenID = dictionary.length > 0 ? [DHMambaCompressor identifierForDictionary:dictionary] : 0;
+        if ( dictionaryID != givenID ) {
+            NSLog(@"error decompressing data, it was compressed with dictionary %08x but was given %08x",dictionaryID,givenID);
+            return nil;
+        }
+    }
+    NSMutableData *decompressed = [NSMutableData dataWithLength:length];
+    
+    size_t decompressedLength = 0;
+    if ( compression == DHMambaCompressionLZ4 ) {
+        if ( &compression_decode_buffer == NULL ) {
+            NSLog(@"error decompressing data, LZ4 isn't available before iOS 9");
+            return nil;
+        }
+        decompressedLength = compression_decode_buffer([decompressed mutableBytes], length, bytes + headerLength, data.length - headerLength, NULL, COMPRESSION_LZ4);
+    }
+    else if ( compression == DHMambaCompressionZlib ) {
+        decompressedLength = [DHMambaCompressor inflate:bytes + headerLength length:data.length - headerLength into:[decompressed mutableBytes] capacity:length dictionary:dictionary];
+    }
+    
+    if ( decompressedLength != length ) {
+        NSLog(@"error decompressing data, it is truncated, corrupt or needs a different dictionary");
+        return nil;
+    }
+    return decompressed;
+}
+
+#pragma mark - Private Methods
++ (uint32_t)identifierForDictionary:(NSData *)dictionary {
+    
+    // The same Adler-32 zlib puts in its own header, and cheap next to inflating
+    return (uint32_t)adler32(adler32(0L, Z_NULL, 0), [dictionary bytes], (uInt)dictionary.length);
+}
+
++ (size_t)deflate:(NSData *)data into:(uint8_t *)buffer capacity:(size_t)capacity dictionary:(NSData *)dictionary {
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if ( deflateInit(&stream, Z_BEST_COMPRESSION) != Z_OK ) {
+        return 0;
+    }
+    if ( dictionary.length > 0 && deflateSetDictionary(&stream, [dictionary bytes], (uInt)dictionary.length) != Z_OK ) {
+        deflateEnd(&stream);
+        return 0;
+    }
+    
+    stream.next_in = (Bytef *)[data bytes];
+    stream.avail_in = (uInt)data.length;
+    stream.next_out = buffer;
+    stream.avail_out = (uInt)capacity;
+    
+    // Running out of room means it didn't get smaller
+    int status = deflate(&stream, Z_FINISH);
+    size_t length = status == Z_STREAM_END ? stream.total_out : 0;
+    deflateEnd(&stream);
+    return length;
+}
+
++ (size_t)inflate:(const uint8_t *)bytes length:(size_t)length into:(uint8_t *)buffer capacity:(size_t)capacity dictionary:(NSData *)dictionary {
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if ( inflateInit(&stream) != Z_OK ) {
+        return 0;
+    }
+    
+    stream.next_in = (Bytef *)bytes;
+    stream.avail_in = (uInt)length;
+    stream.next_out = buffer;
+    stream.avail_out = (uInt)capacity;
+    
+    // zlib asks for the dictionary once it has read the header
+    int status = inflate(&stream, Z_FINISH);
+    if ( status == Z_NEED_DICT && dictionary.length > 0 ) {
+        if ( inflateSetDictionary(&stream, [dictionary bytes], (uInt)dictionary.length) == Z_OK ) {
+            status = inflate(&stream, Z_FINISH);
+        }
+    }
+    size_t inflated = status == Z_STREAM_END ? stream.total_out : 0;
+    inflateEnd(&stream);
+    return inflated;
+}
+
+@end
@@ -0,0 +1,70 @@
+//
+//  DHMambaFault.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Stands in for a stored object without decoding it. The built in columns
+ * and the indexed properties are read with the rest of the row, so the MB_
+ * getters and the getters for indexed properties are answered right away.
+ * Anything else loads the real object the first time and is then passed on
+ * to it.
+ */
+@interface DHMambaFault : NSProxy
+
+#pragma mark - Properties
+@property (nonatomic,readonly) Class objectClass;
+
+/** Column values read with the row. Dates are NSDate and nulls are left out. */
+@property (nonatomic,readonly) NSDictionary *values;
+
+/** YES once the real object has been loaded */
+@property (nonatomic,readonly) BOOL isLoaded;
+
+#pragma mark - Public Methods
+
+/** Creates a fault for a stored object.
+ * @param objectClass The class of the object
+ * @param values The column values, including objID
+ * @return The fault
+ */
++ (instancetype)faultForClass:(Class)objectClass values:(NSDictionary *)values;
+
+/** Returns the real object, loading it if needed.
+ * @return The object
+ */
+- (id)object;
+
+#pragma mark - Mamba values
+- (BOOL)MB_has_objID;
+- (NSString *)MB_objID;
+- (NSString *)MB_objKey;
+- (NSString *)MB_objForeignKey;
+- (NSString *)MB_objTitle;
+- (NSNumber *)MB_objOrderNumber;
+- (NSDate *)MB_createTime;
+- (NSDate *)MB_updateTime;
+
+@end
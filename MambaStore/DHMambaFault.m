@@ -0,0 +1,206 @@
+//
+//  DHMambaFault.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaFault.h"
+#import "DHMambaAccessPlan.h"
+#import "DHMambaCollection.h"
+#import "NSObject+DHMambaObject.h"
+
+@interface DHMambaFault()
+
+@property (nonatomic,strong) id loadedObject;
+
+// getter name -> indexed property, for the fault's class
+@property (nonatomic,strong) NSDictionary *getters;
+
+@end
+
+@implementation DHMambaFault
+
+#pragma mark - Public Methods
++ (instancetype)faultForClass:(Class)objectClass values:(NSDictionary *)values {
+    
+    DHMambaFault *fault = [DHMambaFault alloc];
+    fault->_objectClass = objectClass;
+    fault->_values = [values copy];
+    fault->_getters = [DHMambaFault gettersForClass:objectClass];
+    return fault;
+}
+
+- (BOOL)isLoaded {
+    
+    @synchronized(self) {
+        return self.loadedObject != nil;
+    }
+}
+
+- (id)object {
+    
+    @synchronized(self) {
+        if ( !self.loadedObject ) {
+            self.loadedObject = [self.objectClass MB_loadWithID:self.values[@"objID"]];
+        }
+        return self.loadedObject;
+    }
+}
+
+#pragma mark - Mamba values
+- (BOOL)MB_has_objID {
+    return YES;
+}
+
+- (NSString *)MB_objID {
+    return self.values[@"objID"];
+}
+
+- (NSString *)MB_objKey {
+    return self.isLoaded ? [self.object MB_objKey] : self.values[@"objKey"];
+}
+
+- (NSString *)MB_objForeignKey {
+    return self.isLoaded ? [self.object MB_objForeignKey] : self.values[@"objForeignKey"];
+}
+
+- (NSString *)MB_objTitle {
+    return self.isLoaded ? [self.object MB_objTitle] : self.values[@"objTitle"];
+}
+
+- (NSNumber *)MB_objOrderNumber {
+    return self.isLoaded ? [self.object MB_objOrderNumber] : self.values[@"orderNumber"];
+}
+
+- (NSDate *)MB_createTime {
+    return self.isLoaded ? [self.object MB_createTime] : self.values[@"createTime"];
+}
+
+- (NSDate *)MB_updateTime {
+    return self.isLoaded ? [self.object MB_updateTime] : self.values[@"updateTime"];
+}
+
+#pragma mark - NSObject
+- (Class)class {
+    return self.objectClass;
+}
+
+- (BOOL)isKindOfClass:(Class)aClass {
+    return [self.objectClass isSubclassOfClass:aClass];
+}
+
+- (BOOL)isMemberOfClass:(Class)aClass {
+    return self.objectClass == aClass;
+}
+
+- (BOOL)respondsToSelector:(SEL)aSelector {
+    return [self.objectClass instancesRespondToSelector:aSelector];
+}
+
+- (BOOL)conformsToProtocol:(Protocol *)aProtocol {
+    return [self.objectClass conformsToProtocol:aProtocol];
+}
+
+#pragma mark - Forwarding
+- (id)forwardingTargetForSelector:(SEL)aSelector {
+    
+    // Indexed property getters are answered from the row until the object is
+    // loaded, everything else goes straight to the object.
+    if ( !self.isLoaded && self.getters[NSStringFromSelector(aSelector)] ) {
+        return nil;
+    }
+    return [self object];
+}
+
+- (NSMethodSignature *)methodSignatureForSelector:(SEL)aSelector {
+    
+    return [self.objectClass instanceMethodSignatureForSelector:aSelector];
+}
+
+- (void)forwardInvocation:(NSInvocation *)invocation {
+    
+    NSString *property = self.getters[NSStringFromSelector(invocation.selector)];
+    if ( property && !self.isLoaded && [self setReturnValue:self.values[property] ofInvocation:invocation] ) {
+        return;
+    }
+    [invocation invokeWithTarget:[self object]];
+}
+
+#pragma mark - Private Methods
++ (NSDictionary *)gettersForClass:(Class)objectClass {
+    
+    static NSMutableDictionary *staticGetters;
+    @synchronized(self) {
+        
+        if ( !staticGetters ) {
+            staticGetters = [[NSMutableDictionary alloc] init];
+        }
+        
+        NSString *className = NSStringFromClass(objectClass);
+        NSDictionary *getters = staticGetters[className];
+        if ( !getters ) {
+            
+            NSMutableDictionary *classGetters = [[NSMutableDictionary alloc] init];
+            NSArray *indexedProperties = [DHMambaCollection collectionForClass:objectClass].indexedProperties;
+            DHMambaAccessPlan *plan = [DHMambaAccessPlan planForClass:objectClass];
+            for ( NSUInteger index = 0; index < plan.fieldCount; index++ ) {
+                const DHMambaAccessField *field = &plan.fields[index];
+                if ( [indexedProperties containsObject:field->name] && field->getter ) {
+                    classGetters[NSStringFromSelector(field->getter)] = field->name;
+                }
+            }
+            getters = classGetters;
+            staticGetters[className] = getters;
+        }
+        return getters;
+    }
+}
+
+- (BOOL)setReturnValue:(id)value ofInvocation:(NSInvocation *)invocation {
+    
+    const char *type = invocation.methodSignature.methodReturnType;
+    switch ( type[0] ) {
+    case '@': {
+        __unsafe_unretained id object = value;
+        [invocation setReturnValue:&object];
+        return YES;
+    }
+    case 'c': { char scalar = [value charValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 's': { short scalar = [value shortValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'i': { int scalar = [value intValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'l': { long scalar = [value longValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'q': { long long scalar = [value longLongValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'C': { unsigned char scalar = [value unsignedCharValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'S': { unsigned short scalar = [value unsignedShortValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'I': { unsigned int scalar = [value unsignedIntValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'L': { unsigned long scalar = [value unsignedLongValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'Q': { unsigned long long scalar = [value unsignedLongLongValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'B': { bool scalar = [value boolValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'f': { float scalar = [value floatValue]; [invocation setReturnValue:&scalar]; return YES; }
+    case 'd': { double scalar = [value doubleValue]; [invocation setReturnValue:&scalar]; return YES; }
+    default:
+        return NO;
+    }
+}
+
+@end
@@ -0,0 +1,97 @@
+//
+//  DHMambaLiveQuery.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import "NSObject+DHMambaObject.h"
+#import "DHMambaChangeSet.h"
+
+/** What changed in a live query's objects. Removed indexes are positions in
+ * the old objects, inserted and updated indexes are positions in the new
+ * objects. Unchanged objects shifted by inserts and removals aren't listed.
+ */
+@interface DHMambaLiveQueryChanges : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) NSIndexSet *removedIndexes;
+@property (nonatomic,readonly) NSIndexSet *insertedIndexes;
+
+/** Objects that were changed but kept their place. */
+@property (nonatomic,readonly) NSIndexSet *updatedIndexes;
+
+/** Objects that were changed and moved, as an array of @[old index, new index]
+ * (NSNumber) pairs.
+ */
+@property (nonatomic,readonly) NSArray *moves;
+
+#pragma mark - Public Methods
+- (id)initWithRemoved:(NSIndexSet *)removed inserted:(NSIndexSet *)inserted updated:(NSIndexSet *)updated moves:(NSArray *)moves;
+
+@end
+
+/** A search whose results stay up to date as the store changes. The query is
+ * run once. After that, each change set posted for the class (see
+ * DHMambaStore setChangeInterval:queue:) only reads back the changed objects
+ * to check them against the criteria, and places them in the results by their
+ * order. With a limit, rows that move up to fill a gap are read with a single
+ * page query.
+ *
+ * Changes are applied on the queue change sets are posted on, which is the
+ * main queue by default.
+ */
+@interface DHMambaLiveQuery : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) Class objectClass;
+@property (nonatomic,readonly) NSArray *criteria;
+@property (nonatomic,readonly) NSDictionary *parameters;
+@property (nonatomic,readonly) DHMambaObjectOrderBy orderBy;
+@property (nonatomic,readonly) NSUInteger limit;
+
+/** The current results */
+@property (nonatomic,readonly) NSArray *objects;
+
+/** Called after the objects change */
+@property (nonatomic,copy) void (^changeBlock)(DHMambaLiveQuery *query, DHMambaLiveQueryChanges *changes);
+
+#pragma mark - Public Methods
+
+/** Runs a search and keeps its results up to date.
+ * @param objectClass The class to search
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param orderBy The order to keep the objects in
+ * @param limit The maximum number of objects, or 0 for all of them
+ * @return The live query
+ */
++ (instancetype)liveQueryForClass:(Class)objectClass criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters orderBy:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit;
+
+/** Applies a change set to the objects. Called for every change set posted
+ * for the class.
+ * @param changes The changes
+ */
+- (void)applyChanges:(DHMambaChangeSet *)changes;
+
+@end
@@ -0,0 +1,345 @@
+//
+//  DHMambaLiveQuery.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaLiveQuery.h"
+#import "DHMambaStore.h"
+#import "DHMambaCollection.h"
+
+// Number of changed objects read back per query
+static NSUInteger const kDHMambaLiveQueryChunkSize = 500;
+
+@interface NSObject (DHMambaObjectLoading)
+- (id)MB_unarchive_withResults:(FMResultSet *)results;
++ (void)MB_performAfterLoadOnArray:(NSArray *)loadedObjects;
+@end
+
+//
+// Compares two values the way SQLite orders them: nulls, then numbers, then
+// text, then blobs.
+//
+static NSInteger DHMambaValueRank(id value) {
+    
+    if ( !value || value == [NSNull null] ) {
+        return 0;
+    }
+    if ( [value isKindOfClass:[NSNumber class]] ) {
+        return 1;
+    }
+    if ( [value isKindOfClass:[NSString class]] ) {
+        return 2;
+    }
+    return 3;
+}
+
+static NSComparisonResult DHMambaCompareBytes(const void *first, NSUInteger firstLength, const void *second, NSUInteger secondLength) {
+    
+    int result = memcmp(first, second, MIN(firstLength, secondLength));
+    if ( result == 0 && firstLength != secondLength ) {
+        return firstLength < secondLength ? NSOrderedAscending : NSOrderedDescending;
+    }
+    return result < 0 ? NSOrderedAscending : (result > 0 ? NSOrderedDescending : NSOrderedSame);
+}
+
+static NSComparisonResult DHMambaCompareValues(id first, id second) {
+    
+    NSInteger firstRank = DHMambaValueRank(first);
+    NSInteger secondRank = DHMambaValueRank(second);
+    if ( firstRank != secondRank ) {
+        return firstRank < secondRank ? NSOrderedAscending : NSOrderedDescending;
+    }
+    
+    switch ( firstRank ) {
+    case 0:
+        return NSOrderedSame;
+    case 1:
+        return [first compare:second];
+    case 2:
+        // BINARY collation compares the UTF-8 bytes, which orders characters
+        // outside the BMP differently from comparing UTF-16 units
+        return DHMambaCompareBytes([first UTF8String], [first lengthOfBytesUsingEncoding:NSUTF8StringEncoding], [second UTF8String], [second lengthOfBytesUsingEncoding:NSUTF8StringEncoding]);
+    default:
+        return DHMambaCompareBytes([first bytes], [first length], [second bytes], [second length]);
+    }
+}
+
+@implementation DHMambaLiveQueryChanges
+
+- (id)initWithRemoved:(NSIndexSet *)removed inserted:(NSIndexSet *)inserted updated:(NSIndexSet *)updated moves:(NSArray *)moves {
+    
+    if ( self = [super init] ) {
+        _removedIndexes = removed;
+        _insertedIndexes = inserted;
+        _updatedIndexes = updated;
+        _moves = moves;
+    }
+    return self;
+}
+
+@end
+
+@interface DHMambaLiveQuery()
+
+@property (nonatomic,strong) NSString *collectionName;
+@property (nonatomic,strong) NSString *where;
+@property (nonatomic,strong) NSString *orderColumn;
+@property (nonatomic,assign) BOOL descending;
+
+// @[order value, objID] for each object, in the same order
+@property (nonatomic,strong) NSArray *keys;
+
+@end
+
+@implementation DHMambaLiveQuery
+
+#pragma mark - Initialization
+- (id)initWithClass:(Class)objectClass criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters orderBy:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit {
+    
+    if ( self = [super init] ) {
+        
+        _objectClass = objectClass;
+        _criteria = criteria ? [criteria copy] : @[];
+        _parameters = parameters ? [parameters copy] : @{};
+        _orderBy = orderBy;
+        _limit = limit;
+        _collectionName = [DHMambaCollection collectionNameForClass:objectClass];
+        _where = [_criteria componentsJoinedByString:@" and "];
+        _orderColumn = [DHMambaStore orderColumnFor:orderBy];
+        _descending = [DHMambaStore orderIsDescending:orderBy];
+        
+        [DHMambaStore createCollectionIfDoesntExist:objectClass];
+        
+        NSMutableArray *objects = [[NSMutableArray alloc] init];
+        NSMutableArray *keys = [[NSMutableArray alloc] init];
+        [self loadPageAfter:nil limit:limit objects:objects keys:keys];
+        _objects = objects;
+        _keys = keys;
+        
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(storeChanged:) name:kDHMambaStoreChangesNotification object:objectClass];
+    }
+    return self;
+}
+
+- (void)dealloc {
+    
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark - Public Methods
++ (instancetype)liveQueryForClass:(Class)objectClass criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters orderBy:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit {
+    
+    return [[DHMambaLiveQuery alloc] initWithClass:objectClass criteria:criteria parameters:parameters orderBy:orderBy limit:limit];
+}
+
+- (void)applyChanges:(DHMambaChangeSet *)changes {
+    
+    NSArray *oldKeys = self.keys;
+    NSMutableArray *objects = [self.objects mutableCopy];
+    NSMutableArray *keys = [oldKeys mutableCopy];
+    
+    // With a full page, rows past the last one we have are unknown. Changed
+    // rows that now sort after it are left for the refill to find.
+    NSArray *cutoff = nil;
+    if ( self.limit > 0 && oldKeys.count >= self.limit && !changes.emptied ) {
+        cutoff = [oldKeys lastObject];
+    }
+    
+    if ( changes.emptied ) {
+        [objects removeAllObjects];
+        [keys removeAllObjects];
+    }
+    
+    NSMutableSet *changedIDs = [NSMutableSet setWithSet:changes.insertedIDs];
+    [changedIDs unionSet:changes.updatedIDs];
+    for ( NSInteger index = keys.count - 1; index >= 0; index-- ) {
+        NSString *objID = keys[index][1];
+        if ( [changedIDs containsObject:objID] || [changes.deletedIDs containsObject:objID] ) {
+            [objects removeObjectAtIndex:index];
+            [keys removeObjectAtIndex:index];
+        }
+    }
+    
+    // Only the changed rows are read, to see if they still match and where
+    // they go now
+    NSMutableArray *changedObjects = [[NSMutableArray alloc] init];
+    NSMutableArray *changedKeys = [[NSMutableArray alloc] init];
+    [self loadObjectsWithIDs:[changedIDs allObjects] objects:changedObjects keys:changedKeys];
+    
+    NSComparator comparator = [self keyComparator];
+    for ( NSUInteger index = 0; index < changedKeys.count; index++ ) {
+        
+        NSArray *key = changedKeys[index];
+        if ( cutoff && comparator(key, cutoff) == NSOrderedDescending ) {
+            continue;
+        }
+        NSUInteger position = [keys indexOfObject:key inSortedRange:NSMakeRange(0, keys.count) options:NSBinarySearchingInsertionIndex usingComparator:comparator];
+        [keys insertObject:key atIndex:position];
+        [objects insertObject:changedObjects[index] atIndex:position];
+    }
+    
+    if ( self.limit > 0 && keys.count > self.limit ) {
+        NSRange extra = NSMakeRange(self.limit, keys.count - self.limit);
+        [keys removeObjectsInRange:extra];
+        [objects removeObjectsInRange:extra];
+    }
+    
+    // Fill the page back up from the rows after the last one
+    if ( cutoff && keys.count < self.limit ) {
+        NSArray *last = [keys lastObject];
+        NSString *token = last ? [DHMambaStore tokenForOrder:self.orderBy value:last[0] objID:last[1]] : nil;
+        [self loadPageAfter:token limit:self.limit - keys.count objects:objects keys:keys];
+    }
+    
+    DHMambaLiveQueryChanges *diff = [self changesFrom:oldKeys to:keys changedIDs:changedIDs];
+    if ( !diff ) {
+        return;
+    }
+    
+    _objects = objects;
+    _keys = keys;
+    if ( self.changeBlock ) {
+        self.changeBlock(self, diff);
+    }
+}
+
+#pragma mark - Private Methods
+- (void)storeChanged:(NSNotification *)notification {
+    
+    [self applyChanges:notification.userInfo[@"changes"]];
+}
+
+- (NSComparator)keyComparator {
+    
+    BOOL descending = self.descending;
+    return ^NSComparisonResult(NSArray *first, NSArray *second) {
+        
+        NSComparisonResult result = DHMambaCompareValues(first[0], second[0]);
+        if ( result == NSOrderedSame ) {
+            result = DHMambaCompareValues(first[1], second[1]);
+        }
+        return descending ? (NSComparisonResult)-result : result;
+    };
+}
+
+- (NSArray *)keyForResults:(FMResultSet *)results {
+    
+    return @[[results objectForColumnName:self.orderColumn],[results stringForColumn:@"objID"]];
+}
+
+- (void)loadPageAfter:(NSString *)token limit:(NSUInteger)limit objects:(NSMutableArray *)objects keys:(NSMutableArray *)keys {
+    
+    Class objectClass = self.objectClass;
+    NSMutableArray *pageObjects = [[NSMutableArray alloc] init];
+    [DHMambaStore selectPageFromCollection:self.collectionName where:self.where parameters:self.parameters order:self.orderBy limit:limit after:token resultBlock:^(FMResultSet *results) {
+        
+        id object = [objectClass MB_unarchive_withResults:results];
+        if ( object ) {
+            [pageObjects addObject:object];
+            [keys addObject:[self keyForResults:results]];
+        }
+    }];
+    [objectClass MB_performAfterLoadOnArray:pageObjects];
+    [objects addObjectsFromArray:pageObjects];
+}
+
+- (void)loadObjectsWithIDs:(NSArray *)objIDs objects:(NSMutableArray *)objects keys:(NSMutableArray *)keys {
+    
+    Class objectClass = self.objectClass;
+    for ( NSUInteger location = 0; location < objIDs.count; location += kDHMambaLiveQueryChunkSize ) {
+        
+        NSUInteger length = MIN(kDHMambaLiveQueryChunkSize, objIDs.count - location);
+        NSMutableDictionary *parameters = [NSMutableDictionary dictionaryWithDictionary:self.parameters];
+        NSMutableArray *names = [[NSMutableArray alloc] initWithCapacity:length];
+        for ( NSUInteger index = 0; index < length; index++ ) {
+            NSString *name = [NSString stringWithFormat:@"mambaLiveID%lu",(unsigned long)index];
+            parameters[name] = objIDs[location + index];
+            [names addObject:[@":" stringByAppendingString:name]];
+        }
+        
+        NSString *where = [NSString stringWithFormat:@"objID in (%@)",[names componentsJoinedByString:@", "]];
+        if ( self.where.length > 0 ) {
+            where = [NSString stringWithFormat:@"(%@) and %@",self.where,where];
+        }
+        
+        NSMutableArray *chunkObjects = [[NSMutableArray alloc] init];
+        [DHMambaStore selectFromCollection:self.collectionName where:where parameters:parameters order:self.orderBy limit:0 resultBlock:^(FMResultSet *results) {
+            
+            id object = [objectClass MB_unarchive_withResults:results];
+            if ( object ) {
+                [chunkObjects addObject:object];
+                [keys addObject:[self keyForResults:results]];
+            }
+        }];
+        [objectClass MB_performAfterLoadOnArray:chunkObjects];
+        [objects addObjectsFromArray:chunkObjects];
+    }
+}
+
+- (DHMambaLiveQueryChanges *)changesFrom:(NSArray *)oldKeys to:(NSArray *)newKeys changedIDs:(NSSet *)changedIDs {
+    
+    NSMutableDictionary *oldIndexes = [[NSMutableDictionary alloc] initWithCapacity:oldKeys.count];
+    for ( NSUInteger index = 0; index < oldKeys.count; index++ ) {
+        oldIndexes[oldKeys[index][1]] = @(index);
+    }
+    
+    NSMutableIndexSet *inserted = [[NSMutableIndexSet alloc] init];
+    NSMutableIndexSet *updated = [[NSMutableIndexSet alloc] init];
+    NSMutableArray *moves = [[NSMutableArray alloc] init];
+    NSMutableSet *keptIDs = [[NSMutableSet alloc] initWithCapacity:newKeys.count];
+    for ( NSUInteger index = 0; index < newKeys.count; index++ ) {
+        
+        NSArray *key = newKeys[index];
+        NSNumber *oldIndex = oldIndexes[key[1]];
+        [keptIDs addObject:key[1]];
+        if ( !oldIndex ) {
+            [inserted addIndex:index];
+        }
+        else if ( [changedIDs containsObject:key[1]] ) {
+            
+            // Only changed objects can move relative to the others
+            id oldValue = oldKeys[[oldIndex unsignedIntegerValue]][0];
+            if ( DHMambaCompareValues(oldValue, key[0]) == NSOrderedSame ) {
+                [updated addIndex:index];
+            }
+            else {
+                [moves addObject:@[oldIndex,@(index)]];
+            }
+        }
+    }
+    
+    NSMutableIndexSet *removed = [[NSMutableIndexSet alloc] init];
+    for ( NSUInteger index = 0; index < oldKeys.count; index++ ) {
+        if ( ![keptIDs containsObject:oldKeys[index][1]] ) {
+            [removed addIndex:index];
+        }
+    }
+    
+    if ( removed.count == 0 && inserted.count == 0 && updated.count == 0 && moves.count == 0 ) {
+        return nil;
+    }
+    return [[DHMambaLiveQueryChanges alloc] initWithRemoved:removed inserted:inserted updated:updated moves:moves];
+}
+
+@end
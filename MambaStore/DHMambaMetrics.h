@@ -0,0 +1,128 @@
+//
+//  DHMambaMetrics.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+//
+// What is measured. Times are in microseconds.
+//
+typedef NS_ENUM(NSUInteger, DHMambaMetric) {
+    DHMambaMetricQueueWait = 0,     // waiting for a database connection
+    DHMambaMetricExecute = 1,       // SQLite running a statement
+    DHMambaMetricEncode = 2,        // encoding one object's body
+    DHMambaMetricDecode = 3,        // decoding one object
+    DHMambaMetricNotify = 4,        // posting one notification
+    DHMambaMetricRows = 5           // rows returned by one query, not a time
+};
+
+// Number of DHMambaMetric values
+static NSUInteger const kDHMambaMetricCount = 6;
+
+// Collection name used for metrics that don't belong to one collection
+extern NSString * const kDHMambaMetricsStoreCollection;
+
+/** A count, total and power of two histogram of recorded values. Bucket 0
+ * counts values below 1, and bucket n counts values from 2^(n-1) up to 2^n.
+ */
+@interface DHMambaHistogram : NSObject <NSCopying>
+
+#pragma mark - Properties
+@property (nonatomic,readonly) NSUInteger count;
+@property (nonatomic,readonly) double total;
+@property (nonatomic,readonly) double minimum;
+@property (nonatomic,readonly) double maximum;
+@property (nonatomic,readonly) double average;
+
+/** The bucket counts (NSNumber) */
+@property (nonatomic,readonly) NSArray *buckets;
+
+#pragma mark - Public Methods
+- (void)addValue:(double)value;
+
+/** Estimates a percentile from the buckets.
+ * @param percentile The percentile, from 0 to 100
+ * @return The upper bound of the bucket the percentile falls in
+ */
+- (double)valueAtPercentile:(double)percentile;
+
+/** Returns the histogram as property list values.
+ * @return The histogram
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
+
+/** Counters and latency histograms for the store's hot paths, kept per
+ * collection. Metrics are off by default, and while off the store only checks
+ * a flag where it would record one.
+ */
+@interface DHMambaMetrics : NSObject
+
+#pragma mark - Public Methods
++ (void)enable;
++ (void)disable;
++ (BOOL)enabled;
+
+/** Returns a copy of everything recorded so far.
+ * @return A dictionary of collection name to a dictionary of metric name
+ * (see nameOfMetric:) to DHMambaHistogram
+ */
++ (NSDictionary *)snapshot;
+
+/** Throws away everything recorded so far. */
++ (void)reset;
+
+/** Calls a block with a snapshot every interval, on a background queue.
+ * @param interval Seconds between calls, or 0 to stop
+ * @param block The block to call
+ */
++ (void)setDumpInterval:(NSTimeInterval)interval block:(void (^)(NSDictionary *snapshot))block;
+
++ (NSString *)nameOfMetric:(DHMambaMetric)metric;
+
+#pragma mark - Recording
+
+/** Returns the time to pass to record:collection:since:, or 0 when metrics
+ * are off.
+ * @return The current time
+ */
++ (CFAbsoluteTime)start;
+
+/** Records the time since start. Does nothing if start is 0.
+ * @param metric The metric
+ * @param collection The collection name, or nil for the store
+ * @param start The value returned by start
+ */
++ (void)record:(DHMambaMetric)metric collection:(NSString *)collection since:(CFAbsoluteTime)start;
+
+/** Records a value. Does nothing when metrics are off.
+ * @param metric The metric
+ * @param collection The collection name, or nil for the store
+ * @param value The value
+ */
++ (void)record:(DHMambaMetric)metric collection:(NSString *)collection value:(double)value;
+
+@end
@@ -0,0 +1,252 @@
+//
+//  DHMambaMetrics.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaMetrics.h"
+
+NSString * const kDHMambaMetricsStoreCollection = @"*";
+
+// Buckets up to 2^31, which is over half an hour in microseconds
+static NSUInteger const kDHMambaHistogramBucketCount = 33;
+
+static BOOL staticMetricsEnabled;
+static NSMutableDictionary *staticMetrics;
+static dispatch_source_t staticDumpTimer;
+
+@implementation DHMambaHistogram {
+    NSUInteger _bucketCounts[kDHMambaHistogramBucketCount];
+}
+
+#pragma mark - Public Methods
+- (void)addValue:(double)value {
+    
+    NSUInteger bucket = 0;
+    if ( value >= 1.0 ) {
+        int exponent = 0;
+        frexp(value, &exponent);
+        bucket = MIN((NSUInteger)exponent, kDHMambaHistogramBucketCount - 1);
+    }
+    _bucketCounts[bucket]++;
+    
+    _minimum = _count == 0 ? value : MIN(_minimum, value);
+    _maximum = _count == 0 ? value : MAX(_maximum, value);
+    _total += value;
+    _count++;
+}
+
+- (double)average {
+    return _count > 0 ? _total / _count : 0;
+}
+
+- (NSArray *)buckets {
+    
+    NSMutableArray *buckets = [[NSMutableArray alloc] initWithCapacity:kDHMambaHistogramBucketCount];
+    for ( NSUInteger bucket = 0; bucket < kDHMambaHistogramBucketCount; bucket++ ) {
+        [buckets addObject:[NSNumber numberWithUnsignedInteger:_bucketCounts[bucket]]];
+    }
+    return buckets;
+}
+
+- (double)valueAtPercentile:(double)percentile {
+    
+    if ( _count == 0 ) {
+        return 0;
+    }
+    
+    NSUInteger wanted = (NSUInteger)ceil(_count * MIN(MAX(percentile, 0), 100) / 100.0);
+    NSUInteger seen = 0;
+    for ( NSUInteger bucket = 0; bucket < kDHMambaHistogramBucketCount; bucket++ ) {
+        seen += _bucketCounts[bucket];
+        if ( seen >= wanted && seen > 0 ) {
+            return MIN(ldexp(1.0, (int)bucket), _maximum);
+        }
+    }
+    return _maximum;
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    
+    return @{@"count":[NSNumber numberWithUnsignedInteger:self.count],
+             @"total":[NSNumber numberWithDouble:self.total],
+             @"minimum":[NSNumber numberWithDouble:self.minimum],
+             @"maximum":[NSNumber numberWithDouble:self.maximum],
+             @"average":[NSNumber numberWithDouble:self.average],
+             @"p50":[NSNumber numberWithDouble:[self valueAtPercentile:50]],
+             @"p99":[NSNumber numberWithDouble:[self valueAtPercentile:99]],
+             @"buckets":self.buckets};
+}
+
+- (NSString *)description {
+    
+    return [NSString stringWithFormat:@"count %lu, average %.1f, p50 %.1f, p99 %.1f, max %.1f",(unsigned long)self.count,self.average,[self valueAtPercentile:50],[self valueAtPercentile:99],self.maximum];
+}
+
+#pragma mark - NSCopying
+- (id)copyWithZone:(NSZone *)zone {
+    
+    DHMambaHistogram *copy = [[DHMambaHistogram allocWithZone:zone] init];
+    copy->_count = _count;
+    copy->_total = _total;
+    copy->_minimum = _minimum;
+    copy->_maximum = _maximum;
+    memcpy(copy->_bucketCounts, _bucketCounts, sizeof(_bucketCounts));
+    return copy;
+}
+
+@end
+
+@implementation DHMambaMetrics
+
+#pragma mark - Public Methods
++ (void)enable {
+    
+    [DHMambaMetrics metrics];
+    staticMetricsEnabled = YES;
+}
+
++ (void)disable {
+    staticMetricsEnabled = NO;
+}
+
++ (BOOL)enabled {
+    return staticMetricsEnabled;
+}
+
++ (NSDictionary *)snapshot {
+    
+    NSMutableDictionary *metrics = [DHMambaMetrics metrics];
+    NSMutableDictionary *snapshot = [[NSMutableDictionary alloc] init];
+    @synchronized(metrics) {
+        for ( NSString *collection in metrics ) {
+            
+            NSMutableDictionary *collectionSnapshot = [[NSMutableDictionary alloc] init];
+            NSArray *histograms = metrics[collection];
+            for ( NSUInteger metric = 0; metric < kDHMambaMetricCount; metric++ ) {
+                if ( [histograms[metric] count] > 0 ) {
+                    collectionSnapshot[[DHMambaMetrics nameOfMetric:metric]] = [histograms[metric] copy];
+                }
+            }
+            snapshot[collection] = collectionSnapshot;
+        }
+    }
+    return snapshot;
+}
+
++ (void)reset {
+    
+    NSMutableDictionary *metrics = [DHMambaMetrics metrics];
+    @synchronized(metrics) {
+        [metrics removeAllObjects];
+    }
+}
+
++ (void)setDumpInterval:(NSTimeInterval)interval block:(void (^)(NSDictionary *snapshot))block {
+    
+    @synchronized([DHMambaMetrics metrics]) {
+        
+        if ( staticDumpTimer ) {
+            dispatch_source_cancel(staticDumpTimer);
+            staticDumpTimer = nil;
+        }
+        if ( interval <= 0 || !block ) {
+            return;
+        }
+        
+        staticDumpTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
+        uint64_t nanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+        dispatch_source_set_timer(staticDumpTimer, dispatch_time(DISPATCH_TIME_NOW, nanoseconds), nanoseconds, nanoseconds / 10);
+        dispatch_source_set_event_handler(staticDumpTimer, ^{
+            block([DHMambaMetrics snapshot]);
+        });
+        dispatch_resume(staticDumpTimer);
+    }
+}
+
++ (NSString *)nameOfMetric:(DHMambaMetric)metric {
+    
+    switch ( metric ) {
+    case DHMambaMetricQueueWait:
+        return @"queueWait";
+    case DHMambaMetricExecute:
+        return @"execute";
+    case DHMambaMetricEncode:
+        return @"encode";
+    case DHMambaMetricDecode:
+        return @"decode";
+    case DHMambaMetricNotify:
+        return @"notify";
+    case DHMambaMetricRows:
+        return @"rows";
+    }
+    return nil;
+}
+
+#pragma mark - Recording
++ (CFAbsoluteTime)start {
+    return staticMetricsEnabled ? CFAbsoluteTimeGetCurrent() : 0;
+}
+
++ (void)record:(DHMambaMetric)metric collection:(NSString *)collection since:(CFAbsoluteTime)start {
+    
+    if ( start == 0 ) {
+        return;
+    }
+    [DHMambaMetrics record:metric collection:collection value:(CFAbsoluteTimeGetCurrent() - start) * 1000000.0];
+}
+
++ (void)record:(DHMambaMetric)metric collection:(NSString *)collection value:(double)value {
+    
+    if ( !staticMetricsEnabled ) {
+        return;
+    }
+    
+    NSMutableDictionary *metrics = [DHMambaMetrics metrics];
+    NSString *key = collection ? collection : kDHMambaMetricsStoreCollection;
+    @synchronized(metrics) {
+        
+        NSArray *histograms = metrics[key];
+        if ( !histograms ) {
+            NSMutableArray *newHistograms = [[NSMutableArray alloc] initWithCapacity:kDHMambaMetricCount];
+            for ( NSUInteger index = 0; index < kDHMambaMetricCount; index++ ) {
+                [newHistograms addObject:[[DHMambaHistogram alloc] init]];
+            }
+            histograms = newHistograms;
+            metrics[key] = histograms;
+        }
+        [histograms[metric] addValue:value];
+    }
+}
+
+#pragma mark - Private Methods
++ (NSMutableDictionary *)metrics {
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        staticMetrics = [[NSMutableDictionary alloc] init];
+    });
+    return staticMetrics;
+}
+
+@end
@@ -0,0 +1,65 @@
+//
+//  DHMambaObjectCache.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** A cache that keeps the most recently used objects, up to a count. Looking
+ * an object up or setting it makes it the most recently used, and once the
+ * cache is full setting a new object evicts the least recently used one. It
+ * isn't thread safe, callers hold their own lock.
+ */
+@interface DHMambaObjectCache : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) NSUInteger countLimit;
+@property (nonatomic,readonly) NSUInteger count;
+
+#pragma mark - Initialization
+
+/** Creates an empty cache.
+ * @param countLimit The maximum number of objects to keep
+ * @return The cache
+ */
+- (id)initWithCountLimit:(NSUInteger)countLimit;
+
+#pragma mark - Public Methods
+
+/** Looks up an object, making it the most recently used.
+ * @param key The key the object was set with
+ * @return The object, or nil
+ */
+- (id)objectForKey:(id)key;
+
+/** Adds or replaces an object, making it the most recently used.
+ * @param object The object to cache
+ * @param key The key to find it with
+ */
+- (void)setObject:(id)object forKey:(id<NSCopying>)key;
+
+- (void)removeObjectForKey:(id)key;
+- (void)removeAllObjects;
+
+@end
@@ -0,0 +1,149 @@
+//
+//  DHMambaObjectCache.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaObjectCache.h"
+
+// One cached object, linked from the most to the least recently used
+@interface DHMambaObjectCacheEntry : NSObject
+
+@property (nonatomic,strong) id key;
+@property (nonatomic,strong) id object;
+@property (nonatomic,strong) DHMambaObjectCacheEntry *next;
+@property (nonatomic,weak) DHMambaObjectCacheEntry *previous;
+
+@end
+
+@implementation DHMambaObjectCacheEntry
+
+@end
+
+@interface DHMambaObjectCache()
+
+@property (nonatomic,strong) NSMutableDictionary *entries;
+@property (nonatomic,strong) DHMambaObjectCacheEntry *head;
+@property (nonatomic,weak) DHMambaObjectCacheEntry *tail;
+
+@end
+
+@implementation DHMambaObjectCache
+
+#pragma mark - Initialization
+- (id)initWithCountLimit:(NSUInteger)countLimit {
+    
+    if ( self = [super init] ) {
+        _countLimit = MAX(countLimit, 1);
+        _entries = [[NSMutableDictionary alloc] initWithCapacity:_countLimit];
+    }
+    return self;
+}
+
+#pragma mark - Public Methods
+- (NSUInteger)count {
+    
+    return self.entries.count;
+}
+
+- (id)objectForKey:(id)key {
+    
+    DHMambaObjectCacheEntry *entry = self.entries[key];
+    if ( !entry ) {
+        return nil;
+    }
+    [self unlinkEntry:entry];
+    [self pushEntry:entry];
+    return entry.object;
+}
+
+- (void)setObject:(id)object forKey:(id<NSCopying>)key {
+    
+    DHMambaObjectCacheEntry *entry = self.entries[key];
+    if ( entry ) {
+        [self unlinkEntry:entry];
+    }
+    else {
+        entry = [[DHMambaObjectCacheEntry alloc] init];
+        entry.key = key;
+        self.entries[key] = entry;
+    }
+    entry.object = object;
+    [self pushEntry:entry];
+    
+    while ( self.entries.count > self.countLimit ) {
+        DHMambaObjectCacheEntry *evicted = self.tail;
+        [self unlinkEntry:evicted];
+        [self.entries removeObjectForKey:evicted.key];
+    }
+}
+
+- (void)removeObjectForKey:(id)key {
+    
+    DHMambaObjectCacheEntry *entry = self.entries[key];
+    if ( entry ) {
+        [self unlinkEntry:entry];
+        [self.entries removeObjectForKey:key];
+    }
+}
+
+- (void)removeAllObjects {
+    
+    // Unlink one at a time so a long list isn't released recursively
+    while ( self.head ) {
+        [self unlinkEntry:self.head];
+    }
+    [self.entries removeAllObjects];
+}
+
+#pragma mark - Private Methods
+- (void)pushEntry:(DHMambaObjectCacheEntry *)entry {
+    
+    entry.next = self.head;
+    entry.previous = nil;
+    self.head.previous = entry;
+    self.head = entry;
+    if ( !self.tail ) {
+        self.tail = entry;
+    }
+}
+
+- (void)unlinkEntry:(DHMambaObjectCacheEntry *)entry {
+    
+    if ( entry.previous ) {
+        entry.previous.next = entry.next;
+    }
+    else {
+        self.head = entry.next;
+    }
+    if ( entry.next ) {
+        entry.next.previous = entry.previous;
+    }
+    else {
+        self.tail = entry.previous;
+    }
+    entry.next = nil;
+    entry.previous = nil;
+}
+
+@end
@@ -0,0 +1,140 @@
+//
+//  DHMambaQuery.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** A condition on the columns of a collection. Only the built in columns
+ * (objID, objKey, objForeignKey, objTitle, orderNumber, createTime,
+ * updateTime) and indexed properties can be used. Values are always passed
+ * to SQLite as arguments, never put in the SQL.
+ */
+@interface DHMambaCondition : NSObject
+
+#pragma mark - Public Methods
+
+/** Matches rows where the column equals the value. A nil value matches nulls. */
++ (instancetype)column:(NSString *)column equalTo:(id)value;
+
+/** Matches rows where the column doesn't equal the value. A nil value matches non nulls. */
++ (instancetype)column:(NSString *)column notEqualTo:(id)value;
+
++ (instancetype)column:(NSString *)column lessThan:(id)value;
++ (instancetype)column:(NSString *)column lessThanOrEqualTo:(id)value;
++ (instancetype)column:(NSString *)column greaterThan:(id)value;
++ (instancetype)column:(NSString *)column greaterThanOrEqualTo:(id)value;
+
+/** Matches rows where the column equals one of the values. */
++ (instancetype)column:(NSString *)column inValues:(NSArray *)values;
+
+/** Matches rows where the column is between the two values, including both. */
++ (instancetype)column:(NSString *)column from:(id)from to:(id)to;
+
+/** Matches rows where the column is like an SQL pattern (% and _). */
++ (instancetype)column:(NSString *)column like:(NSString *)pattern;
+
++ (instancetype)columnIsNull:(NSString *)column;
++ (instancetype)columnIsNotNull:(NSString *)column;
+
+/** Matches rows that match all the conditions. No conditions matches every row. */
++ (instancetype)allOf:(NSArray *)conditions;
+
+/** Matches rows that match any of the conditions. No conditions matches no rows. */
++ (instancetype)anyOf:(NSArray *)conditions;
+
+/** Matches rows that match none of the conditions. */
++ (instancetype)noneOf:(NSArray *)conditions;
+
+/** Translates a predicate into a condition. Supports AND, OR and NOT,
+ * comparisons (==, !=, <, <=, >, >=), IN, BETWEEN, LIKE, BEGINSWITH,
+ * ENDSWITH and CONTAINS between a column key path and constant values,
+ * along with the [c] option. Case insensitive matching only folds ASCII
+ * letters, the way SQLite does.
+ * @param predicate The predicate
+ * @return The condition, or nil if the predicate can't be translated
+ */
++ (instancetype)conditionWithPredicate:(NSPredicate *)predicate;
+
+/** The columns the condition uses */
+- (NSSet *)columns;
+
+/** Returns the SQL for the condition.
+ * @param arguments The values for the SQL's ? placeholders are added to this
+ * @return The SQL
+ */
+- (NSString *)sqlAddingArguments:(NSMutableArray *)arguments;
+
+@end
+
+/** A query on one class. Queries with the same shape compile to the same SQL,
+ * whatever the values, so SQLite's prepared statements are reused.
+ */
+@interface DHMambaQuery : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) Class objectClass;
+
+/** The rows to return, or nil for all of them */
+@property (nonatomic,strong) DHMambaCondition *condition;
+
+/** The maximum number of rows, or 0 for all of them */
+@property (nonatomic,assign) NSUInteger limit;
+
+/** The number of rows to skip */
+@property (nonatomic,assign) NSUInteger offset;
+
+/** The order, as an array of @[column, descending] pairs */
+@property (nonatomic,readonly) NSArray *orderings;
+
+#pragma mark - Public Methods
+
+/** Creates a query for every object of a class.
+ * @param objectClass The class to search
+ * @return The query
+ */
++ (instancetype)queryForClass:(Class)objectClass;
+
+/** Creates a query.
+ * @param objectClass The class to search
+ * @param condition The rows to return, or nil for all of them
+ * @return The query
+ */
++ (instancetype)queryForClass:(Class)objectClass condition:(DHMambaCondition *)condition;
+
+/** Adds a column to the order. Rows that tie on every column are ordered by
+ * objID so paging with an offset is stable.
+ * @param column The column
+ * @param descending YES to order from highest to lowest
+ */
+- (void)orderBy:(NSString *)column descending:(BOOL)descending;
+
+/** Compiles the query.
+ * @param columns The SQL column list to select, such as *
+ * @param arguments Set to the values for the SQL's ? placeholders
+ * @return The SQL, or nil if the query uses a column that can't be searched
+ */
+- (NSString *)sqlSelecting:(NSString *)columns arguments:(NSArray **)arguments;
+
+@end
@@ -0,0 +1,496 @@
+//
+//  DHMambaQuery.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaQuery.h"
+#import "DHMambaCollection.h"
+
+typedef NS_ENUM(NSInteger, DHMambaConditionType) {
+    DHMambaConditionTypeCompare,
+    DHMambaConditionTypeIn,
+    DHMambaConditionTypeBetween,
+    DHMambaConditionTypeIsNull,
+    DHMambaConditionTypeIsNotNull,
+    DHMambaConditionTypeAll,
+    DHMambaConditionTypeAny,
+    DHMambaConditionTypeNone
+};
+
+//
+// Turns a string into a LIKE pattern, escaped with \. With wildcards, the *
+// and ? of an NSPredicate LIKE pattern become % and _, and \ escapes the next
+// character. Without, every character is matched as is.
+//
+static NSString *DHMambaLikePattern(NSString *string, BOOL wildcards) {
+    
+    NSMutableString *pattern = [[NSMutableString alloc] initWithCapacity:string.length];
+    for ( NSUInteger index = 0; index < string.length; index++ ) {
+        
+        unichar character = [string characterAtIndex:index];
+        if ( wildcards && character == '\\' && index + 1 < string.length ) {
+            character = [string characterAtIndex:++index];
+        }
+        else if ( wildcards && character == '*' ) {
+            [pattern appendString:@"%"];
+            continue;
+        }
+        else if ( wildcards && character == '?' ) {
+            [pattern appendString:@"_"];
+            continue;
+        }
+        
+        if ( character == '%' || character == '_' || character == '\\' ) {
+            [pattern appendString:@"\\"];
+        }
+        [pattern appendFormat:@"%C",character];
+    }
+    return pattern;
+}
+
+//
+// The same for GLOB, which is case sensitive and already uses * and ?.
+// GLOB has no escape character, so literal wildcards go in brackets.
+//
+static NSString *DHMambaGlobPattern(NSString *string, BOOL wildcards) {
+    
+    NSMutableString *pattern = [[NSMutableString alloc] initWithCapacity:string.length];
+    for ( NSUInteger index = 0; index < string.length; index++ ) {
+        
+        unichar character = [string characterAtIndex:index];
+        if ( wildcards && character == '\\' && index + 1 < string.length ) {
+            character = [string characterAtIndex:++index];
+        }
+        else if ( wildcards && ( character == '*' || character == '?' ) ) {
+            [pattern appendFormat:@"%C",character];
+            continue;
+        }
+        
+        if ( character == '*' || character == '?' || character == '[' ) {
+            [pattern appendFormat:@"[%C]",character];
+        }
+        else {
+            [pattern appendFormat:@"%C",character];
+        }
+    }
+    return pattern;
+}
+
+@interface DHMambaCondition()
+
+@property (nonatomic,assign) DHMambaConditionType type;
+@property (nonatomic,strong) NSString *column;
+@property (nonatomic,strong) NSString *sqlOperator;
+@property (nonatomic,strong) NSArray *values;
+@property (nonatomic,strong) NSArray *conditions;
+@property (nonatomic,assign) BOOL caseInsensitive;
+@property (nonatomic,assign) BOOL escaped;
+
+@end
+
+@implementation DHMambaCondition
+
+#pragma mark - Public Methods
++ (instancetype)column:(NSString *)column equalTo:(id)value {
+    return value ? [self column:column operator:@"=" value:value] : [self columnIsNull:column];
+}
+
++ (instancetype)column:(NSString *)column notEqualTo:(id)value {
+    return value ? [self column:column operator:@"<>" value:value] : [self columnIsNotNull:column];
+}
+
++ (instancetype)column:(NSString *)column lessThan:(id)value {
+    return [self column:column operator:@"<" value:value];
+}
+
++ (instancetype)column:(NSString *)column lessThanOrEqualTo:(id)value {
+    return [self column:column operator:@"<=" value:value];
+}
+
++ (instancetype)column:(NSString *)column greaterThan:(id)value {
+    return [self column:column operator:@">" value:value];
+}
+
++ (instancetype)column:(NSString *)column greaterThanOrEqualTo:(id)value {
+    return [self column:column operator:@">=" value:value];
+}
+
++ (instancetype)column:(NSString *)column inValues:(NSArray *)values {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeIn;
+    condition.column = column;
+    condition.values = values ? [values copy] : @[];
+    return condition;
+}
+
++ (instancetype)column:(NSString *)column from:(id)from to:(id)to {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeBetween;
+    condition.column = column;
+    condition.values = @[from ? from : [NSNull null],to ? to : [NSNull null]];
+    return condition;
+}
+
++ (instancetype)column:(NSString *)column like:(NSString *)pattern {
+    return [self column:column operator:@"like" value:pattern];
+}
+
++ (instancetype)columnIsNull:(NSString *)column {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeIsNull;
+    condition.column = column;
+    return condition;
+}
+
++ (instancetype)columnIsNotNull:(NSString *)column {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeIsNotNull;
+    condition.column = column;
+    return condition;
+}
+
++ (instancetype)allOf:(NSArray *)conditions {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeAll;
+    condition.conditions = conditions ? [conditions copy] : @[];
+    return condition;
+}
+
++ (instancetype)anyOf:(NSArray *)conditions {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeAny;
+    condition.conditions = conditions ? [conditions copy] : @[];
+    return condition;
+}
+
++ (instancetype)noneOf:(NSArray *)conditions {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeNone;
+    condition.conditions = @[[self anyOf:conditions]];
+    return condition;
+}
+
++ (instancetype)conditionWithPredicate:(NSPredicate *)predicate {
+    
+    if ( [predicate isKindOfClass:[NSCompoundPredicate class]] ) {
+        
+        NSCompoundPredicate *compound = (NSCompoundPredicate *)predicate;
+        NSMutableArray *conditions = [[NSMutableArray alloc] init];
+        for ( NSPredicate *subpredicate in compound.subpredicates ) {
+            DHMambaCondition *condition = [self conditionWithPredicate:subpredicate];
+            if ( !condition ) {
+                return nil;
+            }
+            [conditions addObject:condition];
+        }
+        
+        switch ( compound.compoundPredicateType ) {
+        case NSNotPredicateType:
+            return [self noneOf:conditions];
+        case NSAndPredicateType:
+            return [self allOf:conditions];
+        case NSOrPredicateType:
+            return [self anyOf:conditions];
+        }
+    }
+    else if ( [predicate isKindOfClass:[NSComparisonPredicate class]] ) {
+        return [self conditionWithComparison:(NSComparisonPredicate *)predicate];
+    }
+    else if ( [predicate isEqual:[NSPredicate predicateWithValue:YES]] ) {
+        return [self allOf:@[]];
+    }
+    else if ( [predicate isEqual:[NSPredicate predicateWithValue:NO]] ) {
+        return [self anyOf:@[]];
+    }
+    
+    NSLog(@"Error: can't turn predicate %@ into a query",predicate);
+    return nil;
+}
+
+- (NSSet *)columns {
+    
+    NSMutableSet *columns = [[NSMutableSet alloc] init];
+    if ( self.column ) {
+        [columns addObject:self.column];
+    }
+    for ( DHMambaCondition *condition in self.conditions ) {
+        [columns unionSet:[condition columns]];
+    }
+    return columns;
+}
+
+- (NSString *)sqlAddingArguments:(NSMutableArray *)arguments {
+    
+    NSString *column = [NSString stringWithFormat:self.caseInsensitive ? @"\"%@\" collate nocase" : @"\"%@\"",self.column];
+    switch ( self.type ) {
+    case DHMambaConditionTypeCompare:
+        [arguments addObject:self.values[0]];
+        return [NSString stringWithFormat:@"%@ %@ ?%@",column,self.sqlOperator,self.escaped ? @" escape '\\'" : @""];
+        
+    case DHMambaConditionTypeIn: {
+        if ( self.values.count == 0 ) {
+            return @"0";
+        }
+        NSMutableArray *placeholders = [[NSMutableArray alloc] initWithCapacity:self.values.count];
+        for ( id value in self.values ) {
+            [arguments addObject:value];
+            [placeholders addObject:@"?"];
+        }
+        return [NSString stringWithFormat:@"%@ in (%@)",column,[placeholders componentsJoinedByString:@", "]];
+    }
+        
+    case DHMambaConditionTypeBetween:
+        [arguments addObjectsFromArray:self.values];
+        return [NSString stringWithFormat:@"%@ between ? and ?",column];
+        
+    case DHMambaConditionTypeIsNull:
+        return [NSString stringWithFormat:@"%@ is null",column];
+        
+    case DHMambaConditionTypeIsNotNull:
+        return [NSString stringWithFormat:@"%@ is not null",column];
+        
+    case DHMambaConditionTypeAll:
+    case DHMambaConditionTypeAny: {
+        if ( self.conditions.count == 0 ) {
+            return self.type == DHMambaConditionTypeAll ? @"1" : @"0";
+        }
+        if ( self.conditions.count == 1 ) {
+            return [self.conditions[0] sqlAddingArguments:arguments];
+        }
+        NSMutableArray *terms = [[NSMutableArray alloc] initWithCapacity:self.conditions.count];
+        for ( DHMambaCondition *condition in self.conditions ) {
+            [terms addObject:[condition sqlAddingArguments:arguments]];
+        }
+        return [NSString stringWithFormat:@"(%@)",[terms componentsJoinedByString:self.type == DHMambaConditionTypeAll ? @" and " : @" or "]];
+    }
+        
+    case DHMambaConditionTypeNone:
+        return [NSString stringWithFormat:@"not (%@)",[self.conditions[0] sqlAddingArguments:arguments]];
+    }
+}
+
+#pragma mark - Private Methods
++ (instancetype)column:(NSString *)column operator:(NSString *)sqlOperator value:(id)value {
+    
+    DHMambaCondition *condition = [[self alloc] init];
+    condition.type = DHMambaConditionTypeCompare;
+    condition.column = column;
+    condition.sqlOperator = sqlOperator;
+    condition.values = @[value ? value : [NSNull null]];
+    return condition;
+}
+
++ (instancetype)column:(NSString *)column matching:(NSString *)string wildcards:(BOOL)wildcards prefix:(BOOL)prefix suffix:(BOOL)suffix caseInsensitive:(BOOL)caseInsensitive {
+    
+    // LIKE ignores case, GLOB doesn't
+    NSString *pattern = caseInsensitive ? DHMambaLikePattern(string,wildcards) : DHMambaGlobPattern(string,wildcards);
+    NSString *anything = caseInsensitive ? @"%" : @"*";
+    pattern = [NSString stringWithFormat:@"%@%@%@",prefix ? anything : @"",pattern,suffix ? anything : @""];
+    
+    DHMambaCondition *condition = [self column:column operator:caseInsensitive ? @"like" : @"glob" value:pattern];
+    condition.escaped = caseInsensitive;
+    return condition;
+}
+
++ (instancetype)conditionWithComparison:(NSComparisonPredicate *)comparison {
+    
+    id value = nil;
+    NSUInteger unsupportedOptions = comparison.options & ~(NSUInteger)NSCaseInsensitivePredicateOption;
+    if ( comparison.leftExpression.expressionType != NSKeyPathExpressionType ||
+         comparison.comparisonPredicateModifier != NSDirectPredicateModifier ||
+         unsupportedOptions != 0 ||
+         ![self value:&value ofExpression:comparison.rightExpression] ) {
+        NSLog(@"Error: can't turn predicate %@ into a query, only comparisons of a column with values are supported",comparison);
+        return nil;
+    }
+    
+    NSString *column = comparison.leftExpression.keyPath;
+    BOOL caseInsensitive = ( comparison.options & NSCaseInsensitivePredicateOption ) != 0;
+    DHMambaCondition *condition = nil;
+    switch ( comparison.predicateOperatorType ) {
+    case NSEqualToPredicateOperatorType:
+        condition = [self column:column equalTo:value];
+        break;
+    case NSNotEqualToPredicateOperatorType:
+        condition = [self column:column notEqualTo:value];
+        break;
+    case NSLessThanPredicateOperatorType:
+        condition = [self column:column lessThan:value];
+        break;
+    case NSLessThanOrEqualToPredicateOperatorType:
+        condition = [self column:column lessThanOrEqualTo:value];
+        break;
+    case NSGreaterThanPredicateOperatorType:
+        condition = [self column:column greaterThan:value];
+        break;
+    case NSGreaterThanOrEqualToPredicateOperatorType:
+        condition = [self column:column greaterThanOrEqualTo:value];
+        break;
+    case NSInPredicateOperatorType:
+        if ( [value isKindOfClass:[NSArray class]] ) {
+            condition = [self column:column inValues:value];
+        }
+        else if ( [value isKindOfClass:[NSSet class]] ) {
+            condition = [self column:column inValues:[value allObjects]];
+        }
+        else if ( [value isKindOfClass:[NSOrderedSet class]] ) {
+            condition = [self column:column inValues:[value array]];
+        }
+        break;
+    case NSBetweenPredicateOperatorType:
+        if ( [value isKindOfClass:[NSArray class]] && [value count] == 2 ) {
+            condition = [self column:column from:value[0] to:value[1]];
+        }
+        break;
+    case NSLikePredicateOperatorType:
+    case NSBeginsWithPredicateOperatorType:
+    case NSEndsWithPredicateOperatorType:
+    case NSContainsPredicateOperatorType:
+        if ( [value isKindOfClass:[NSString class]] ) {
+            NSPredicateOperatorType type = comparison.predicateOperatorType;
+            BOOL prefix = type == NSEndsWithPredicateOperatorType || type == NSContainsPredicateOperatorType;
+            BOOL suffix = type == NSBeginsWithPredicateOperatorType || type == NSContainsPredicateOperatorType;
+            return [self column:column matching:value wildcards:type == NSLikePredicateOperatorType prefix:prefix suffix:suffix caseInsensitive:caseInsensitive];
+        }
+        break;
+    default:
+        break;
+    }
+    
+    if ( !condition ) {
+        NSLog(@"Error: can't turn predicate %@ into a query",comparison);
+        return nil;
+    }
+    condition.caseInsensitive = caseInsensitive;
+    return condition;
+}
+
++ (BOOL)value:(id __autoreleasing *)value ofExpression:(NSExpression *)expression {
+    
+    if ( expression.expressionType == NSConstantValueExpressionType ) {
+        *value = expression.constantValue == [NSNull null] ? nil : expression.constantValue;
+        return YES;
+    }
+    if ( expression.expressionType == NSAggregateExpressionType ) {
+        NSMutableArray *values = [[NSMutableArray alloc] init];
+        for ( NSExpression *element in expression.collection ) {
+            id elementValue = nil;
+            if ( ![self value:&elementValue ofExpression:element] ) {
+                return NO;
+            }
+            [values addObject:elementValue ? elementValue : [NSNull null]];
+        }
+        *value = values;
+        return YES;
+    }
+    return NO;
+}
+
+@end
+
+@interface DHMambaQuery()
+
+@property (nonatomic,strong) NSMutableArray *orderColumns;
+
+@end
+
+@implementation DHMambaQuery
+
+#pragma mark - Public Methods
++ (instancetype)queryForClass:(Class)objectClass {
+    return [self queryForClass:objectClass condition:nil];
+}
+
++ (instancetype)queryForClass:(Class)objectClass condition:(DHMambaCondition *)condition {
+    
+    DHMambaQuery *query = [[self alloc] init];
+    query->_objectClass = objectClass;
+    query.condition = condition;
+    query.orderColumns = [[NSMutableArray alloc] init];
+    return query;
+}
+
+- (NSArray *)orderings {
+    return [self.orderColumns copy];
+}
+
+- (void)orderBy:(NSString *)column descending:(BOOL)descending {
+    [self.orderColumns addObject:@[column,[NSNumber numberWithBool:descending]]];
+}
+
+- (NSString *)sqlSelecting:(NSString *)columns arguments:(NSArray **)arguments {
+    
+    // Column names go into the SQL, so only allow real columns
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:self.objectClass];
+    NSMutableSet *usedColumns = [NSMutableSet setWithSet:self.condition ? [self.condition columns] : [NSSet set]];
+    for ( NSArray *ordering in self.orderColumns ) {
+        [usedColumns addObject:ordering[0]];
+    }
+    for ( NSString *column in usedColumns ) {
+        if ( ![collection hasColumn:column] ) {
+            NSLog(@"Error: %@ isn't a built in column or indexed property of %@",column,NSStringFromClass(self.objectClass));
+            return nil;
+        }
+    }
+    
+    NSMutableArray *queryArguments = [[NSMutableArray alloc] init];
+    NSMutableString *querySql = [NSMutableString stringWithFormat:@"select %@ from %@",columns,collection.name];
+    if ( self.condition ) {
+        [querySql appendFormat:@" where %@",[self.condition sqlAddingArguments:queryArguments]];
+    }
+    
+    if ( self.orderColumns.count > 0 ) {
+        NSMutableArray *terms = [[NSMutableArray alloc] init];
+        BOOL hasObjID = NO;
+        for ( NSArray *ordering in self.orderColumns ) {
+            [terms addObject:[NSString stringWithFormat:@"\"%@\"%@",ordering[0],[ordering[1] boolValue] ? @" desc" : @""]];
+            hasObjID = hasObjID || [ordering[0] isEqualToString:@"objID"];
+        }
+        if ( !hasObjID ) {
+            [terms addObject:@"objID"];
+        }
+        [querySql appendFormat:@" order by %@",[terms componentsJoinedByString:@", "]];
+    }
+    
+    // The limit is an argument too so it doesn't change the SQL
+    if ( self.limit > 0 || self.offset > 0 ) {
+        [querySql appendString:@" limit ? offset ?"];
+        [queryArguments addObject:[NSNumber numberWithLongLong:self.limit > 0 ? (long long)self.limit : -1]];
+        [queryArguments addObject:[NSNumber numberWithUnsignedInteger:self.offset]];
+    }
+    
+    if ( arguments ) {
+        *arguments = queryArguments;
+    }
+    return querySql;
+}
+
+@end
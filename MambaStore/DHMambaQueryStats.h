@@ -0,0 +1,74 @@
+//
+//  DHMambaQueryStats.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Timings for one SQL statement, collected while store diagnostics are on.
+ * Times only count SQLite running the statement and stepping through its
+ * rows, not the work done with each row.
+ */
+@interface DHMambaQueryStats : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) NSString *sql;
+@property (nonatomic,readonly) NSUInteger executions;
+@property (nonatomic,readonly) NSUInteger rows;
+@property (nonatomic,readonly) NSTimeInterval totalTime;
+@property (nonatomic,readonly) NSTimeInterval maximumTime;
+@property (nonatomic,readonly) NSTimeInterval averageTime;
+
+/** The number of executions over the slow query threshold */
+@property (nonatomic,readonly) NSUInteger slowExecutions;
+
+/** The EXPLAIN QUERY PLAN details (NSString), captured the first time the
+ * statement was slow. Nil if it never was.
+ */
+@property (nonatomic,readonly) NSArray *plan;
+
+/** YES if the plan reads every row of a table */
+@property (nonatomic,readonly) BOOL fullTableScan;
+
+#pragma mark - Public Methods
+- (id)initWithSQL:(NSString *)sql;
+
+/** Adds an execution. Called by the store.
+ * @param time Seconds the statement took
+ * @param rows The number of rows it returned
+ * @param slow YES if it was over the slow query threshold
+ */
+- (void)addExecutionWithTime:(NSTimeInterval)time rows:(NSUInteger)rows slow:(BOOL)slow;
+
+/** Sets the query plan. Called by the store.
+ * @param plan The plan details
+ */
+- (void)setPlan:(NSArray *)plan;
+
+/** Returns the stats as property list values, for logging or sending off.
+ * @return The stats
+ */
+- (NSDictionary *)dictionaryRepresentation;
+
+@end
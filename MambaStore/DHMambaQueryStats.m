@@ -0,0 +1,93 @@
+//
+//  DHMambaQueryStats.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaQueryStats.h"
+
+@implementation DHMambaQueryStats
+
+#pragma mark - Public Methods
+- (id)initWithSQL:(NSString *)sql {
+    
+    if ( (self = [super init]) ) {
+        _sql = [sql copy];
+    }
+    return self;
+}
+
+- (NSTimeInterval)averageTime {
+    return self.executions > 0 ? self.totalTime / self.executions : 0;
+}
+
+- (void)addExecutionWithTime:(NSTimeInterval)time rows:(NSUInteger)rows slow:(BOOL)slow {
+    
+    _executions++;
+    _rows += rows;
+    _totalTime += time;
+    _maximumTime = MAX(_maximumTime, time);
+    if ( slow ) {
+        _slowExecutions++;
+    }
+}
+
+- (void)setPlan:(NSArray *)plan {
+    
+    _plan = [plan copy];
+    
+    // SCAN without an index is a full table scan. Full text tables show up
+    // as a VIRTUAL TABLE INDEX, and constant rows don't read a table at all.
+    _fullTableScan = NO;
+    for ( NSString *detail in _plan ) {
+        if ( [detail hasPrefix:@"SCAN"] &&
+             [detail rangeOfString:@"INDEX"].location == NSNotFound &&
+             [detail rangeOfString:@"CONSTANT ROW"].location == NSNotFound ) {
+            _fullTableScan = YES;
+        }
+    }
+}
+
+- (NSDictionary *)dictionaryRepresentation {
+    
+    NSMutableDictionary *stats = [[NSMutableDictionary alloc] init];
+    stats[@"sql"] = self.sql;
+    stats[@"executions"] = [NSNumber numberWithUnsignedInteger:self.executions];
+    stats[@"rows"] = [NSNumber numberWithUnsignedInteger:self.rows];
+    stats[@"totalTime"] = [NSNumber numberWithDouble:self.totalTime];
+    stats[@"maximumTime"] = [NSNumber numberWithDouble:self.maximumTime];
+    stats[@"averageTime"] = [NSNumber numberWithDouble:self.averageTime];
+    stats[@"slowExecutions"] = [NSNumber numberWithUnsignedInteger:self.slowExecutions];
+    stats[@"fullTableScan"] = [NSNumber numberWithBool:self.fullTableScan];
+    if ( self.plan ) {
+        stats[@"plan"] = self.plan;
+    }
+    return stats;
+}
+
+- (NSString *)description {
+    
+    return [NSString stringWithFormat:@"%@: %lu runs, %lu rows, %.2f ms average, %.2f ms max%@",self.sql,(unsigned long)self.executions,(unsigned long)self.rows,self.averageTime * 1000.0,self.maximumTime * 1000.0,self.fullTableScan ? @", full table scan" : @""];
+}
+
+@end
@@ -0,0 +1,78 @@
+//
+//  DHMambaRelationship.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+/** Describes a parent/child relationship. The parent keeps its children in an
+ * array property, and each child stores its parent's key in a foreign key
+ * column. Children are loaded for a whole set of parents with one query, and
+ * saved and deleted along with their parent in a single transaction.
+ */
+@interface DHMambaRelationship : NSObject
+
+#pragma mark - Properties
+@property (nonatomic,readonly) NSString *name;
+@property (nonatomic,readonly) Class childClass;
+@property (nonatomic,readonly) NSString *foreignKey;
+
+#pragma mark - Public Methods
+
+/** Creates a relationship where the children keep the parent's key in
+ * objForeignKey. The child class should implement setMambaObjectForeignKey:.
+ * @param name The parent property holding the array of children
+ * @param childClass The class of the children
+ * @return The relationship
+ */
++ (instancetype)relationshipNamed:(NSString *)name childClass:(Class)childClass;
+
+/** Creates a relationship where the children keep the parent's key in one of
+ * their indexed properties (see mambaObjectIndexedProperties).
+ * @param name The parent property holding the array of children
+ * @param childClass The class of the children
+ * @param foreignKey objForeignKey, or the child property holding the parent's key
+ * @return The relationship
+ */
++ (instancetype)relationshipNamed:(NSString *)name childClass:(Class)childClass foreignKey:(NSString *)foreignKey;
+
+/** Returns the children of a parent.
+ * @param parent The parent object
+ * @return The children, or an empty array
+ */
+- (NSArray *)childrenOfParent:(id)parent;
+
+/** Replaces the children of a parent.
+ * @param children The children
+ * @param parent The parent object
+ */
+- (void)setChildren:(NSArray *)children ofParent:(id)parent;
+
+/** Points a child at its parent by setting its foreign key.
+ * @param parent The parent object
+ * @param child The child object
+ */
+- (void)setParent:(id)parent ofChild:(id)child;
+
+@end
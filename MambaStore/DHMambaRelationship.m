@@ -0,0 +1,80 @@
+//
+//  DHMambaRelationship.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaRelationship.h"
+#import "NSObject+DHMambaObject.h"
+
+@implementation DHMambaRelationship
+
+#pragma mark - Initialization
+- (id)initWithName:(NSString *)name childClass:(Class)childClass foreignKey:(NSString *)foreignKey {
+    
+    if ( self = [super init] ) {
+        _name = [name copy];
+        _childClass = childClass;
+        _foreignKey = foreignKey ? [foreignKey copy] : @"objForeignKey";
+    }
+    return self;
+}
+
+#pragma mark - Public Methods
++ (instancetype)relationshipNamed:(NSString *)name childClass:(Class)childClass {
+    
+    return [[DHMambaRelationship alloc] initWithName:name childClass:childClass foreignKey:nil];
+}
+
++ (instancetype)relationshipNamed:(NSString *)name childClass:(Class)childClass foreignKey:(NSString *)foreignKey {
+    
+    return [[DHMambaRelationship alloc] initWithName:name childClass:childClass foreignKey:foreignKey];
+}
+
+- (NSArray *)childrenOfParent:(id)parent {
+    
+    id children = [parent valueForKey:self.name];
+    return [children isKindOfClass:[NSArray class]] ? children : @[];
+}
+
+- (void)setChildren:(NSArray *)children ofParent:(id)parent {
+    
+    // Mutable so callers can keep adding children to a loaded parent
+    [parent setValue:[children mutableCopy] forKey:self.name];
+}
+
+- (void)setParent:(id)parent ofChild:(id)child {
+    
+    NSString *parentKey = [parent MB_objKey];
+    if ( ![self.foreignKey isEqualToString:@"objForeignKey"] ) {
+        [child setValue:parentKey forKey:self.foreignKey];
+    }
+    else if ( [child respondsToSelector:@selector(setMambaObjectForeignKey:)] ) {
+        [child performSelector:@selector(setMambaObjectForeignKey:) withObject:parentKey];
+    }
+    else {
+        NSLog(@"Can't set the foreign key of %@ for %@, it doesn't implement setMambaObjectForeignKey:",NSStringFromClass([child class]),self.name);
+    }
+}
+
+@end
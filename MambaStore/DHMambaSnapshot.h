@@ -0,0 +1,78 @@
+//
+//  DHMambaSnapshot.h
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class DHMambaAccessPlan;
+
+/** What an object looked like the last time it was loaded or saved. Kept by
+ * collections that track changes, so a save can tell which columns and
+ * properties are different from the stored row without reading it.
+ */
+@interface DHMambaSnapshot : NSObject
+
+#pragma mark - Properties
+
+/** The values of the collection's tracked columns, NSNull for nil. */
+@property (nonatomic,readonly) NSArray *columnValues;
+@property (nonatomic,readonly) uint64_t bodyDigest;
+
+/** One digest per field of the class's DHMambaAccessPlan, or nil if the body
+ * isn't encoded by DHMambaCoder.
+ */
+@property (nonatomic,readonly) NSData *fieldDigests;
+
+#pragma mark - Public Methods
+
+/** Creates a snapshot.
+ * @param columnValues The values of the tracked columns
+ * @param body The stored body
+ * @param fieldDigests The field digests from DHMambaCoder, or nil
+ * @return The snapshot
+ */
+- (id)initWithColumnValues:(NSArray *)columnValues body:(NSData *)body fieldDigests:(NSData *)fieldDigests;
+
+/** Returns the indexes of the columns whose values are different.
+ * @param previous The snapshot to compare with
+ * @return The indexes into columnValues
+ */
+- (NSIndexSet *)columnsChangedFrom:(DHMambaSnapshot *)previous;
+
+/** Checks if the body is different.
+ * @param previous The snapshot to compare with
+ * @return YES if the body changed
+ */
+- (BOOL)bodyChangedFrom:(DHMambaSnapshot *)previous;
+
+/** Returns the properties whose values are different. Without field digests
+ * every property is assumed to have changed when the body did.
+ * @param previous The snapshot to compare with
+ * @param plan The access plan of the object's class
+ * @return The names of the changed properties
+ */
+- (NSSet *)propertiesChangedFrom:(DHMambaSnapshot *)previous plan:(DHMambaAccessPlan *)plan;
+
+@end
@@ -0,0 +1,83 @@
+//
+//  DHMambaSnapshot.m
+//  
+//
+//  Created by David House on 10/17/26.
+//  Copyright (c) 2014 David House <davidahouse@gmail.com>
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to
+//  deal in the Software without restriction, including without limitation the
+//  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+//  sell copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+//  FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+//  DEALINGS IN THE SOFTWARE.
+//
+
+#import "DHMambaSnapshot.h"
+#import "DHMambaAccessPlan.h"
+#import "DHMambaCoder.h"
+
+@implementation DHMambaSnapshot
+
+#pragma mark - Initialization
+- (id)initWithColumnValues:(NSArray *)columnValues body:(NSData *)body fieldDigests:(NSData *)fieldDigests {
+    
+    if ( self = [super init] ) {
+        _columnValues = [columnValues copy];
+        _bodyDigest = [DHMambaCoder digestOfData:body];
+        _fieldDigests = [fieldDigests copy];
+    }
+    return self;
+}
+
+#pragma mark - Public Methods
+- (NSIndexSet *)columnsChangedFrom:(DHMambaSnapshot *)previous {
+    
+    NSMutableIndexSet *changed = [[NSMutableIndexSet alloc] init];
+    [self.columnValues enumerateObjectsUsingBlock:^(id value, NSUInteger index, BOOL *stop) {
+        if ( index >= previous.columnValues.count || ![value isEqual:previous.columnValues[index]] ) {
+            [changed addIndex:index];
+        }
+    }];
+    return changed;
+}
+
+- (BOOL)bodyChangedFrom:(DHMambaSnapshot *)previous {
+    
+    return self.bodyDigest != previous.bodyDigest;
+}
+
+- (NSSet *)propertiesChangedFrom:(DHMambaSnapshot *)previous plan:(DHMambaAccessPlan *)plan {
+    
+    if ( ![self bodyChangedFrom:previous] ) {
+        return [NSSet set];
+    }
+    
+    NSUInteger fieldCount = plan.fieldCount;
+    if ( self.fieldDigests.length != fieldCount * sizeof(uint64_t) || previous.fieldDigests.length != fieldCount * sizeof(uint64_t) ) {
+        return [NSSet setWithArray:plan.propertyNames];
+    }
+    
+    const uint64_t *digests = [self.fieldDigests bytes];
+    const uint64_t *previousDigests = [previous.fieldDigests bytes];
+    NSMutableSet *changed = [[NSMutableSet alloc] init];
+    for ( NSUInteger index = 0; index < fieldCount; index++ ) {
+        if ( digests[index] != previousDigests[index] ) {
+            [changed addObject:plan.fields[index].name];
+        }
+    }
+    return changed;
+}
+
+@end
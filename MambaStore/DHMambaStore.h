@@ -27,28 +27,209 @@
 #import <Foundation/Foundation.h>
 #import "FMDatabase.h"
 #import "NSObject+DHMambaObject.h"
+#import "DHMambaChangeSet.h"
 
+/** Posted after objects are written or deleted, with the class as the object.
+ * The userInfo has the operation (insert, update or delete) and the objIDs
+ * written, under the objects key. Notifications for a single object also have
+ * its objID under the object key. Batches, from saveObjects, MB_saveAll and
+ * write behind, only have the objects key.
+ */
 static NSString *const kDHMambaStoreNotification = @"DHMambaStoreNotification";
+static NSString *const kDHMambaStoreNotificationOperationKey = @"operation";
+static NSString *const kDHMambaStoreNotificationObjectKey = @"object";
+static NSString *const kDHMambaStoreNotificationObjectsKey = @"objects";
+static NSString *const kDHMambaStoreChangesNotification = @"DHMambaStoreChangesNotification";
 
 @interface DHMambaStore : NSObject
 
 #pragma mark - Open/Close Methods
 + (void)openStore;
 + (void)openStore:(NSString *)storeName;
++ (void)openStore:(NSString *)storeName maximumReaders:(NSUInteger)maximumReaders;
 + (void)openStoreWithPath:(NSString *)storePath;
++ (void)openStoreWithPath:(NSString *)storePath maximumReaders:(NSUInteger)maximumReaders;
 + (void)closeStore;
 + (void)removeStore;
 + (void)removeStore:(NSString *)storeName;
 + (void)removeStoreWithPath:(NSString *)storePath;
 
 #pragma mark - Collection methods
+
+/** Creates the table for a class and brings its indexes up to date. Indexed
+ * properties that are new to the collection are filled in from the stored
+ * objects before this returns, so call it on a background queue to open a
+ * large collection ahead of time. It only does anything the first time, and
+ * other callers for the same class wait for it.
+ * @param docClass The class of the collection
+ */
++ (void)createCollectionIfDoesntExist:(Class)docClass;
 + (void)emptyCollection:(NSString *)collection;
 + (void)insertObject:(id)object;
++ (void)insertObjects:(NSArray *)objects;
 + (void)updateObject:(id)object;
++ (void)updateObjects:(NSArray *)objects;
 + (void)deleteObject:(id)object;
 
+/** Deletes objects of any classes in a single transaction.
+ * @param objects The objects to delete
+ */
++ (void)deleteObjects:(NSArray *)objects;
+
 #pragma mark - Query methods
 + (void)selectFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit resultBlock:(void (^)(FMResultSet *results))resultBlock;
+
+/** Selects some columns instead of whole rows.
+ * @param columns The SQL column list
+ * @param collection The collection to select from
+ * @param whereClause The criteria, or an empty string
+ * @param parameters The values for the named parameters in the criteria
+ * @param orderBy The order of the rows
+ * @param limit The maximum number of rows, or 0 for all of them
+ * @param resultBlock Called for each row
+ */
++ (void)selectColumns:(NSString *)columns fromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit resultBlock:(void (^)(FMResultSet *results))resultBlock;
++ (void)selectFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit offset:(NSUInteger)offset resultBlock:(void (^)(FMResultSet *results))resultBlock;
++ (NSString *)selectPageFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit after:(NSString *)token resultBlock:(void (^)(FMResultSet *results))resultBlock;
++ (void)selectWithSQL:(NSString *)querySql arguments:(NSArray *)arguments resultBlock:(void (^)(FMResultSet *results))resultBlock;
++ (void)selectWithSQL:(NSString *)querySql parameters:(NSDictionary *)parameters resultBlock:(void (^)(FMResultSet *results))resultBlock;
++ (void)selectObjectOfClass:(Class)objectClass withID:(NSString *)objID resultBlock:(void (^)(FMResultSet *results))resultBlock;
++ (void)selectObjectOfClass:(Class)objectClass withKey:(NSString *)key resultBlock:(void (^)(FMResultSet *results))resultBlock;
 + (NSNumber *)countFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters;
 
+/** Returns the column an order sorts on. Ties are broken by objID, in the same
+ * direction. Nulls sort as the smallest value, so they come first in ascending
+ * orders and last in descending ones.
+ * @param orderBy The order
+ * @return The column name
+ */
++ (NSString *)orderColumnFor:(DHMambaObjectOrderBy)orderBy;
++ (BOOL)orderIsDescending:(DHMambaObjectOrderBy)orderBy;
+
+/** Returns a page token that continues after a row.
+ * @param orderBy The order of the pages
+ * @param value The row's value in the order column
+ * @param objID The row's objID
+ * @return The token to pass to selectPageFromCollection
+ */
++ (NSString *)tokenForOrder:(DHMambaObjectOrderBy)orderBy value:(id)value objID:(NSString *)objID;
+
+#pragma mark - Write behind methods
+
+/** Turns on write behind. Saves are kept in memory and written together in one
+ * transaction every interval, once threshold objects are waiting, when flush is
+ * called, or before a read whose results could include them. Saving the same
+ * object again before it is written only writes it once. Objects are written,
+ * and their notifications posted, by the flush, so kDHMambaStoreNotification
+ * comes once per class with every objID written under the objects key.
+ * Anything still waiting from before is written first.
+ * @param interval Seconds between writes
+ * @param threshold Number of waiting objects that causes an immediate write
+ */
++ (void)enableWriteBehindWithInterval:(NSTimeInterval)interval threshold:(NSUInteger)threshold;
+
+/** Writes anything waiting and goes back to writing every save right away.
+ * Closing the store also does this.
+ */
++ (void)disableWriteBehind;
++ (BOOL)writeBehindEnabled;
+
+/** Saves objects, inserting the ones that haven't been stored yet and updating
+ * the rest. Objects whose rows have gone missing are inserted again, and new
+ * objects of classes with a unique key update the stored object with the same
+ * key. With write behind on, the objects are queued instead.
+ * @param objects The objects to save
+ * @return YES if the objects were queued, in which case mambaAfterSave is
+ * called on them once they are written
+ */
++ (BOOL)saveObjects:(NSArray *)objects;
+
+/** Saves objects of any classes in a single transaction. With write behind on,
+ * the objects are queued instead.
+ * @param objects The objects to save
+ * @param inserts The objIDs of the objects that aren't in the store yet
+ * @return YES if the objects were queued, in which case mambaAfterSave is
+ * called on them once they are written
+ */
++ (BOOL)saveObjects:(NSArray *)objects inserts:(NSSet *)inserts;
+
+/** Writes any objects waiting for write behind in one transaction, then calls
+ * mambaAfterSave on them.
+ */
++ (void)flush;
+
+/** Returns an object that is waiting to be written.
+ * @param objectClass The class of the object
+ * @param objID The object ID
+ * @return The object, or nil if it isn't waiting
+ */
++ (id)pendingObjectOfClass:(Class)objectClass withID:(NSString *)objID;
+
+/** Returns an object that is waiting to be written.
+ * @param objectClass The class of the object
+ * @param key The object key
+ * @return The object, or nil if none with the key is waiting
+ */
++ (id)pendingObjectOfClass:(Class)objectClass withKey:(NSString *)key;
+
+#pragma mark - Change notification methods
+
+/** Sets how kDHMambaStoreChangesNotification is delivered. Changes are
+ * collected as writes finish and posted later on the queue, one notification
+ * per changed class with the DHMambaChangeSet under the changes key. Observers
+ * never run while the store is held. By default changes are posted on the main
+ * queue as soon as it gets to them.
+ * @param interval Seconds to collect changes for before posting them
+ * @param queue The queue to post on, or nil for the main queue
+ */
++ (void)setChangeInterval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue;
+
+#pragma mark - Diagnostics methods
+
+/** Starts timing every query the store runs, per distinct SQL statement. The
+ * first time a statement takes longer than the threshold its EXPLAIN QUERY
+ * PLAN is captured and logged. With diagnostics off, queries aren't timed at
+ * all.
+ * @param threshold Seconds a query can take before it counts as slow
+ */
++ (void)enableDiagnosticsWithSlowQueryThreshold:(NSTimeInterval)threshold;
++ (void)disableDiagnostics;
++ (BOOL)diagnosticsEnabled;
+
+/** Returns what diagnostics have collected so far.
+ * @return An array of DHMambaQueryStats, the most total time first
+ */
++ (NSArray *)queryStats;
+
+/** Throws away what diagnostics have collected. */
++ (void)resetDiagnostics;
+
+#pragma mark - Async methods
+
+/** Runs some store work on the store's operation queue and passes its result
+ * to a completion block, never blocking the caller. Work that writes runs
+ * after everything queued before it, one at a time. Work that only reads runs
+ * after the last write queued before it, side by side with other reads.
+ * If too many operations are waiting the work isn't queued and nil is
+ * returned, see canPerformAsync.
+ * @param work The work to do. Its return value is passed to the completion.
+ * @param writes NO if the work only reads from the store
+ * @param queue The queue to call the completion on, or nil for the main queue
+ * @param completion The block to call with the result, or nil
+ * @return The operation, or nil if it wasn't queued. Cancelling it before it
+ * finishes skips the completion.
+ */
++ (NSOperation *)performAsync:(id (^)(void))work writes:(BOOL)writes queue:(dispatch_queue_t)queue completion:(void (^)(id result))completion;
+
+/** Same as performAsync:writes:queue:completion: for work that writes. */
++ (NSOperation *)performAsync:(id (^)(void))work queue:(dispatch_queue_t)queue completion:(void (^)(id result))completion;
+
+/** The number of async operations queued or running. */
++ (NSUInteger)pendingAsyncOperationCount;
+
+/** Checks if there is room to queue async work.
+ * @return NO if performAsync would turn work away
+ */
++ (BOOL)canPerformAsync;
+
 @end
@@ -26,11 +26,54 @@
 
 #import "DHMambaStore.h"
 #import "FMDatabaseQueue.h"
+#import "FMDatabasePool.h"
+#import "DHMambaCollection.h"
+#import "DHMambaChangeSet.h"
+#import "DHMambaQueryStats.h"
+#import "DHMambaMetrics.h"
 
 static FMDatabaseQueue *staticStore;
+static FMDatabasePool *staticReadPool;
+static dispatch_semaphore_t staticReadSemaphore;
+static NSHashTable *staticReadConnections;
 static NSMutableArray *staticCollectionList;
+static NSMutableDictionary *staticCollectionLocks;
 static NSMutableDictionary *staticCollectionSources;
 
+static NSOperationQueue *staticAsyncQueue;
+static NSOperation *staticAsyncLastWrite;
+static NSMutableArray *staticAsyncReads;
+static NSUInteger staticAsyncPending;
+
+// Write behind state. Pending objects are keyed by objID, the ones that
+// aren't in the store yet are listed in staticPendingInserts, and
+// staticPendingCollections counts them by collection. Everything but the
+// flush lock is guarded by the pending writes dictionary.
+static BOOL staticWriteBehind;
+static NSMutableDictionary *staticPendingWrites;
+static NSMutableSet *staticPendingInserts;
+static NSCountedSet *staticPendingCollections;
+static NSUInteger staticFlushThreshold;
+static dispatch_source_t staticFlushTimer;
+static NSObject *staticFlushLock;
+
+// Change sets waiting to be posted, keyed by class name
+static NSMutableDictionary *staticChangeSets;
+static NSTimeInterval staticChangeInterval;
+static dispatch_queue_t staticChangeQueue;
+static BOOL staticChangesScheduled;
+
+// Diagnostics, keyed by SQL
+static BOOL staticDiagnosticsEnabled;
+static NSTimeInterval staticSlowQueryThreshold;
+static NSMutableDictionary *staticQueryStats;
+
+// Number of objects written per transaction by the batch methods
+static NSUInteger const kDHMambaStoreBatchSize = 1000;
+
+// Number of async operations that can be waiting before more are turned away
+static NSUInteger const kDHMambaStoreMaximumPendingOperations = 256;
+
 @implementation DHMambaStore
 
 #pragma mark - Open/Close Methods
@@ -47,23 +90,75 @@ static NSMutableDictionary *staticCollectionSources;
     [DHMambaStore openStoreWithPath:fullPath];
 }
 
++ (void)openStore:(NSString *)storeName maximumReaders:(NSUInteger)maximumReaders {
+    
+    NSString *documentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
+    NSString *fullPath = [documentsDirectory stringByAppendingPathComponent:storeName];
+    [DHMambaStore openStoreWithPath:fullPath maximumReaders:maximumReaders];
+}
+
 + (void)openStoreWithPath:(NSString *)storePath {
     
+    [DHMambaStore openStoreWithPath:storePath maximumReaders:0];
+}
+
++ (void)openStoreWithPath:(NSString *)storePath maximumReaders:(NSUInteger)maximumReaders {
+    
     if ( staticStore ) {
         [DHMambaStore closeStore];
     }
     
     // NSLog(@"opening store at path: %@",storePath);
     staticStore = [FMDatabaseQueue databaseQueueWithPath:storePath];
+    
+    // Keep prepared statements around so the fixed per collection
+    // statements are only compiled once.
+    [staticStore inDatabase:^(FMDatabase *db) {
+        [db setShouldCacheStatements:YES];
+    }];
+    
+    if ( maximumReaders > 0 ) {
+        
+        // WAL lets the read connections run alongside the writer without
+        // blocking on each other.
+        [staticStore inDatabase:^(FMDatabase *db) {
+            FMResultSet *results = [db executeQuery:@"PRAGMA journal_mode = WAL"];
+            if ( ![results next] || ![[results stringForColumnIndex:0] isEqualToString:@"wal"] ) {
+                NSLog(@"error switching store to WAL mode: %@",[db lastErrorMessage]);
+            }
+            [results close];
+        }];
+        
+        staticReadPool = [FMDatabasePool databasePoolWithPath:storePath];
+        staticReadPool.maximumNumberOfDatabasesToCreate = maximumReaders;
+        staticReadPool.delegate = [DHMambaStore class];
+        staticReadSemaphore = dispatch_semaphore_create(maximumReaders);
+        staticReadConnections = [NSHashTable weakObjectsHashTable];
+    }
 }
 
 + (void)closeStore {
     
+    // Waiting for the queue from one of its own operations would never end
+    if ( staticAsyncQueue && [NSOperationQueue currentQueue] == staticAsyncQueue ) {
+        NSLog(@"error closing store, it can't be closed from an async operation");
+        return;
+    }
+    
+    // let anything already queued finish first
+    [staticAsyncQueue waitUntilAllOperationsAreFinished];
+    [DHMambaStore disableWriteBehind];
+    
+    [staticReadPool releaseAllDatabases];
+    staticReadPool = nil;
+    staticReadSemaphore = nil;
+    staticReadConnections = nil;
     [staticStore close];
     staticStore = nil;
-    if ( staticCollectionList ) {
+    @synchronized([DHMambaStore collectionList]) {
         [staticCollectionList removeAllObjects];
     }
+    [DHMambaCollection removeAllCachedObjectsFromCollections];
     if ( staticCollectionSources ) {
         
         for ( id key in staticCollectionSources ) {
@@ -94,167 +189,364 @@ static NSMutableDictionary *staticCollectionSources;
     
     NSError *error;
     [[NSFileManager defaultManager] removeItemAtPath:storePath error:&error];
+    
+    // Also clean up the WAL files left behind by a concurrent store
+    [[NSFileManager defaultManager] removeItemAtPath:[storePath stringByAppendingString:@"-wal"] error:&error];
+    [[NSFileManager defaultManager] removeItemAtPath:[storePath stringByAppendingString:@"-shm"] error:&error];
 }
 
 
 #pragma mark - Collection methods
 
++ (void)createCollectionIfDoesntExist:(Class)docClass {
+    
+    NSString *collection = [NSStringFromClass(docClass) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    
+    // Check if we have already created this collection, if so
+    // just return as there is nothing to do.
+    NSMutableArray *collectionList = [DHMambaStore collectionList];
+    NSObject *collectionLock = nil;
+    @synchronized(collectionList) {
+        
+        if ( [collectionList containsObject:collection] ) {
+            return;
+        }
+        collectionLock = staticCollectionLocks[collection];
+        if ( !collectionLock ) {
+            collectionLock = [[NSObject alloc] init];
+            staticCollectionLocks[collection] = collectionLock;
+        }
+    }
+    
+    // Each collection is set up once, under its own lock so filling a large
+    // one doesn't hold up the others. Everyone else using the class waits.
+    @synchronized(collectionLock) {
+        
+        @synchronized(collectionList) {
+            if ( [collectionList containsObject:collection] ) {
+                return;
+            }
+        }
+        
+        // create the table and bring its indexes up to date
+        DHMambaCollection *mambaCollection = [DHMambaCollection collectionForClass:docClass];
+        [staticStore inDatabase:^(FMDatabase *db) {
+            [mambaCollection createSchemaInDatabase:db];
+        }];
+        if ( mambaCollection.unfilledProperties.count > 0 ) {
+            [DHMambaStore fillPropertiesOfCollection:mambaCollection];
+        }
+        
+        @synchronized(collectionList) {
+            [collectionList addObject:collection];
+        }
+    }
+}
+
 + (void)emptyCollection:(NSString *)collection {
     
+    [DHMambaStore flush];
     [staticStore inDatabase:^(FMDatabase *db) {
         if ( ![db executeUpdate:[NSString stringWithFormat:@"delete from %@",collection]] ) {
             NSLog(@"error emptying collection: %@",[db lastErrorMessage]);
         }
     }];
+    
+    DHMambaCollection *mambaCollection = [DHMambaCollection existingCollectionNamed:collection];
+    [mambaCollection removeAllCachedObjects];
+    if ( mambaCollection ) {
+        [DHMambaStore recordChangesForClass:mambaCollection.objectClass usingBlock:^(DHMambaChangeSet *changes) {
+            [changes addEmptied];
+        }];
+    }
 }
 
 + (void)insertObject:(id)object {
     
-    NSString *collection = [NSStringFromClass([object class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[object class]];
+    [DHMambaStore flushIfPending:@[object]];
     [DHMambaStore createCollectionIfDoesntExist:[object class]];
 
+    NSDate *now = [NSDate date];
+    NSArray *arguments = [collection insertArgumentsForObject:object time:now];
+    
+    __block BOOL inserted = YES;
+    [DHMambaStore inWriteDatabase:^(FMDatabase *db) {
+        
+        if ( ![DHMambaStore insertObject:object arguments:arguments collection:collection database:db inserted:&inserted] ) {
+            
+            NSLog(@"error inserting data: %@",[db lastErrorMessage]);
+        }
+    }];
+    
+    // A unique key may have matched a stored object, which this one now is
     NSString *objID = [object MB_objID];
-    NSString *objKey = [object MB_objKey];
-    NSString *objForeignKey = [object MB_objForeignKey];
-    NSString *objTitle = [object MB_objTitle];
-    NSNumber *objOrderNumber = [object MB_objOrderNumber];
-    NSData *objData = [object MB_objData];
+    [object MB_setCreateTime:inserted ? now : nil updateTime:now];
+    [collection cacheSavedObject:object];
+    
+    // Post a notification so listeners can catch inserts
+    // in other parts of the code. Observers run after the
+    // database has been released.
+    if ( inserted ) {
+        [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:[object class] userInfo:@{kDHMambaStoreNotificationOperationKey:@"insert",kDHMambaStoreNotificationObjectKey:objID,kDHMambaStoreNotificationObjectsKey:@[objID]}];
+        [DHMambaStore recordChangesForClass:[object class] inserted:@[objID] updated:nil deleted:nil];
+    }
+    else {
+        [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:[object class] userInfo:@{kDHMambaStoreNotificationOperationKey:@"update",kDHMambaStoreNotificationObjectKey:objID,kDHMambaStoreNotificationObjectsKey:@[objID]}];
+        [DHMambaStore recordChangesForClass:[object class] inserted:nil updated:@[objID] deleted:nil];
+    }
+}
 
-    NSString *insertSQL = [NSString stringWithFormat:@"insert into %@ VALUES ( :objID, :objKey, :objForeignKey, :objTitle, :createTime, :updateTime, :orderNumber, :objBody )",collection];
++ (void)insertObjects:(NSArray *)objects {
     
-    [staticStore inDatabase:^(FMDatabase *db) {
+    [DHMambaStore flushIfPending:objects];
+    
+    for ( Class objectClass in [DHMambaStore classesInObjects:objects] ) {
         
-        NSDictionary *parameters = @{ @"objID": objID,
-                                      @"objKey": objKey ? objKey : [NSNull null],
-                                      @"objForeignKey" : objForeignKey ? objForeignKey : [NSNull null],
-                                      @"objTitle": objTitle ? objTitle : [NSNull null],
-                                      @"createTime":[NSNumber numberWithDouble:[[NSDate date] timeIntervalSince1970]],
-                                      @"updateTime":[NSNumber numberWithDouble:[[NSDate date] timeIntervalSince1970]],
-                                      @"orderNumber": objOrderNumber ? objOrderNumber : [NSNull null],
-                                      @"objBody": objData };
+        DHMambaCollection *collection = [DHMambaCollection collectionForClass:objectClass];
+        [DHMambaStore createCollectionIfDoesntExist:objectClass];
         
-        if ( ![db executeUpdate:insertSQL withParameterDictionary:parameters]) {
+        NSArray *classObjects = [DHMambaStore objects:objects ofClass:objectClass];
+        NSMutableArray *objIDs = [[NSMutableArray alloc] initWithCapacity:classObjects.count];
+        NSMutableArray *updatedIDs = [[NSMutableArray alloc] init];
+        
+        [DHMambaStore inBatchesOf:classObjects block:^(NSArray *batch) {
             
-            NSLog(@"error inserting data: %@",[db lastErrorMessage]);
-        }
+            // Archive outside of the queue so the transaction only holds the
+            // database while it is writing.
+            NSMutableArray *batchArguments = [[NSMutableArray alloc] initWithCapacity:batch.count];
+            NSDate *now = [NSDate date];
+            for ( id object in batch ) {
+                [batchArguments addObject:[collection insertArgumentsForObject:object time:now]];
+            }
+            
+            NSMutableIndexSet *updated = [[NSMutableIndexSet alloc] init];
+            [DHMambaStore inWriteTransaction:^(FMDatabase *db, BOOL *rollback) {
+                
+                for ( NSUInteger index = 0; index < batch.count; index++ ) {
+                    BOOL inserted = YES;
+                    if ( ![DHMambaStore insertObject:batch[index] arguments:batchArguments[index] collection:collection database:db inserted:&inserted] ) {
+                        NSLog(@"error inserting data: %@",[db lastErrorMessage]);
+                    }
+                    if ( !inserted ) {
+                        [updated addIndex:index];
+                    }
+                }
+            }];
+            
+            [batch enumerateObjectsUsingBlock:^(id object, NSUInteger index, BOOL *stop) {
+                BOOL inserted = ![updated containsIndex:index];
+                [(inserted ? objIDs : updatedIDs) addObject:[object MB_objID]];
+                [object MB_setCreateTime:inserted ? now : nil updateTime:now];
+                [collection cacheSavedObject:object];
+            }];
+        }];
         
-        // Post a notification so listeners can catch inserts
-        // in other parts of the code.
-        [[NSNotificationCenter defaultCenter] postNotificationName:kDHMambaStoreNotification object:[object class] userInfo:@{@"operation":@"insert",@"object":objID}];
-    }];
+        // One notification for the whole batch instead of one per object
+        if ( objIDs.count > 0 ) {
+            [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:objectClass userInfo:@{kDHMambaStoreNotificationOperationKey:@"insert",kDHMambaStoreNotificationObjectsKey:objIDs}];
+        }
+        if ( updatedIDs.count > 0 ) {
+            [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:objectClass userInfo:@{kDHMambaStoreNotificationOperationKey:@"update",kDHMambaStoreNotificationObjectsKey:updatedIDs}];
+        }
+        [DHMambaStore recordChangesForClass:objectClass inserted:objIDs updated:updatedIDs deleted:nil];
+    }
 }
 
 + (void)updateObject:(id)object {
     
-    NSString *collection = [NSStringFromClass([object class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[object class]];
+    [DHMambaStore flushIfPending:@[object]];
     [DHMambaStore createCollectionIfDoesntExist:[object class]];
     
-    NSString *objID = [object MB_objID];
-    NSString *objKey = [object MB_objKey];
-    NSString *objForeignKey = [object MB_objForeignKey];
-    NSString *objTitle = [object MB_objTitle];
-    NSNumber *objOrderNumber = [object MB_objOrderNumber];
-    NSData *objData = [object MB_objData];
+    NSDate *now = [NSDate date];
+    NSArray *arguments = nil;
+    NSString *updateSql = [collection updateSQLForObject:object time:now arguments:&arguments];
     
-    NSString *updateSql = [NSString stringWithFormat:@"update %@ set objKey = :objKey, objForeignKey = :objForeignKey, objTitle = :objTitle, orderNumber = :orderNumber, updateTime = :updateTime, objBody = :objBody where objID = :objID",collection];
+    // Nothing has changed since it was loaded or last saved
+    if ( !updateSql ) {
+        [collection cacheSavedObject:object];
+        return;
+    }
     
-    [staticStore inDatabase:^(FMDatabase *db) {
+    __block BOOL inserted = NO;
+    [DHMambaStore inWriteDatabase:^(FMDatabase *db) {
         
-        NSDictionary *parameters = @{ @"objID": objID,
-                                      @"objKey": objKey ? objKey : [NSNull null],
-                                      @"objForeignKey" : objForeignKey ? objForeignKey : [NSNull null],
-                                      @"objTitle": objTitle ? objTitle : [NSNull null],
-                                      @"updateTime":[NSNumber numberWithDouble:[[NSDate date] timeIntervalSince1970]],
-                                      @"orderNumber": objOrderNumber ? objOrderNumber : [NSNull null],
-                                      @"objBody": objData };
-        
-        if ( ![db executeUpdate:updateSql withParameterDictionary:parameters] ) {
+        if ( ![DHMambaStore updateObject:object statement:updateSql arguments:arguments collection:collection database:db inserted:&inserted] ) {
             NSLog(@"error updating data: %@",[db lastErrorMessage]);
         }
-        
-        // Post a notification so listeners can catch inserts
-        // in other parts of the code.
-        [[NSNotificationCenter defaultCenter] postNotificationName:kDHMambaStoreNotification object:[object class] userInfo:@{@"operation":@"update",@"object":objID}];
     }];
     
+    NSString *objID = [object MB_objID];
+    [object MB_setCreateTime:inserted ? now : nil updateTime:now];
+    [collection cacheSavedObject:object];
+    
+    // Post a notification so listeners can catch updates
+    // in other parts of the code. An object whose row had
+    // gone missing was inserted again.
+    if ( inserted ) {
+        [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:[object class] userInfo:@{kDHMambaStoreNotificationOperationKey:@"insert",kDHMambaStoreNotificationObjectKey:objID,kDHMambaStoreNotificationObjectsKey:@[objID]}];
+        [DHMambaStore recordChangesForClass:[object class] inserted:@[objID] updated:nil deleted:nil];
+    }
+    else {
+        [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:[object class] userInfo:@{kDHMambaStoreNotificationOperationKey:@"update",kDHMambaStoreNotificationObjectKey:objID,kDHMambaStoreNotificationObjectsKey:@[objID]}];
+        [DHMambaStore recordChangesForClass:[object class] inserted:nil updated:@[objID] deleted:nil];
+    }
+}
+
++ (void)updateObjects:(NSArray *)objects {
+    
+    [DHMambaStore flushIfPending:objects];
+    
+    for ( Class objectClass in [DHMambaStore classesInObjects:objects] ) {
+        
+        DHMambaCollection *collection = [DHMambaCollection collectionForClass:objectClass];
+        [DHMambaStore createCollectionIfDoesntExist:objectClass];
+        
+        NSArray *classObjects = [DHMambaStore objects:objects ofClass:objectClass];
+        NSMutableArray *objIDs = [[NSMutableArray alloc] initWithCapacity:classObjects.count];
+        NSMutableArray *insertedIDs = [[NSMutableArray alloc] init];
+        
+        [DHMambaStore inBatchesOf:classObjects block:^(NSArray *batch) {
+            
+            // Objects that haven't changed are left out
+            NSMutableArray *changedObjects = [[NSMutableArray alloc] initWithCapacity:batch.count];
+            NSMutableArray *batchStatements = [[NSMutableArray alloc] initWithCapacity:batch.count];
+            NSMutableArray *batchArguments = [[NSMutableArray alloc] initWithCapacity:batch.count];
+            NSDate *now = [NSDate date];
+            for ( id object in batch ) {
+                NSArray *arguments = nil;
+                NSString *updateSql = [collection updateSQLForObject:object time:now arguments:&arguments];
+                if ( updateSql ) {
+                    [changedObjects addObject:object];
+                    [batchStatements addObject:updateSql];
+                    [batchArguments addObject:arguments];
+                }
+                else {
+                    [collection cacheSavedObject:object];
+                }
+            }
+            if ( changedObjects.count == 0 ) {
+                return;
+            }
+            
+            NSMutableIndexSet *inserted = [[NSMutableIndexSet alloc] init];
+            [DHMambaStore inWriteTransaction:^(FMDatabase *db, BOOL *rollback) {
+                
+                for ( NSUInteger index = 0; index < changedObjects.count; index++ ) {
+                    BOOL wasInserted = NO;
+                    if ( ![DHMambaStore updateObject:changedObjects[index] statement:batchStatements[index] arguments:batchArguments[index] collection:collection database:db inserted:&wasInserted] ) {
+                        NSLog(@"error updating data: %@",[db lastErrorMessage]);
+                    }
+                    if ( wasInserted ) {
+                        [inserted addIndex:index];
+                    }
+                }
+            }];
+            
+            [changedObjects enumerateObjectsUsingBlock:^(id object, NSUInteger index, BOOL *stop) {
+                BOOL wasInserted = [inserted containsIndex:index];
+                [(wasInserted ? insertedIDs : objIDs) addObject:[object MB_objID]];
+                [object MB_setCreateTime:wasInserted ? now : nil updateTime:now];
+                [collection cacheSavedObject:object];
+            }];
+        }];
+        
+        if ( insertedIDs.count > 0 ) {
+            [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:objectClass userInfo:@{kDHMambaStoreNotificationOperationKey:@"insert",kDHMambaStoreNotificationObjectsKey:insertedIDs}];
+        }
+        if ( objIDs.count > 0 ) {
+            [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:objectClass userInfo:@{kDHMambaStoreNotificationOperationKey:@"update",kDHMambaStoreNotificationObjectsKey:objIDs}];
+        }
+        [DHMambaStore recordChangesForClass:objectClass inserted:insertedIDs updated:objIDs deleted:nil];
+    }
 }
 
 + (void)deleteObject:(id)object {
     
-    NSString *collection = [NSStringFromClass([object class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[object class]];
+    [DHMambaStore flushIfPending:@[object]];
     [DHMambaStore createCollectionIfDoesntExist:[object class]];
     
     // If no id, then just ignore since this object hasn't been stored yet
     if ( [object MB_has_objID] ) {
         NSString *objID = [object MB_objID];
         
-        NSString *sql = [NSString stringWithFormat:@"delete from %@ where objID = :objID",collection];
-        [staticStore inDatabase:^(FMDatabase *db) {
+        [DHMambaStore inWriteDatabase:^(FMDatabase *db) {
             
-            if ( ![db executeUpdate:sql withParameterDictionary:@{@"objID":objID}]) {
+            if ( ![DHMambaStore executeUpdate:collection.deleteSQL database:db arguments:@[objID] collection:collection.name] ) {
                 NSLog(@"error deleting data: %@",[db lastErrorMessage]);
             }
-            
-            // Post a notification so listeners can catch inserts
-            // in other parts of the code.
-            [[NSNotificationCenter defaultCenter] postNotificationName:kDHMambaStoreNotification object:[object class] userInfo:@{@"operation":@"delete",@"object":objID}];
         }];
+        
+        [collection removeCachedObject:object];
+        
+        // Post a notification so listeners can catch deletes
+        // in other parts of the code.
+        [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:[object class] userInfo:@{kDHMambaStoreNotificationOperationKey:@"delete",kDHMambaStoreNotificationObjectKey:objID,kDHMambaStoreNotificationObjectsKey:@[objID]}];
+        [DHMambaStore recordChangesForClass:[object class] inserted:nil updated:nil deleted:@[objID]];
+    }
+}
+
++ (void)deleteObjects:(NSArray *)objects {
+    
+    [DHMambaStore flushIfPending:objects];
+    
+    // Objects that were never stored have nothing to delete
+    NSMutableArray *storedObjects = [[NSMutableArray alloc] init];
+    for ( id object in objects ) {
+        if ( [object MB_has_objID] ) {
+            [storedObjects addObject:object];
+        }
+    }
+    
+    NSArray *classes = [DHMambaStore classesInObjects:storedObjects];
+    for ( Class objectClass in classes ) {
+        [DHMambaStore createCollectionIfDoesntExist:objectClass];
+    }
+    
+    [DHMambaStore inWriteTransaction:^(FMDatabase *db, BOOL *rollback) {
+        
+        for ( id object in storedObjects ) {
+            DHMambaCollection *collection = [DHMambaCollection collectionForClass:[object class]];
+            if ( ![DHMambaStore executeUpdate:collection.deleteSQL database:db arguments:@[[object MB_objID]] collection:collection.name] ) {
+                NSLog(@"error deleting data: %@",[db lastErrorMessage]);
+            }
+        }
+    }];
+    
+    for ( Class objectClass in classes ) {
+        
+        DHMambaCollection *collection = [DHMambaCollection collectionForClass:objectClass];
+        NSMutableArray *objIDs = [[NSMutableArray alloc] init];
+        for ( id object in [DHMambaStore objects:storedObjects ofClass:objectClass] ) {
+            [objIDs addObject:[object MB_objID]];
+            [collection removeCachedObject:object];
+        }
+        [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:objectClass userInfo:@{kDHMambaStoreNotificationOperationKey:@"delete",kDHMambaStoreNotificationObjectsKey:objIDs}];
+        [DHMambaStore recordChangesForClass:objectClass inserted:nil updated:nil deleted:objIDs];
     }
 }
 
 #pragma mark - Query methods
 + (void)selectFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit resultBlock:(void (^)(FMResultSet *))resultBlock {
     
+    [DHMambaStore selectColumns:@"*" fromCollection:collection where:whereClause parameters:parameters order:orderBy limit:limit resultBlock:resultBlock];
+}
+
++ (void)selectColumns:(NSString *)columns fromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
     if ( !resultBlock ) {
         NSLog(@"Error: no result block passed in, so pointless to run the query.");
         return;
     }
     
-    NSString *querySql =[NSString stringWithFormat:@"select * from %@",collection];
+    NSString *querySql =[NSString stringWithFormat:@"select %@ from %@",columns,collection];
     if ( ![whereClause isEqualToString:@""] ) {
         querySql = [querySql stringByAppendingFormat:@" where %@",whereClause];
     }
     
-    NSString *orderByString = @"";
-    switch ( orderBy ) {
-    case DHMambaObjectOrderByKey:
-        orderByString = @"objKey";
-        break;
-    case DHMambaObjectOrderByTitle:
-        orderByString = @"objTitle";
-        break;
-    case DHMambaObjectOrderByForeignKey:
-        orderByString = @"objForeignKey";
-        break;
-    case DHMambaObjectOrderByCreateTime:
-        orderByString = @"createTime";
-        break;
-    case DHMambaObjectOrderByUpdateTime:
-        orderByString = @"updateTime";
-        break;
-    case DHMambaObjectOrderByOrderNumber:
-        orderByString = @"orderNumber";
-        break;
-    case DHMambaObjectOrderByKeyDescending:
-        orderByString = @"objKey DESC";
-        break;
-    case DHMambaObjectOrderByTitleDescending:
-        orderByString = @"objTitle DESC";
-        break;
-    case DHMambaObjectOrderByForeignKeyDescending:
-        orderByString = @"objForeignKey DESC";
-        break;
-    case DHMambaObjectOrderByCreateTimeDescending:
-        orderByString = @"createTime DESC";
-        break;
-    case DHMambaObjectOrderByUpdateTimeDescending:
-        orderByString = @"updateTime DESC";
-        break;
-    case DHMambaObjectOrderByOrderNumberDescending:
-        orderByString = @"orderNumber DESC";
-        break;
-    }
-
+    NSString *orderByString = [DHMambaStore orderByStringFor:orderBy];
     querySql = [querySql stringByAppendingFormat:@" order by %@",orderByString];
     
     if ( limit > 0 ) {
@@ -262,16 +554,145 @@ static NSMutableDictionary *staticCollectionSources;
     }
     
     // NSLog(@"MAMBASTORE## query: %@",querySql);
-    __block FMResultSet *results = nil;
-    [staticStore inDatabase:^(FMDatabase *db) {
+    [DHMambaStore flushPendingInCollection:collection objID:nil];
+    [DHMambaStore inReadDatabase:^(FMDatabase *db) {
+        [DHMambaStore executeQuery:querySql database:db arguments:nil parameters:parameters collection:collection resultBlock:resultBlock];
+    }];
+}
 
-        results = [db executeQuery:querySql withParameterDictionary:parameters];
-        while ( [results next] ) {
-            resultBlock(results);
++ (void)selectFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit offset:(NSUInteger)offset resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    if ( !resultBlock ) {
+        NSLog(@"Error: no result block passed in, so pointless to run the query.");
+        return;
+    }
+    
+    NSString *querySql =[NSString stringWithFormat:@"select * from %@",collection];
+    if ( ![whereClause isEqualToString:@""] ) {
+        querySql = [querySql stringByAppendingFormat:@" where %@",whereClause];
+    }
+    
+    // objID breaks ties so rows don't move between pages
+    querySql = [querySql stringByAppendingFormat:@" order by %@, objID limit %ld offset %lu",[DHMambaStore orderByStringFor:orderBy],limit > 0 ? (long)limit : -1L,(unsigned long)offset];
+    
+    [DHMambaStore flushPendingInCollection:collection objID:nil];
+    [DHMambaStore inReadDatabase:^(FMDatabase *db) {
+        [DHMambaStore executeQuery:querySql database:db arguments:nil parameters:parameters collection:collection resultBlock:resultBlock];
+    }];
+}
+
++ (NSString *)selectPageFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters order:(DHMambaObjectOrderBy)orderBy limit:(NSUInteger)limit after:(NSString *)token resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    if ( !resultBlock ) {
+        NSLog(@"Error: no result block passed in, so pointless to run the query.");
+        return nil;
+    }
+    
+    NSString *column = [DHMambaStore orderColumnFor:orderBy];
+    BOOL descending = [DHMambaStore orderIsDescending:orderBy];
+    NSMutableArray *criteria = [[NSMutableArray alloc] init];
+    NSMutableDictionary *queryParameters = [NSMutableDictionary dictionaryWithDictionary:parameters];
+    if ( ![whereClause isEqualToString:@""] ) {
+        [criteria addObject:[NSString stringWithFormat:@"(%@)",whereClause]];
+    }
+    
+    // Seek past the last row of the previous page instead of skipping rows.
+    // Nulls sort as the smallest value (last when descending), and objID
+    // breaks ties.
+    if ( token ) {
+        
+        NSDictionary *position = [DHMambaStore positionFromToken:token order:orderBy];
+        if ( !position ) {
+            NSLog(@"Error: page token doesn't match the order of this query.");
+            return nil;
+        }
+        queryParameters[@"mambaPageObjID"] = position[@"objID"];
+        
+        NSString *seek;
+        if ( position[@"value"] ) {
+            queryParameters[@"mambaPageValue"] = position[@"value"];
+            if ( descending ) {
+                seek = [NSString stringWithFormat:@"(%@ < :mambaPageValue or (%@ = :mambaPageValue and objID < :mambaPageObjID) or %@ is null)",column,column,column];
+            }
+            else {
+                seek = [NSString stringWithFormat:@"(%@ > :mambaPageValue or (%@ = :mambaPageValue and objID > :mambaPageObjID))",column,column];
+            }
+        }
+        else {
+            if ( descending ) {
+                seek = [NSString stringWithFormat:@"(%@ is null and objID < :mambaPageObjID)",column];
+            }
+            else {
+                seek = [NSString stringWithFormat:@"((%@ is null and objID > :mambaPageObjID) or %@ is not null)",column,column];
+            }
         }
+        [criteria addObject:seek];
+    }
+    
+    NSString *querySql =[NSString stringWithFormat:@"select * from %@",collection];
+    if ( criteria.count > 0 ) {
+        querySql = [querySql stringByAppendingFormat:@" where %@",[criteria componentsJoinedByString:@" and "]];
+    }
+    querySql = [querySql stringByAppendingFormat:@" order by %@, objID%@",[DHMambaStore orderByStringFor:orderBy],descending ? @" DESC" : @""];
+    if ( limit > 0 ) {
+        querySql = [querySql stringByAppendingFormat:@" limit %lu",(unsigned long)limit];
+    }
+    
+    __block NSUInteger rowCount = 0;
+    __block id lastValue = nil;
+    __block NSString *lastObjID = nil;
+    [DHMambaStore flushPendingInCollection:collection objID:nil];
+    [DHMambaStore inReadDatabase:^(FMDatabase *db) {
+        
+        [DHMambaStore executeQuery:querySql database:db arguments:nil parameters:queryParameters collection:collection resultBlock:^(FMResultSet *results) {
+            resultBlock(results);
+            lastValue = [results objectForColumnName:column];
+            lastObjID = [results stringForColumn:@"objID"];
+            rowCount++;
+        }];
+    }];
+    
+    // A short page means there is nothing after it
+    if ( limit == 0 || rowCount < limit ) {
+        return nil;
+    }
+    return [DHMambaStore tokenForOrder:orderBy value:lastValue objID:lastObjID];
+}
+
++ (void)selectWithSQL:(NSString *)querySql arguments:(NSArray *)arguments resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    [DHMambaStore flushPendingInCollection:nil objID:nil];
+    [DHMambaStore selectWithSQL:querySql arguments:arguments collection:nil resultBlock:resultBlock];
+}
+
++ (void)selectWithSQL:(NSString *)querySql parameters:(NSDictionary *)parameters resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    if ( !resultBlock ) {
+        NSLog(@"Error: no result block passed in, so pointless to run the query.");
+        return;
+    }
+    
+    [DHMambaStore flushPendingInCollection:nil objID:nil];
+    [DHMambaStore inReadDatabase:^(FMDatabase *db) {
+        [DHMambaStore executeQuery:querySql database:db arguments:nil parameters:parameters collection:nil resultBlock:resultBlock];
     }];
 }
 
++ (void)selectObjectOfClass:(Class)objectClass withID:(NSString *)objID resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    // Only a pending write of this object can change what's read
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:objectClass];
+    [DHMambaStore flushPendingInCollection:nil objID:objID];
+    [DHMambaStore selectWithSQL:collection.selectWithIDSQL arguments:@[objID] collection:collection.name resultBlock:resultBlock];
+}
+
++ (void)selectObjectOfClass:(Class)objectClass withKey:(NSString *)key resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:objectClass];
+    [DHMambaStore flushPendingInCollection:collection.name objID:nil];
+    [DHMambaStore selectWithSQL:collection.selectWithKeySQL arguments:@[key] collection:collection.name resultBlock:resultBlock];
+}
+
 + (NSNumber *)countFromCollection:(NSString *)collection where:(NSString *)whereClause parameters:(NSDictionary *)parameters
 {
     NSString *querySql = [NSString stringWithFormat:@"select count(*) from %@",collection];
@@ -281,57 +702,1000 @@ static NSMutableDictionary *staticCollectionSources;
     
     // NSLog(@"MAMBASTORE## query: %@",querySql);
     __block NSNumber *count = @0;
-    [staticStore inDatabase:^(FMDatabase *db) {
+    [DHMambaStore flushPendingInCollection:collection objID:nil];
+    [DHMambaStore inReadDatabase:^(FMDatabase *db) {
         
-        FMResultSet *results = [db executeQuery:querySql withParameterDictionary:parameters];
-        if ( [results next] ) {
-            count = [NSNumber numberWithInt:[results intForColumnIndex:0]];
-        }
-        [results close];
+        [DHMambaStore executeQuery:querySql database:db arguments:nil parameters:parameters collection:collection resultBlock:^(FMResultSet *results) {
+            count = [NSNumber numberWithLongLong:[results longLongIntForColumnIndex:0]];
+        }];
     }];
     return count;
 }
 
-#pragma mark - Private Methods
-+ (void)createCollectionIfDoesntExist:(Class)docClass{
-    
-    NSString *collection = [NSStringFromClass(docClass) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
++ (NSString *)orderColumnFor:(DHMambaObjectOrderBy)orderBy {
     
-    // Check for the static array that lists all the collections
-    if ( !staticCollectionList ) {
-        staticCollectionList = [[NSMutableArray alloc] init];
+    switch ( orderBy ) {
+    case DHMambaObjectOrderByKey:
+    case DHMambaObjectOrderByKeyDescending:
+        return @"objKey";
+    case DHMambaObjectOrderByTitle:
+    case DHMambaObjectOrderByTitleDescending:
+        return @"objTitle";
+    case DHMambaObjectOrderByForeignKey:
+    case DHMambaObjectOrderByForeignKeyDescending:
+        return @"objForeignKey";
+    case DHMambaObjectOrderByCreateTime:
+    case DHMambaObjectOrderByCreateTimeDescending:
+        return @"createTime";
+    case DHMambaObjectOrderByUpdateTime:
+    case DHMambaObjectOrderByUpdateTimeDescending:
+        return @"updateTime";
+    case DHMambaObjectOrderByOrderNumber:
+    case DHMambaObjectOrderByOrderNumberDescending:
+        return @"orderNumber";
     }
-    
-    // Now check if we have already created this collection, if so
-    // just return as there is nothing to do.
-    if ( ![staticCollectionList containsObject:collection] ) {
-        
-        // create a table for this collection
-        NSString *createSQL = [NSString stringWithFormat:@"create table if not exists %@ (objID text, objKey text, objForeignKey text, objTitle text, createTime real, updateTime real, orderNumber integer, objBody blob)",collection];
-        // NSLog(@"createSQL: %@",createSQL);
-        
-        NSString *createPKIndexSQL = [NSString stringWithFormat:@"create index if not exists %@_pk ON %@ (objID)",collection,collection];
-
-        NSString *createKeyIndexSQL = [NSString stringWithFormat:@"create index if not exists %@_pk ON %@ (objKey)",collection,collection];
-
-        [staticStore inDatabase:^(FMDatabase *db) {
-
-            if ( ![db executeUpdate:createSQL] ) {
-                NSLog(@"error creating table: %@",[db lastErrorMessage]);
-            }
+    return @"orderNumber";
+}
 
-            if ( ![db executeUpdate:createPKIndexSQL] ) {
-                NSLog(@"error creating PK index: %@",[db lastErrorMessage]);
-            }
++ (BOOL)orderIsDescending:(DHMambaObjectOrderBy)orderBy {
+    
+    return orderBy >= DHMambaObjectOrderByKeyDescending;
+}
 
-            if ( ![db executeUpdate:createKeyIndexSQL] ) {
-                NSLog(@"error creating Key index: %@",[db lastErrorMessage]);
-            }
-        }];
-        
-        [staticCollectionList addObject:collection];
++ (NSString *)tokenForOrder:(DHMambaObjectOrderBy)orderBy value:(id)value objID:(NSString *)objID {
+    
+    // A binary plist keeps real values exact, so the next page starts
+    // exactly where this one ended. Nulls are left out.
+    NSMutableDictionary *position = [NSMutableDictionary dictionaryWithObjectsAndKeys:@(orderBy),@"order",objID,@"objID",nil];
+    if ( value && value != [NSNull null] ) {
+        position[@"value"] = value;
     }
+    NSError *error = nil;
+    NSData *data = [NSPropertyListSerialization dataWithPropertyList:position format:NSPropertyListBinaryFormat_v1_0 options:0 error:&error];
+    if ( !data ) {
+        NSLog(@"error creating page token: %@",[error localizedDescription]);
+        return nil;
+    }
+    return [data base64EncodedStringWithOptions:0];
 }
 
+#pragma mark - Write behind methods
++ (void)enableWriteBehindWithInterval:(NSTimeInterval)interval threshold:(NSUInteger)threshold {
+    
+    // Anything left from before is written first
+    [DHMambaStore disableWriteBehind];
+    
+    @synchronized([DHMambaStore pendingWrites]) {
+        
+        if ( staticFlushTimer ) {
+            dispatch_source_cancel(staticFlushTimer);
+        }
+        staticFlushThreshold = threshold;
+        staticFlushTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0));
+        uint64_t nanoseconds = (uint64_t)(interval * NSEC_PER_SEC);
+        dispatch_source_set_timer(staticFlushTimer, dispatch_time(DISPATCH_TIME_NOW, nanoseconds), nanoseconds, nanoseconds / 10);
+        dispatch_source_set_event_handler(staticFlushTimer, ^{
+            [DHMambaStore flush];
+        });
+        dispatch_resume(staticFlushTimer);
+        staticWriteBehind = YES;
+    }
+}
+
++ (void)disableWriteBehind {
+    
+    NSMutableDictionary *pendingWrites = [DHMambaStore pendingWrites];
+    @synchronized(pendingWrites) {
+        
+        if ( !staticWriteBehind ) {
+            return;
+        }
+    }
+    
+    // Saves keep being queued until nothing is waiting, so the flag only goes
+    // off once every queued object is in the store. Holding the flush lock
+    // keeps other flushes from having objects in flight at that point.
+    @synchronized(staticFlushLock) {
+        while ( YES ) {
+            [DHMambaStore flush];
+            @synchronized(pendingWrites) {
+                if ( pendingWrites.count == 0 ) {
+                    if ( staticFlushTimer ) {
+                        dispatch_source_cancel(staticFlushTimer);
+                        staticFlushTimer = nil;
+                    }
+                    staticWriteBehind = NO;
+                    break;
+                }
+            }
+        }
+    }
+}
+
++ (BOOL)writeBehindEnabled {
+    
+    @synchronized([DHMambaStore pendingWrites]) {
+        return staticWriteBehind;
+    }
+}
+
++ (BOOL)saveObjects:(NSArray *)objects {
+    
+    if ( ![DHMambaStore writeBehindEnabled] ) {
+        
+        // split into new objects and ones that are already in the store
+        NSMutableArray *inserts = [[NSMutableArray alloc] init];
+        NSMutableArray *updates = [[NSMutableArray alloc] init];
+        for ( id object in objects ) {
+            if ( ![object MB_has_objID] ) {
+                [inserts addObject:object];
+            }
+            else {
+                [updates addObject:object];
+            }
+        }
+        [DHMambaStore insertObjects:inserts];
+        [DHMambaStore updateObjects:updates];
+        return NO;
+    }
+    
+    NSMutableSet *inserts = [[NSMutableSet alloc] init];
+    for ( id object in objects ) {
+        if ( ![object MB_has_objID] ) {
+            [inserts addObject:[object MB_objID]];
+        }
+    }
+    return [DHMambaStore saveObjects:objects inserts:inserts];
+}
+
++ (BOOL)saveObjects:(NSArray *)objects inserts:(NSSet *)inserts {
+    
+    // The flag is checked under the same lock the objects are queued under,
+    // so nothing can be queued once write behind has been turned off.
+    // Later saves of the same object replace the pending one.
+    BOOL queued = NO;
+    BOOL shouldFlush = NO;
+    NSMutableDictionary *pendingWrites = [DHMambaStore pendingWrites];
+    @synchronized(pendingWrites) {
+        
+        if ( staticWriteBehind ) {
+            
+            for ( id object in objects ) {
+                
+                NSString *objID = [object MB_objID];
+                if ( [inserts containsObject:objID] ) {
+                    [staticPendingInserts addObject:objID];
+                }
+                if ( !pendingWrites[objID] ) {
+                    [staticPendingCollections addObject:[DHMambaCollection collectionNameForClass:[object class]]];
+                }
+                pendingWrites[objID] = object;
+            }
+            queued = YES;
+            shouldFlush = pendingWrites.count >= staticFlushThreshold;
+        }
+    }
+    
+    if ( !queued ) {
+        [DHMambaStore writeObjects:objects inserts:inserts];
+    }
+    else if ( shouldFlush ) {
+        [DHMambaStore flush];
+    }
+    return queued;
+}
+
++ (void)flush {
+    
+    NSMutableDictionary *pendingWrites = [DHMambaStore pendingWrites];
+    NSArray *objects = nil;
+    
+    // Readers that need pending objects wait here while a flush is being
+    // written, so they never miss objects that have left the pending list
+    // but aren't in the store yet.
+    @synchronized(staticFlushLock) {
+        
+        NSSet *inserts = nil;
+        @synchronized(pendingWrites) {
+            
+            if ( pendingWrites.count == 0 ) {
+                return;
+            }
+            objects = [pendingWrites allValues];
+            inserts = [staticPendingInserts copy];
+            [pendingWrites removeAllObjects];
+            [staticPendingInserts removeAllObjects];
+            [staticPendingCollections removeAllObjects];
+        }
+        [DHMambaStore writeObjects:objects inserts:inserts];
+    }
+    
+    // The objects were queued without calling mambaAfterSave, so it's called
+    // now that they have been written
+    for ( id object in objects ) {
+        if ( [object respondsToSelector:@selector(mambaAfterSave)] ) {
+            [object performSelector:@selector(mambaAfterSave)];
+        }
+    }
+}
+
++ (id)pendingObjectOfClass:(Class)objectClass withID:(NSString *)objID {
+    
+    if ( !staticWriteBehind || !objID ) {
+        return nil;
+    }
+    
+    @synchronized([DHMambaStore pendingWrites]) {
+        
+        id object = staticPendingWrites[objID];
+        return [object isKindOfClass:objectClass] ? object : nil;
+    }
+}
+
++ (id)pendingObjectOfClass:(Class)objectClass withKey:(NSString *)key {
+    
+    if ( !staticWriteBehind || !key ) {
+        return nil;
+    }
+    
+    // Only ever as many objects as the flush threshold to look through
+    @synchronized([DHMambaStore pendingWrites]) {
+        
+        for ( id object in [staticPendingWrites objectEnumerator] ) {
+            if ( [object isKindOfClass:objectClass] && [[object MB_objKey] isEqualToString:key] ) {
+                return object;
+            }
+        }
+        return nil;
+    }
+}
+
+#pragma mark - Change notification methods
++ (void)setChangeInterval:(NSTimeInterval)interval queue:(dispatch_queue_t)queue {
+    
+    @synchronized([DHMambaStore changeSets]) {
+        staticChangeInterval = interval;
+        staticChangeQueue = queue;
+    }
+}
+
+#pragma mark - Diagnostics methods
++ (void)enableDiagnosticsWithSlowQueryThreshold:(NSTimeInterval)threshold {
+    
+    @synchronized([DHMambaStore queryStatsByStatement]) {
+        staticSlowQueryThreshold = threshold;
+        staticDiagnosticsEnabled = YES;
+    }
+}
+
++ (void)disableDiagnostics {
+    
+    @synchronized([DHMambaStore queryStatsByStatement]) {
+        staticDiagnosticsEnabled = NO;
+    }
+}
+
++ (BOOL)diagnosticsEnabled {
+    return staticDiagnosticsEnabled;
+}
+
++ (NSArray *)queryStats {
+    
+    NSMutableDictionary *queryStats = [DHMambaStore queryStatsByStatement];
+    @synchronized(queryStats) {
+        return [[queryStats allValues] sortedArrayUsingComparator:^NSComparisonResult(DHMambaQueryStats *first, DHMambaQueryStats *second) {
+            if ( first.totalTime == second.totalTime ) {
+                return NSOrderedSame;
+            }
+            return first.totalTime > second.totalTime ? NSOrderedAscending : NSOrderedDescending;
+        }];
+    }
+}
+
++ (void)resetDiagnostics {
+    
+    NSMutableDictionary *queryStats = [DHMambaStore queryStatsByStatement];
+    @synchronized(queryStats) {
+        [queryStats removeAllObjects];
+    }
+}
+
+#pragma mark - Async methods
++ (NSOperation *)performAsync:(id (^)(void))work queue:(dispatch_queue_t)queue completion:(void (^)(id result))completion {
+    
+    return [DHMambaStore performAsync:work writes:YES queue:queue completion:completion];
+}
+
++ (NSOperation *)performAsync:(id (^)(void))work writes:(BOOL)writes queue:(dispatch_queue_t)queue completion:(void (^)(id result))completion {
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        
+        // Reads run side by side on the read pool, ordering comes from the
+        // dependencies added below
+        staticAsyncQueue = [[NSOperationQueue alloc] init];
+        staticAsyncQueue.name = @"DHMambaStore";
+        staticAsyncReads = [[NSMutableArray alloc] init];
+    });
+    
+    dispatch_queue_t completionQueue = queue ? queue : dispatch_get_main_queue();
+    NSBlockOperation *operation = [[NSBlockOperation alloc] init];
+    __weak NSBlockOperation *weakOperation = operation;
+    [operation addExecutionBlock:^{
+        
+        if ( [weakOperation isCancelled] ) {
+            return;
+        }
+        id result = work();
+        if ( completion && ![weakOperation isCancelled] ) {
+            dispatch_async(completionQueue, ^{
+                completion(result);
+            });
+        }
+    }];
+    
+    // Runs for cancelled operations too. Finished operations let go of what
+    // they waited for, so the chain of writes isn't kept alive.
+    operation.completionBlock = ^{
+        NSBlockOperation *finished = weakOperation;
+        @synchronized(staticAsyncQueue) {
+            staticAsyncPending--;
+            if ( staticAsyncLastWrite == finished ) {
+                staticAsyncLastWrite = nil;
+            }
+            [staticAsyncReads removeObjectIdenticalTo:finished];
+            for ( NSOperation *dependency in [finished.dependencies copy] ) {
+                [finished removeDependency:dependency];
+            }
+        }
+    };
+    
+    // Turn work away instead of holding the caller when too much is waiting.
+    // A write waits for everything queued before it, and a read waits for the
+    // last write, so a find queued after a save sees the saved objects.
+    @synchronized(staticAsyncQueue) {
+        
+        if ( staticAsyncPending >= kDHMambaStoreMaximumPendingOperations ) {
+            NSLog(@"error queueing async operation, %lu operations are already waiting",(unsigned long)staticAsyncPending);
+            return nil;
+        }
+        staticAsyncPending++;
+        
+        if ( staticAsyncLastWrite ) {
+            [operation addDependency:staticAsyncLastWrite];
+        }
+        if ( writes ) {
+            for ( NSOperation *read in staticAsyncReads ) {
+                [operation addDependency:read];
+            }
+            [staticAsyncReads removeAllObjects];
+            staticAsyncLastWrite = operation;
+        }
+        else {
+            [staticAsyncReads addObject:operation];
+        }
+        [staticAsyncQueue addOperation:operation];
+    }
+    return operation;
+}
+
++ (NSUInteger)pendingAsyncOperationCount {
+    
+    if ( !staticAsyncQueue ) {
+        return 0;
+    }
+    @synchronized(staticAsyncQueue) {
+        return staticAsyncPending;
+    }
+}
+
++ (BOOL)canPerformAsync {
+    
+    return [DHMambaStore pendingAsyncOperationCount] < kDHMambaStoreMaximumPendingOperations;
+}
+
+#pragma mark - Private Methods
++ (NSMutableArray *)collectionList {
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        staticCollectionList = [[NSMutableArray alloc] init];
+        staticCollectionLocks = [[NSMutableDictionary alloc] init];
+    });
+    return staticCollectionList;
+}
+
++ (NSMutableDictionary *)pendingWrites {
+    
+    // Made once and never replaced, so it can always be locked on
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        staticPendingWrites = [[NSMutableDictionary alloc] init];
+        staticPendingInserts = [[NSMutableSet alloc] init];
+        staticPendingCollections = [[NSCountedSet alloc] init];
+        staticFlushLock = [[NSObject alloc] init];
+    });
+    return staticPendingWrites;
+}
+
++ (void)flushPendingInCollection:(NSString *)collection objID:(NSString *)objID {
+    
+    // Reads only write pending objects their results could include: the one
+    // with the objID, any in the collection, or any at all for SQL that could
+    // read from anywhere. Without write behind no locks are taken.
+    if ( !staticWriteBehind ) {
+        return;
+    }
+    
+    NSMutableDictionary *pendingWrites = [DHMambaStore pendingWrites];
+    @synchronized(staticFlushLock) {
+        
+        BOOL pending = NO;
+        @synchronized(pendingWrites) {
+            if ( objID ) {
+                pending = pendingWrites[objID] != nil;
+            }
+            else if ( collection ) {
+                pending = [staticPendingCollections countForObject:collection] > 0;
+            }
+            else {
+                pending = pendingWrites.count > 0;
+            }
+        }
+        if ( pending ) {
+            [DHMambaStore flush];
+        }
+    }
+}
+
++ (void)flushIfPending:(NSArray *)objects {
+    
+    // An object written directly has to land after its pending write, not
+    // before it (a pending insert would turn the direct update into a no-op).
+    if ( !staticWriteBehind ) {
+        return;
+    }
+    
+    BOOL pending = NO;
+    @synchronized([DHMambaStore pendingWrites]) {
+        
+        for ( id object in objects ) {
+            if ( [object MB_has_objID] && staticPendingWrites[[object MB_objID]] ) {
+                pending = YES;
+                break;
+            }
+        }
+    }
+    if ( pending ) {
+        [DHMambaStore flush];
+    }
+}
+
++ (void)writeObjects:(NSArray *)objects inserts:(NSSet *)inserts {
+    
+    NSDate *now = [NSDate date];
+    NSMutableArray *writes = [[NSMutableArray alloc] init];
+    NSMutableArray *writeStatements = [[NSMutableArray alloc] init];
+    NSMutableArray *writeArguments = [[NSMutableArray alloc] init];
+    NSMutableArray *writeCollections = [[NSMutableArray alloc] init];
+    NSMutableIndexSet *newObjects = [[NSMutableIndexSet alloc] init];
+    
+    // Archive everything before taking the database
+    for ( Class objectClass in [DHMambaStore classesInObjects:objects] ) {
+        
+        DHMambaCollection *collection = [DHMambaCollection collectionForClass:objectClass];
+        [DHMambaStore createCollectionIfDoesntExist:objectClass];
+        
+        for ( id object in [DHMambaStore objects:objects ofClass:objectClass] ) {
+            
+            if ( [inserts containsObject:[object MB_objID]] ) {
+                [newObjects addIndex:writes.count];
+                [writeStatements addObject:collection.insertSQL];
+                [writeArguments addObject:[collection insertArgumentsForObject:object time:now]];
+            }
+            else {
+                
+                // Objects that haven't changed are left out
+                NSArray *arguments = nil;
+                NSString *updateSql = [collection updateSQLForObject:object time:now arguments:&arguments];
+                if ( !updateSql ) {
+                    [collection cacheSavedObject:object];
+                    continue;
+                }
+                [writeStatements addObject:updateSql];
+                [writeArguments addObject:arguments];
+            }
+            [writes addObject:object];
+            [writeCollections addObject:collection];
+        }
+    }
+    if ( writes.count == 0 ) {
+        return;
+    }
+    
+    // New objects can turn out to be stored already, and stored ones can
+    // turn out to be missing
+    NSMutableIndexSet *inserted = [[NSMutableIndexSet alloc] init];
+    [DHMambaStore inWriteTransaction:^(FMDatabase *db, BOOL *rollback) {
+        
+        for ( NSUInteger index = 0; index < writes.count; index++ ) {
+            
+            BOOL wasInserted = [newObjects containsIndex:index];
+            BOOL success = NO;
+            if ( wasInserted ) {
+                success = [DHMambaStore insertObject:writes[index] arguments:writeArguments[index] collection:writeCollections[index] database:db inserted:&wasInserted];
+            }
+            else {
+                success = [DHMambaStore updateObject:writes[index] statement:writeStatements[index] arguments:writeArguments[index] collection:writeCollections[index] database:db inserted:&wasInserted];
+            }
+            if ( !success ) {
+                NSLog(@"error writing data: %@",[db lastErrorMessage]);
+            }
+            if ( wasInserted ) {
+                [inserted addIndex:index];
+            }
+        }
+    }];
+    
+    NSMutableDictionary *insertedIDs = [[NSMutableDictionary alloc] init];
+    NSMutableDictionary *updatedIDs = [[NSMutableDictionary alloc] init];
+    for ( Class objectClass in [DHMambaStore classesInObjects:objects] ) {
+        
+        NSString *className = NSStringFromClass(objectClass);
+        insertedIDs[className] = [[NSMutableArray alloc] init];
+        updatedIDs[className] = [[NSMutableArray alloc] init];
+    }
+    
+    [writes enumerateObjectsUsingBlock:^(id object, NSUInteger index, BOOL *stop) {
+        
+        BOOL wasInserted = [inserted containsIndex:index];
+        NSString *className = NSStringFromClass([object class]);
+        [(wasInserted ? insertedIDs : updatedIDs)[className] addObject:[object MB_objID]];
+        [object MB_setCreateTime:wasInserted ? now : nil updateTime:now];
+        [writeCollections[index] cacheSavedObject:object];
+    }];
+    
+    for ( Class objectClass in [DHMambaStore classesInObjects:objects] ) {
+        
+        NSString *className = NSStringFromClass(objectClass);
+        if ( [insertedIDs[className] count] > 0 ) {
+            [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:objectClass userInfo:@{kDHMambaStoreNotificationOperationKey:@"insert",kDHMambaStoreNotificationObjectsKey:insertedIDs[className]}];
+        }
+        if ( [updatedIDs[className] count] > 0 ) {
+            [DHMambaStore postNotification:kDHMambaStoreNotification objectClass:objectClass userInfo:@{kDHMambaStoreNotificationOperationKey:@"update",kDHMambaStoreNotificationObjectsKey:updatedIDs[className]}];
+        }
+        [DHMambaStore recordChangesForClass:objectClass inserted:insertedIDs[className] updated:updatedIDs[className] deleted:nil];
+    }
+}
+
++ (NSMutableDictionary *)changeSets {
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        staticChangeSets = [[NSMutableDictionary alloc] init];
+    });
+    return staticChangeSets;
+}
+
++ (void)recordChangesForClass:(Class)objectClass inserted:(NSArray *)inserted updated:(NSArray *)updated deleted:(NSArray *)deleted {
+    
+    [DHMambaStore recordChangesForClass:objectClass usingBlock:^(DHMambaChangeSet *changes) {
+        [changes addInsertedIDs:inserted];
+        [changes addUpdatedIDs:updated];
+        [changes addDeletedIDs:deleted];
+    }];
+}
+
++ (void)recordChangesForClass:(Class)objectClass usingBlock:(void (^)(DHMambaChangeSet *changes))block {
+    
+    NSMutableDictionary *changeSets = [DHMambaStore changeSets];
+    BOOL schedule = NO;
+    NSTimeInterval interval = 0;
+    dispatch_queue_t queue = nil;
+    @synchronized(changeSets) {
+        
+        NSString *className = NSStringFromClass(objectClass);
+        DHMambaChangeSet *changes = changeSets[className];
+        if ( !changes ) {
+            changes = [[DHMambaChangeSet alloc] initWithClass:objectClass];
+            changeSets[className] = changes;
+        }
+        block(changes);
+        
+        // Everything recorded until the post runs goes out together
+        if ( !staticChangesScheduled ) {
+            staticChangesScheduled = YES;
+            schedule = YES;
+            interval = staticChangeInterval;
+            queue = staticChangeQueue ? staticChangeQueue : dispatch_get_main_queue();
+        }
+    }
+    
+    if ( schedule ) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(interval * NSEC_PER_SEC)), queue, ^{
+            [DHMambaStore postChanges];
+        });
+    }
+}
+
++ (void)postChanges {
+    
+    NSArray *changeSets = nil;
+    @synchronized([DHMambaStore changeSets]) {
+        changeSets = [staticChangeSets allValues];
+        [staticChangeSets removeAllObjects];
+        staticChangesScheduled = NO;
+    }
+    
+    for ( DHMambaChangeSet *changes in changeSets ) {
+        if ( ![changes isEmpty] ) {
+            [DHMambaStore postNotification:kDHMambaStoreChangesNotification objectClass:changes.objectClass userInfo:@{@"changes":changes}];
+        }
+    }
+}
+
++ (NSString *)orderByStringFor:(DHMambaObjectOrderBy)orderBy {
+    
+    NSString *orderByString = [DHMambaStore orderColumnFor:orderBy];
+    if ( [DHMambaStore orderIsDescending:orderBy] ) {
+        orderByString = [orderByString stringByAppendingString:@" DESC"];
+    }
+    return orderByString;
+}
+
++ (NSDictionary *)positionFromToken:(NSString *)token order:(DHMambaObjectOrderBy)orderBy {
+    
+    NSData *data = [[NSData alloc] initWithBase64EncodedString:token options:0];
+    if ( !data ) {
+        return nil;
+    }
+    NSDictionary *position = [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable format:NULL error:NULL];
+    if ( ![position isKindOfClass:[NSDictionary class]] ||
+         ![position[@"objID"] isKindOfClass:[NSString class]] ||
+         [position[@"order"] unsignedIntegerValue] != orderBy ) {
+        return nil;
+    }
+    return position;
+}
+
++ (void)selectWithSQL:(NSString *)querySql arguments:(NSArray *)arguments collection:(NSString *)collection resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    if ( !resultBlock ) {
+        NSLog(@"Error: no result block passed in, so pointless to run the query.");
+        return;
+    }
+    
+    [DHMambaStore inReadDatabase:^(FMDatabase *db) {
+        [DHMambaStore executeQuery:querySql database:db arguments:arguments parameters:nil collection:collection resultBlock:resultBlock];
+    }];
+}
+
++ (void)executeQuery:(NSString *)querySql database:(FMDatabase *)db arguments:(NSArray *)arguments parameters:(NSDictionary *)parameters collection:(NSString *)collection resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    if ( !staticDiagnosticsEnabled && ![DHMambaMetrics enabled] ) {
+        FMResultSet *results = arguments ? [db executeQuery:querySql withArgumentsInArray:arguments] : [db executeQuery:querySql withParameterDictionary:parameters];
+        while ( [results next] ) {
+            resultBlock(results);
+        }
+        [results close];
+        return;
+    }
+    
+    // Only time SQLite, not what the caller does with each row
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    FMResultSet *results = arguments ? [db executeQuery:querySql withArgumentsInArray:arguments] : [db executeQuery:querySql withParameterDictionary:parameters];
+    NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - start;
+    NSUInteger rows = 0;
+    while ( YES ) {
+        start = CFAbsoluteTimeGetCurrent();
+        BOOL hasRow = [results next];
+        elapsed += CFAbsoluteTimeGetCurrent() - start;
+        if ( !hasRow ) {
+            break;
+        }
+        rows++;
+        resultBlock(results);
+    }
+    [results close];
+    
+    [DHMambaMetrics record:DHMambaMetricExecute collection:collection value:elapsed * 1000000.0];
+    [DHMambaMetrics record:DHMambaMetricRows collection:collection value:rows];
+    if ( !staticDiagnosticsEnabled ) {
+        return;
+    }
+    
+    BOOL slow = elapsed > staticSlowQueryThreshold;
+    BOOL needsPlan = NO;
+    DHMambaQueryStats *stats = nil;
+    NSMutableDictionary *queryStats = [DHMambaStore queryStatsByStatement];
+    @synchronized(queryStats) {
+        stats = queryStats[querySql];
+        if ( !stats ) {
+            stats = [[DHMambaQueryStats alloc] initWithSQL:querySql];
+            queryStats[querySql] = stats;
+        }
+        needsPlan = slow && stats.slowExecutions == 0;
+        [stats addExecutionWithTime:elapsed rows:rows slow:slow];
+    }
+    
+    if ( needsPlan ) {
+        
+        NSMutableArray *plan = [[NSMutableArray alloc] init];
+        NSString *explainSql = [NSString stringWithFormat:@"EXPLAIN QUERY PLAN %@",querySql];
+        FMResultSet *planResults = arguments ? [db executeQuery:explainSql withArgumentsInArray:arguments] : [db executeQuery:explainSql withParameterDictionary:parameters];
+        while ( [planResults next] ) {
+            NSString *detail = [planResults stringForColumn:@"detail"];
+            if ( detail ) {
+                [plan addObject:detail];
+            }
+        }
+        [planResults close];
+        
+        @synchronized(queryStats) {
+            [stats setPlan:plan];
+        }
+        NSLog(@"MAMBASTORE## slow query (%.2f ms, %lu rows): %@\n%@",elapsed * 1000.0,(unsigned long)rows,querySql,[plan componentsJoinedByString:@"\n"]);
+    }
+}
+
++ (NSMutableDictionary *)queryStatsByStatement {
+    
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        staticQueryStats = [[NSMutableDictionary alloc] init];
+    });
+    return staticQueryStats;
+}
+
++ (void)inWriteDatabase:(void (^)(FMDatabase *db))block {
+    
+    CFAbsoluteTime queued = [DHMambaMetrics start];
+    [staticStore inDatabase:^(FMDatabase *db) {
+        [DHMambaMetrics record:DHMambaMetricQueueWait collection:nil since:queued];
+        block(db);
+    }];
+}
+
++ (void)inWriteTransaction:(void (^)(FMDatabase *db, BOOL *rollback))block {
+    
+    CFAbsoluteTime queued = [DHMambaMetrics start];
+    [staticStore inTransaction:^(FMDatabase *db, BOOL *rollback) {
+        [DHMambaMetrics record:DHMambaMetricQueueWait collection:nil since:queued];
+        block(db, rollback);
+    }];
+}
+
++ (BOOL)executeUpdate:(NSString *)updateSql database:(FMDatabase *)db arguments:(NSArray *)arguments collection:(NSString *)collection {
+    
+    CFAbsoluteTime start = [DHMambaMetrics start];
+    BOOL success = [db executeUpdate:updateSql withArgumentsInArray:arguments];
+    [DHMambaMetrics record:DHMambaMetricExecute collection:collection since:start];
+    return success;
+}
+
++ (BOOL)insertObject:(id)object arguments:(NSArray *)arguments collection:(DHMambaCollection *)collection database:(FMDatabase *)db inserted:(BOOL *)inserted {
+    
+    // The next save has to write everything if this one didn't make it
+    BOOL success = [DHMambaStore writeNewObject:object arguments:arguments collection:collection database:db inserted:inserted];
+    if ( !success ) {
+        [collection forgetSnapshotOfObject:object];
+    }
+    return success;
+}
+
++ (BOOL)writeNewObject:(id)object arguments:(NSArray *)arguments collection:(DHMambaCollection *)collection database:(FMDatabase *)db inserted:(BOOL *)inserted {
+    
+    id objKey = arguments[1];
+    if ( !collection.uniqueKey || objKey == [NSNull null] ) {
+        *inserted = YES;
+        return [DHMambaStore executeUpdate:collection.insertSQL database:db arguments:arguments collection:collection.name];
+    }
+    
+    // Find out which row now holds the key. Newer versions of SQLite do this
+    // in the insert itself, older ones have to look the key up first.
+    NSString *storedID = nil;
+    NSNumber *storedCreateTime = nil;
+    if ( [DHMambaStore supportsUpsert] ) {
+        
+        CFAbsoluteTime start = [DHMambaMetrics start];
+        FMResultSet *results = [db executeQuery:collection.upsertSQL withArgumentsInArray:arguments];
+        if ( [results next] ) {
+            storedID = [results stringForColumnIndex:0];
+            storedCreateTime = [results objectForColumnIndex:1];
+        }
+        [results close];
+        [DHMambaMetrics record:DHMambaMetricExecute collection:collection.name since:start];
+        if ( !storedID ) {
+            return NO;
+        }
+    }
+    else {
+        
+        FMResultSet *results = [db executeQuery:collection.selectIDWithKeySQL,objKey];
+        if ( [results next] ) {
+            storedID = [results stringForColumnIndex:0];
+            storedCreateTime = [results objectForColumnIndex:1];
+        }
+        [results close];
+        
+        if ( !storedID ) {
+            *inserted = YES;
+            return [DHMambaStore executeUpdate:collection.insertSQL database:db arguments:arguments collection:collection.name];
+        }
+        if ( ![DHMambaStore executeUpdate:collection.updateSQL database:db arguments:[collection updateArgumentsFromInsertArguments:arguments objID:storedID] collection:collection.name] ) {
+            return NO;
+        }
+    }
+    
+    *inserted = [storedID isEqualToString:arguments[0]];
+    if ( !*inserted ) {
+        [object MB_setObjID:storedID];
+        if ( [storedCreateTime isKindOfClass:[NSNumber class]] ) {
+            [object MB_setCreateTime:[NSDate dateWithTimeIntervalSince1970:[storedCreateTime doubleValue]] updateTime:[object MB_updateTime]];
+        }
+    }
+    return YES;
+}
+
++ (BOOL)updateObject:(id)object statement:(NSString *)updateSql arguments:(NSArray *)arguments collection:(DHMambaCollection *)collection database:(FMDatabase *)db inserted:(BOOL *)inserted {
+    
+    *inserted = NO;
+    if ( ![DHMambaStore executeUpdate:updateSql database:db arguments:arguments collection:collection.name] ) {
+        [collection forgetSnapshotOfObject:object];
+        return NO;
+    }
+    
+    // Nothing was updated, so the row was deleted out from under the object.
+    // An update of just the changed columns doesn't have everything needed
+    // to insert it again.
+    if ( [db changes] == 0 ) {
+        NSArray *insertArguments = nil;
+        if ( [updateSql isEqualToString:collection.updateSQL] ) {
+            insertArguments = [collection insertArgumentsFromUpdateArguments:arguments];
+        }
+        else {
+            insertArguments = [collection insertArgumentsForObject:object time:[NSDate dateWithTimeIntervalSince1970:[arguments[0] doubleValue]]];
+        }
+        return [DHMambaStore insertObject:object arguments:insertArguments collection:collection database:db inserted:inserted];
+    }
+    return YES;
+}
+
++ (BOOL)supportsUpsert {
+    
+    // RETURNING came in SQLite 3.35
+    static BOOL supported;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        supported = sqlite3_libversion_number() >= 3035000;
+    });
+    return supported;
+}
+
++ (void)postNotification:(NSString *)name objectClass:(Class)objectClass userInfo:(NSDictionary *)userInfo {
+    
+    CFAbsoluteTime start = [DHMambaMetrics start];
+    [[NSNotificationCenter defaultCenter] postNotificationName:name object:objectClass userInfo:userInfo];
+    if ( start != 0 ) {
+        [DHMambaMetrics record:DHMambaMetricNotify collection:[DHMambaCollection collectionNameForClass:objectClass] since:start];
+    }
+}
+
++ (void)inReadDatabase:(void (^)(FMDatabase *db))block {
+    
+    // Without a read pool everything shares the single serial queue
+    FMDatabasePool *readPool = staticReadPool;
+    dispatch_semaphore_t readSemaphore = staticReadSemaphore;
+    if ( !readPool ) {
+        [DHMambaStore inWriteDatabase:block];
+        return;
+    }
+    
+    // The pool hands out nil once it hits its maximum, so wait for
+    // a connection to be returned instead.
+    CFAbsoluteTime queued = [DHMambaMetrics start];
+    dispatch_semaphore_wait(readSemaphore, DISPATCH_TIME_FOREVER);
+    [readPool inDatabase:^(FMDatabase *db) {
+        [DHMambaMetrics record:DHMambaMetricQueueWait collection:nil since:queued];
+        block(db);
+    }];
+    dispatch_semaphore_signal(readSemaphore);
+}
+
++ (BOOL)databasePool:(FMDatabasePool *)pool shouldAddDatabaseToPool:(FMDatabase *)database {
+    
+    // Called every time a connection is checked out, so only configure
+    // each connection once.
+    @synchronized(staticReadConnections) {
+        if ( ![staticReadConnections containsObject:database] ) {
+            if ( ![database executeUpdate:@"PRAGMA query_only = 1"] ) {
+                NSLog(@"error configuring read connection: %@",[database lastErrorMessage]);
+            }
+            [database setShouldCacheStatements:YES];
+            [staticReadConnections addObject:database];
+        }
+    }
+    return YES;
+}
+
++ (NSArray *)classesInObjects:(NSArray *)objects {
+    
+    NSMutableArray *classes = [[NSMutableArray alloc] init];
+    for ( id object in objects ) {
+        if ( ![classes containsObject:[object class]] ) {
+            [classes addObject:[object class]];
+        }
+    }
+    return classes;
+}
+
++ (NSArray *)objects:(NSArray *)objects ofClass:(Class)objectClass {
+    
+    NSMutableArray *classObjects = [[NSMutableArray alloc] init];
+    for ( id object in objects ) {
+        if ( [object class] == objectClass ) {
+            [classObjects addObject:object];
+        }
+    }
+    return classObjects;
+}
+
++ (void)fillPropertiesOfCollection:(DHMambaCollection *)collection {
+    
+    // Go through the stored objects a batch at a time, decoding them outside
+    // of the queue so the database is only held to read and write rows.
+    NSString *selectSQL = [NSString stringWithFormat:@"select objID, updateTime, objBody from %@ where objID > ? order by objID limit %lu",collection.name,(unsigned long)kDHMambaStoreBatchSize];
+    NSString *fillSQL = [collection fillSQL];
+    __block NSString *lastID = @"";
+    BOOL more = YES;
+    while ( more ) {
+        @autoreleasepool {
+            
+            NSMutableArray *objIDs = [[NSMutableArray alloc] initWithCapacity:kDHMambaStoreBatchSize];
+            NSMutableArray *updateTimes = [[NSMutableArray alloc] initWithCapacity:kDHMambaStoreBatchSize];
+            NSMutableArray *bodies = [[NSMutableArray alloc] initWithCapacity:kDHMambaStoreBatchSize];
+            [DHMambaStore inWriteDatabase:^(FMDatabase *db) {
+                FMResultSet *results = [db executeQuery:selectSQL,lastID];
+                while ( [results next] ) {
+                    NSData *body = [results dataForColumn:@"objBody"];
+                    [objIDs addObject:[results stringForColumn:@"objID"]];
+                    [updateTimes addObject:[results objectForColumnName:@"updateTime"]];
+                    [bodies addObject:body ? body : [NSData data]];
+                }
+            }];
+            more = objIDs.count == kDHMambaStoreBatchSize;
+            lastID = [objIDs lastObject];
+            
+            NSMutableArray *batchArguments = [[NSMutableArray alloc] initWithCapacity:objIDs.count];
+            for ( NSUInteger index = 0; index < objIDs.count; index++ ) {
+                NSArray *values = [collection fillValuesForBody:bodies[index]];
+                if ( !values ) {
+                    NSLog(@"error filling indexed properties of %@ %@, its body could not be read",collection.name,objIDs[index]);
+                    continue;
+                }
+                [batchArguments addObject:[values arrayByAddingObjectsFromArray:@[objIDs[index],updateTimes[index]]]];
+            }
+            
+            [DHMambaStore inWriteTransaction:^(FMDatabase *db, BOOL *rollback) {
+                for ( NSArray *arguments in batchArguments ) {
+                    if ( ![db executeUpdate:fillSQL withArgumentsInArray:arguments] ) {
+                        NSLog(@"error filling indexed properties: %@",[db lastErrorMessage]);
+                    }
+                }
+            }];
+        }
+    }
+    [collection finishFilling];
+}
+
++ (void)inBatchesOf:(NSArray *)objects block:(void (^)(NSArray *batch))block {
+    
+    for ( NSUInteger location = 0; location < objects.count; location += kDHMambaStoreBatchSize ) {
+        @autoreleasepool {
+            NSUInteger length = MIN(kDHMambaStoreBatchSize, objects.count - location);
+            block([objects subarrayWithRange:NSMakeRange(location, length)]);
+        }
+    }
+}
 
 @end
@@ -25,6 +25,11 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "DHMambaRelationship.h"
+#import "DHMambaCompressor.h"
+
+@class DHMambaLiveQuery;
+@class DHMambaQuery;
 
 //
 // OrderBy enumeration
@@ -44,6 +49,17 @@ typedef NS_ENUM(NSUInteger, DHMambaObjectOrderBy) {
     DHMambaObjectOrderByOrderNumberDescending = 11
 };
 
+//
+// Aggregate enumeration
+//
+typedef NS_ENUM(NSUInteger, DHMambaObjectAggregate) {
+    DHMambaObjectAggregateCount = 0,
+    DHMambaObjectAggregateSum = 1,
+    DHMambaObjectAggregateMinimum = 2,
+    DHMambaObjectAggregateMaximum = 3,
+    DHMambaObjectAggregateAverage = 4
+};
+
 /**
  * Protocol for extending the object with specific properties that MambaStore
  * will use when saving/loading the object.
@@ -85,6 +101,85 @@ typedef NS_ENUM(NSUInteger, DHMambaObjectOrderBy) {
  */
 - (NSArray *)mambaObjectIgnoreProperties;
 
+/** Return the built in columns that should be indexed for this class. Valid
+ * columns are objKey, objForeignKey, objTitle, orderNumber, createTime and
+ * updateTime. If not implemented all of them are indexed.
+ * @return An array of column names (NSString)
+ */
++ (NSArray *)mambaObjectIndexedColumns;
+
+/** Return the built in columns that should be kept in a full text index. Valid
+ * columns are objKey, objTitle and objForeignKey. The MB_findIn* and MB_countLike*
+ * methods use the index for these columns instead of scanning the collection.
+ * @return An array of column names (NSString)
+ */
++ (NSArray *)mambaObjectFullTextColumns;
+
+/** Return properties of this class that should be stored in their own indexed
+ * column so they can be used in MB_search and MB_count criteria. Properties
+ * can be any number type, NSNumber, NSString or NSDate. Dates are stored as
+ * seconds since 1970, the same as createTime and updateTime. A property added
+ * to a collection that already has objects is filled in from their bodies the
+ * first time the class is used, and that first use blocks until every object
+ * has been decoded once.
+ * @return An array of property names (NSString)
+ */
++ (NSArray *)mambaObjectIndexedProperties;
+
+/** Return the number of objects of this class to keep in memory. MB_loadWithID and
+ * MB_findWithKey return cached objects without going to the store, and every
+ * lookup of the same stored object returns the same instance. Once the limit is
+ * reached the least recently used object is dropped. If not implemented nothing
+ * is cached.
+ * @return The maximum number of objects to cache
+ */
++ (NSUInteger)mambaObjectCacheLimit;
+
+/** Return YES if no two objects of this class can have the same key. The
+ * collection gets a unique index on objKey, and saving a new object whose key
+ * is already stored updates that row instead of adding another one. The
+ * object takes over the stored objID and createTime. The class has to
+ * implement mambaObjectKey. If not implemented keys don't have to be unique.
+ * @return YES if keys are unique
+ */
++ (BOOL)mambaObjectUniqueKey;
+
+/** Return YES to remember what each object looked like when it was loaded or
+ * last saved. Saving an object that hasn't changed then doesn't write
+ * anything, and saving one that has only writes the columns that changed.
+ * The body is still encoded to find out, but only written when a property
+ * in it changed. Changes saved through another instance of the same object
+ * aren't seen, so use it with mambaObjectCacheLimit. If not implemented
+ * every save writes the whole object.
+ * @return YES to track changes
+ */
++ (BOOL)mambaObjectTracksChanges;
+
+/** Return how the bodies of objects of this class should be compressed.
+ * Objects saved before compression was turned on (or changed) can still be
+ * loaded. If not implemented bodies aren't compressed.
+ * @return The compression to use
+ */
++ (DHMambaCompression)mambaObjectCompression;
+
+/** Return sample data for zlib compression to start from, such as the encoded
+ * body of a typical object. Small objects that repeat the same property names
+ * and values compress much better with one. The dictionary must never change
+ * once objects have been saved with it, so return the same bytes every time.
+ * Bodies record a checksum of their dictionary, and ones saved with another
+ * dictionary log an error and are left out of what is loaded.
+ * @return The dictionary
+ */
++ (NSData *)mambaObjectCompressionDictionary;
+
+/** Return the parent/child relationships of this class. Children are loaded
+ * along with their parents, a single query per relationship for every set of
+ * parents loaded together. Saving or deleting a parent saves or deletes its
+ * children in the same transaction.
+ * @return An array of DHMambaRelationship
+ */
++ (NSArray *)mambaObjectRelationships;
+
 @end
 
 /** Protocol for extending the object with methods that allow you to customize
@@ -93,7 +188,10 @@ typedef NS_ENUM(NSUInteger, DHMambaObjectOrderBy) {
 @protocol DHMambaObjectMethods <NSObject>
 @optional
 
-/** Called after the object is saved into the repository */
+/** Called after the object is saved into the repository. With write behind on
+ * this happens when the queued object is written, on the thread doing the
+ * flush, and only once however many times it was saved while waiting.
+ */
 - (void)mambaAfterSave;
 
 /** Called after the object is loaded from the repository */
@@ -155,8 +253,8 @@ typedef NS_ENUM(NSUInteger, DHMambaObjectOrderBy) {
 - (NSNumber *)MB_objOrderNumber;
 
 /** Returns the archived data for the object in the store. The data is created
- * using the KeyedArchiver either automatically, or manually if you implement the
- * NSCoding protocol.
+ * using the KeyedArchiver if you implement the NSCoding protocol, otherwise the
+ * properties are encoded automatically with DHMambaCoder.
  * @return the archived data
  */
 - (NSData *)MB_objData;
@@ -171,12 +269,42 @@ typedef NS_ENUM(NSUInteger, DHMambaObjectOrderBy) {
  */
 - (NSDate *)MB_updateTime;
 
+/** Sets the store timestamps on the object. Called by the store after the
+ * object is saved.
+ * @param createTime The create time, or nil to leave it as is
+ * @param updateTime The update time
+ */
+- (void)MB_setCreateTime:(NSDate *)createTime updateTime:(NSDate *)updateTime;
+
+/** Returns the properties that changed since the object was loaded or last
+ * saved. Only known for classes that track changes, see
+ * mambaObjectTracksChanges.
+ * @return The names of the changed properties (NSString), or nil if the class
+ * doesn't track changes or the object hasn't been stored
+ */
+- (NSSet *)MB_changedProperties;
+
+/** Points the object at a stored row. Called by the store when a new object
+ * is saved with the key of an object that is already stored.
+ * @param objID The objID of the stored row
+ */
+- (void)MB_setObjID:(NSString *)objID;
+
 #pragma mark - CRUD methods
 /** Saves the object into the store. If it hasn't been saved to the store already
- * it will be inserted. If it already exists in the store it will be updated.
+ * it will be inserted. If it already exists in the store it will be updated,
+ * and if its row has gone missing it is inserted again. New objects of classes
+ * with a unique key update the stored object with the same key.
  */
 - (void)MB_save;
 
+/** Saves an array of objects into the store. Objects that haven't been saved
+ * yet are inserted and the rest are updated. The writes are grouped into
+ * transactions, so this is much faster than calling MB_save on each object.
+ * @param objects The objects to save
+ */
++ (void)MB_saveAll:(NSArray *)objects;
+
 /** Deletes the object from the store.
  */
 - (void)MB_delete;
@@ -482,6 +610,246 @@ typedef NS_ENUM(NSUInteger, DHMambaObjectOrderBy) {
  */
 + (NSArray *)MB_updatedFrom:(NSDate *)from to:(NSDate *)to limit:(NSUInteger)limit;
 
+//
+// Full text searching
+//
+
+/** Find objects containing some text in any of their full text columns, with the best
+ * matches first. Without a full text index this falls back to a like search ordered
+ * by order number.
+ * @param text The text to search for
+ * @param limit The maximum number of objects to return
+ * @return An array of found objects
+ */
++ (NSArray *)MB_searchText:(NSString *)text limit:(NSUInteger)limit;
+
+//
+// Searching with criteria
+//
+
+/** Find objects matching some criteria. The criteria are SQL expressions that
+ * can use the built in columns and any properties returned by
+ * mambaObjectIndexedProperties, for example @"population > :population".
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param limit The maximum number of objects to return
+ * @param orderBy The order to return the objects in
+ * @return An array of found objects
+ */
++ (NSArray *)MB_search:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy;
+
+/** Find objects matching some criteria, loading only some of their
+ * relationships. Children of all the found objects are loaded with a single
+ * query per relationship.
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param limit The maximum number of objects to return
+ * @param orderBy The order to return the objects in
+ * @param relationships The names of the relationships to load, an empty array
+ * for none, or nil for all of them
+ * @return An array of found objects
+ */
++ (NSArray *)MB_search:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy including:(NSArray *)relationships;
+
+/** Find a page of objects matching some criteria. Pages seek past the last object
+ * of the previous page, so every page costs the same to load and objects inserted
+ * while paging don't shift later pages.
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param limit The number of objects in a page
+ * @param orderBy The order to return the objects in
+ * @param token The nextToken from the previous page, or nil for the first page
+ * @param nextToken Set to the token for the following page, or nil if this is the
+ * last page. Use it with the same criteria and order.
+ * @return An array of found objects
+ */
++ (NSArray *)MB_search:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy after:(NSString *)token nextToken:(NSString **)nextToken;
+
+/** Find a page of all the objects. See MB_search:parameters:limit:orderBy:after:nextToken:.
+ * @param limit The number of objects in a page
+ * @param orderBy The order to return the objects in
+ * @param token The nextToken from the previous page, or nil for the first page
+ * @param nextToken Set to the token for the following page, or nil if this is the last page
+ * @return An array of found objects
+ */
++ (NSArray *)MB_findAllLimit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy after:(NSString *)token nextToken:(NSString **)nextToken;
+
+//
+// Queries. A DHMambaQuery can combine conditions with and, or and not, and
+// order by several columns. See DHMambaQuery.
+//
+
+/** Finds the objects matching a query.
+ * @param query A query for this class
+ * @return An array of found objects, or nil if the query can't be run
+ */
++ (NSArray *)MB_find:(DHMambaQuery *)query;
+
+/** Counts the objects matching a query. The limit and offset are ignored.
+ * @param query A query for this class
+ * @return The number of objects, or nil if the query can't be run
+ */
++ (NSNumber *)MB_countFor:(DHMambaQuery *)query;
+
+/** Finds the objects matching a predicate on the built in columns and
+ * indexed properties, such as [NSPredicate predicateWithFormat:@"city IN %@ AND
+ * orderNumber > 10",cities]. See DHMambaCondition conditionWithPredicate:.
+ * @param predicate The predicate
+ * @param limit The maximum number of objects, or 0 for all of them
+ * @param orderBy The order to return the objects in
+ * @return An array of found objects, or nil if the predicate can't be translated
+ */
++ (NSArray *)MB_findMatching:(NSPredicate *)predicate limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy;
+
+//
+// Live queries
+//
+
+/** Runs a search once and keeps its results up to date as objects are saved
+ * and deleted, without running the search again. See DHMambaLiveQuery.
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param limit The maximum number of objects, or 0 for all of them
+ * @param orderBy The order to keep the objects in
+ * @return The live query
+ */
++ (DHMambaLiveQuery *)MB_liveQuery:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy;
+
+//
+// Projections. These read columns straight from the rows, without decoding
+// the stored objects, which is much cheaper for lists that only show a few
+// values.
+//
+
+/** Reads some columns of the objects matching the criteria. Only the built in
+ * columns (objID, objKey, objForeignKey, objTitle, orderNumber, createTime,
+ * updateTime) and indexed properties can be selected.
+ * @param columns The column names (NSString) to read
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param limit The maximum number of rows, or 0 for all of them
+ * @param orderBy The order to return the rows in
+ * @return An array of NSDictionary, one per row, keyed by column name. Dates
+ * are NSDate and null columns are left out. Nil if a column can't be selected.
+ */
++ (NSArray *)MB_select:(NSArray *)columns criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy;
+
+/** Like MB_search:parameters:limit:orderBy: but returns DHMambaFault proxies
+ * in place of the objects. A fault answers the MB_ values and its indexed
+ * properties from the row, and only loads the object when anything else is
+ * asked of it.
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param limit The maximum number of objects, or 0 for all of them
+ * @param orderBy The order to return the objects in
+ * @return An array of faults
+ */
++ (NSArray *)MB_searchFaults:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy;
+
+//
+// Async methods. These return right away and run on the store's queue. Saves
+// and deletes run one at a time in the order they were called, and loads, finds
+// and counts run side by side after them, so a find queued after a save sees
+// the saved objects. Completions are called on the given queue, or the main
+// queue if it is nil. Cancelling the returned operation before it finishes
+// skips the completion. If too many operations are waiting nothing is queued,
+// nil is returned and the completion isn't called, see
+// [DHMambaStore canPerformAsync].
+//
+
+/** Saves objects without blocking the caller. Don't change the objects until the
+ * completion is called.
+ * @param objects The objects to save
+ * @param queue The queue to call the completion on
+ * @param completion Called once the objects are saved
+ * @return The queued operation
+ */
++ (NSOperation *)MB_saveAsync:(NSArray *)objects queue:(dispatch_queue_t)queue completion:(void (^)(void))completion;
+
+/** Deletes objects without blocking the caller.
+ * @param objects The objects to delete
+ * @param queue The queue to call the completion on
+ * @param completion Called once the objects are deleted
+ * @return The queued operation
+ */
++ (NSOperation *)MB_deleteAsync:(NSArray *)objects queue:(dispatch_queue_t)queue completion:(void (^)(void))completion;
+
+/** Loads an object by ID without blocking the caller.
+ * @param objectID The ID of the object
+ * @param queue The queue to call the completion on
+ * @param completion Called with the object, or nil if it wasn't found
+ * @return The queued operation
+ */
++ (NSOperation *)MB_loadWithIDAsync:(NSString *)objectID queue:(dispatch_queue_t)queue completion:(void (^)(id object))completion;
+
+/** Finds all the objects without blocking the caller.
+ * @param queue The queue to call the completion on
+ * @param completion Called with the found objects
+ * @return The queued operation
+ */
++ (NSOperation *)MB_findAllAsync:(dispatch_queue_t)queue completion:(void (^)(NSArray *objects))completion;
+
+/** Finds objects matching some criteria without blocking the caller. See
+ * MB_search:parameters:limit:orderBy:.
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param limit The maximum number of objects to return
+ * @param orderBy The order to return the objects in
+ * @param queue The queue to call the completion on
+ * @param completion Called with the found objects
+ * @return The queued operation
+ */
++ (NSOperation *)MB_searchAsync:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy queue:(dispatch_queue_t)queue completion:(void (^)(NSArray *objects))completion;
+
+/** Counts objects matching some criteria without blocking the caller. See
+ * MB_count:parameters:.
+ * @param criteria A SQL expression, or an empty string to count everything
+ * @param parameters The values for the named parameters in the criteria
+ * @param queue The queue to call the completion on
+ * @param completion Called with the count
+ * @return The queued operation
+ */
++ (NSOperation *)MB_countAsync:(NSString *)criteria parameters:(NSDictionary *)parameters queue:(dispatch_queue_t)queue completion:(void (^)(NSNumber *count))completion;
+
+//
+// Object cache
+//
+
+/** The number of MB_loadWithID and MB_findWithKey lookups answered from the
+ * cache. See mambaObjectCacheLimit.
+ * @return The number of cache hits
+ */
++ (NSUInteger)MB_cacheHits;
+
+/** The number of MB_loadWithID and MB_findWithKey lookups that had to go to
+ * the store.
+ * @return The number of cache misses
+ */
++ (NSUInteger)MB_cacheMisses;
+
+/** Removes every object of this class from the cache. */
++ (void)MB_clearCache;
+
+//
+// Enumerating without loading everything
+//
+
+/** Calls a block with every object in the store, in order number order. Objects
+ * are loaded a chunk at a time, so memory use stays flat however large the
+ * collection is.
+ * @param block The block to call with each object. Set stop to YES to end early.
+ */
++ (void)MB_enumerateAllUsingBlock:(void (^)(id object, BOOL *stop))block;
+
+/** Calls a block with every object matching some criteria. Objects are loaded a
+ * chunk at a time, and the store isn't held while the block runs.
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @param orderBy The order to return the objects in
+ * @param block The block to call with each object. Set stop to YES to end early.
+ */
++ (void)MB_enumerate:(NSArray *)criteria parameters:(NSDictionary *)parameters orderBy:(DHMambaObjectOrderBy)orderBy usingBlock:(void (^)(id object, BOOL *stop))block;
+
 #pragma mark - Count Methods
 
 /** Count the number of objects in the store
@@ -546,4 +914,50 @@ typedef NS_ENUM(NSUInteger, DHMambaObjectOrderBy) {
  */
 + (NSNumber *)MB_countUpdatedFrom:(NSDate *)fromDate to:(NSDate *)toDate;
 
+/** Count the number of objects matching some criteria. See MB_search for the
+ * columns the criteria can use.
+ * @param criteria A SQL expression, or an empty string to count everything
+ * @param parameters The values for the named parameters in the criteria
+ * @return The count of objects found
+ */
++ (NSNumber *)MB_count:(NSString *)criteria parameters:(NSDictionary *)parameters;
+
+#pragma mark - Aggregate Methods
+
+/** Calculates an aggregate of a column in a single query. Columns can be the
+ * built in columns or any properties returned by mambaObjectIndexedProperties.
+ * Integers come back as 64 bit numbers. The minimum, maximum and average of
+ * date columns come back as NSDate.
+ * @param aggregate The aggregate to calculate
+ * @param column The column, or nil to count objects
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @return The result, or nil if there were no values
+ */
++ (id)MB_aggregate:(DHMambaObjectAggregate)aggregate ofColumn:(NSString *)column criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters;
+
+/** Calculates an aggregate of a column for each value of another column.
+ * @param aggregate The aggregate to calculate
+ * @param column The column, or nil to count objects
+ * @param groupColumn The column to group the objects by
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @return A dictionary of group value to result. Nulls are NSNull.
+ */
++ (NSDictionary *)MB_aggregate:(DHMambaObjectAggregate)aggregate ofColumn:(NSString *)column groupedBy:(NSString *)groupColumn criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters;
+
+/** Counts the objects for each value of a column, for example each foreign key.
+ * @param column The column to group the objects by
+ * @return A dictionary of value to count
+ */
++ (NSDictionary *)MB_countGroupedBy:(NSString *)column;
+
+/** Returns the different values of a column, in order.
+ * @param column The column
+ * @param criteria An array of expressions (NSString) that must all match
+ * @param parameters The values for the named parameters in the criteria
+ * @return An array of values. Nulls are NSNull.
+ */
++ (NSArray *)MB_distinct:(NSString *)column criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters;
+
 @end
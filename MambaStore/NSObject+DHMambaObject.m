@@ -26,6 +26,13 @@
 
 #import "NSObject+DHMambaObject.h"
 #import "DHMambaStore.h"
+#import "DHMambaCollection.h"
+#import "DHMambaCoder.h"
+#import "DHMambaAccessPlan.h"
+#import "DHMambaLiveQuery.h"
+#import "DHMambaFault.h"
+#import "DHMambaQuery.h"
+#import "DHMambaMetrics.h"
 #import <Objc/runtime.h>
 
 //
@@ -35,6 +42,13 @@ static char const * const DHMambaObjectIDKey = "MambaObjectID";
 static char const * const DHMambaObjectCreateTimeKey = "MambaObjectCreateTime";
 static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 
+// Number of objects loaded at a time by the enumerate methods
+static NSUInteger const kDHMambaObjectEnumerateChunkSize = 100;
+
+// Number of parent keys in each query loading children. SQLite allows 999
+// parameters in a statement by default.
+static NSUInteger const kDHMambaObjectRelationshipChunkSize = 500;
+
 @implementation NSObject (DHMambaObject)
 
 
@@ -118,29 +132,15 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     }
     else {
     
-        // Object data is actually an NSCoded version of the object, aquired automatically by inspecting the class to
-        // see which properties exist and have backing iVars. We also cache this knowledge so we only have to do it once
-        // per class.
-        NSArray *properties = [self MB_class_propertyNames];
-
-        // See if the object has any properties that we should not encode
+        // Object data is a compact binary encoding of the object, aquired automatically by inspecting the class to
+        // see which properties exist and have backing iVars. We also cache this knowledge (and how to get at each
+        // property) so we only have to do it once per class.
         NSArray *ignoreList = nil;
         if ( [self respondsToSelector:@selector(mambaObjectIgnoreProperties)] ) {
             ignoreList = [self performSelector:@selector(mambaObjectIgnoreProperties)];
         }
 
-        // Archive it baby!
-        NSMutableData *bodyArchive = [NSMutableData data];
-        NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:bodyArchive];
-        for ( NSString *property in properties ) {
-        
-            // exclude child collections
-            if ( !ignoreList || ![ignoreList containsObject:property] ) {
-                [archiver encodeObject:[self valueForKey:property] forKey:property];
-            }
-        }
-        [archiver finishEncoding];
-        return bodyArchive;
+        return [DHMambaCoder encodeObject:self ignoring:ignoreList];
     }
 }
 
@@ -170,13 +170,44 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     }
 }
 
+- (void)MB_setCreateTime:(NSDate *)createTime updateTime:(NSDate *)updateTime {
+    
+    if ( createTime ) {
+        objc_setAssociatedObject(self, DHMambaObjectCreateTimeKey, createTime, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    objc_setAssociatedObject(self, DHMambaObjectUpdateTimeKey, updateTime, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+- (NSSet *)MB_changedProperties {
+    
+    return [[DHMambaCollection collectionForClass:[self class]] changedPropertiesOfObject:self];
+}
+
+- (void)MB_setObjID:(NSString *)objID {
+    
+    objc_setAssociatedObject(self, DHMambaObjectIDKey, objID, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
 
 #pragma mark - CRUD methods
 - (void)MB_save {
     
+    // Children are saved in the same transaction as their parent
+    if ( [[self class] MB_objectsHaveRelationships:@[self]] ) {
+        [[self class] MB_saveObjectGraph:@[self]];
+        return;
+    }
+    
     // if this object hasn't been in the store yet, we
-    // need to insert it, otherwise update it.
-    if ( ![self MB_has_objID] ) {
+    // need to insert it, otherwise update it. With write behind
+    // on it is queued instead, and the store calls mambaAfterSave
+    // once it is written.
+    if ( [DHMambaStore writeBehindEnabled] ) {
+        if ( [DHMambaStore saveObjects:@[self]] ) {
+            return;
+        }
+    }
+    else if ( ![self MB_has_objID] ) {
         [DHMambaStore insertObject:self];
     }
     else {
@@ -188,8 +219,32 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     }
 }
 
++ (void)MB_saveAll:(NSArray *)objects {
+    
+    if ( [self MB_objectsHaveRelationships:objects] ) {
+        [self MB_saveObjectGraph:objects];
+        return;
+    }
+    
+    if ( [DHMambaStore saveObjects:objects] ) {
+        return;
+    }
+    
+    for ( id object in objects ) {
+        if ( [object respondsToSelector:@selector(mambaAfterSave)] ) {
+            [object performSelector:@selector(mambaAfterSave)];
+        }
+    }
+}
+
 - (void)MB_delete {
     
+    // Children are deleted in the same transaction as their parent
+    if ( [[self class] MB_objectsHaveRelationships:@[self]] ) {
+        [[self class] MB_deleteObjectGraph:@[self]];
+        return;
+    }
+    
     [DHMambaStore deleteObject:self];
 
     if ( [self respondsToSelector:@selector(mambaAfterDelete)] ) {
@@ -206,30 +261,47 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 #pragma mark - Search methods
 + (id)MB_loadWithID:(NSString *)objectID
 {
-    // get the default collection name
-    NSString *collection = [NSStringFromClass([self class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    // An object waiting to be written is newer than what's in the store
+    id pendingObject = [DHMambaStore pendingObjectOfClass:[self class] withID:objectID];
+    if ( pendingObject ) {
+        return pendingObject;
+    }
+    
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[self class]];
+    id cachedObject = [collection cachedObjectWithID:objectID];
+    if ( cachedObject ) {
+        return cachedObject;
+    }
     
     __block id resultObject = nil;
-    [DHMambaStore selectFromCollection:collection where:@"objID = :objID" parameters:@{@"objID":objectID} order:DHMambaObjectOrderByOrderNumber limit:0 resultBlock:^(FMResultSet *results) {
+    [DHMambaStore selectObjectOfClass:[self class] withID:objectID resultBlock:^(FMResultSet *results) {
         
         resultObject = [self MB_unarchive_withResults:results];
     }];
     [self MB_performAfterLoad:resultObject];
-    return resultObject;
+    return [collection cacheLoadedObject:resultObject key:nil];
 }
 
 + (id)MB_findWithKey:(NSString *)key {
     
-    // get the default collection name
-    NSString *collection = [NSStringFromClass([self class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    id pendingObject = [DHMambaStore pendingObjectOfClass:[self class] withKey:key];
+    if ( pendingObject ) {
+        return pendingObject;
+    }
+    
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[self class]];
+    id cachedObject = [collection cachedObjectWithKey:key];
+    if ( cachedObject ) {
+        return cachedObject;
+    }
     
     __block id resultObject = nil;
-    [DHMambaStore selectFromCollection:collection where:@"objKey = :objKey" parameters:@{@"objKey":key} order:DHMambaObjectOrderByOrderNumber limit:0 resultBlock:^(FMResultSet *results) {
+    [DHMambaStore selectObjectOfClass:[self class] withKey:key resultBlock:^(FMResultSet *results) {
         
         resultObject = [self MB_unarchive_withResults:results];
     }];
     [self MB_performAfterLoad:resultObject];
-    return resultObject;
+    return [collection cacheLoadedObject:resultObject key:key];
 }
 
 + (NSArray *)MB_findAll
@@ -252,6 +324,11 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     return [self MB_search:@[] parameters:@{} limit:limit orderBy:orderBy];
 }
 
++ (NSArray *)MB_findAllLimit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy after:(NSString *)token nextToken:(NSString **)nextToken
+{
+    return [self MB_search:@[] parameters:@{} limit:limit orderBy:orderBy after:token nextToken:nextToken];
+}
+
 + (NSArray *)MB_findInKey:(NSString *)key
 {
     return [self MB_findInKey:key limit:0 orderBy:DHMambaObjectOrderByOrderNumber];
@@ -269,7 +346,7 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 
 + (NSArray *)MB_findInKey:(NSString *)key limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy
 {
-    return [self MB_search:@[@"objKey like :objKey"] parameters:@{@"objKey":[NSString stringWithFormat:@"%%%@%%",key]} limit:limit orderBy:orderBy];
+    return [self MB_search:@[[self MB_criteriaForColumn:@"objKey" containing:key]] parameters:@{@"objKey":[self MB_parameterForColumn:@"objKey" containing:key]} limit:limit orderBy:orderBy];
 }
 
 + (NSArray *)MB_findWithTitle:(NSString *)title
@@ -309,7 +386,7 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 
 + (NSArray *)MB_findInTitle:(NSString *)title limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy
 {
-    return [self MB_search:@[@"objTitle like :objTitle"] parameters:@{@"objTitle":[NSString stringWithFormat:@"%%%@%%",title]} limit:limit orderBy:orderBy];
+    return [self MB_search:@[[self MB_criteriaForColumn:@"objTitle" containing:title]] parameters:@{@"objTitle":[self MB_parameterForColumn:@"objTitle" containing:title]} limit:limit orderBy:orderBy];
 }
 
 + (NSArray *)MB_findWithForeignKey:(NSString *)foreignKey
@@ -349,7 +426,7 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 
 + (NSArray *)MB_findInForeignKey:(NSString *)foreignKey limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy
 {
-    return [self MB_search:@[@"objForeignKey like :objForeignKey"] parameters:@{@"objForeignKey":[NSString stringWithFormat:@"%%%@%%",foreignKey]} limit:limit orderBy:orderBy];
+    return [self MB_search:@[[self MB_criteriaForColumn:@"objForeignKey" containing:foreignKey]] parameters:@{@"objForeignKey":[self MB_parameterForColumn:@"objForeignKey" containing:foreignKey]} limit:limit orderBy:orderBy];
 }
 
 + (NSArray *)MB_findWithOrderNumberFrom:(NSNumber *)from to:(NSNumber *)to
@@ -412,6 +489,237 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     return [self MB_search:@[@"updateTime >= :fromTime",@"updateTime <= :toTime"] parameters:@{@"fromTime":from,@"toTime":to} limit:limit orderBy:DHMambaObjectOrderByOrderNumber];
 }
 
++ (NSArray *)MB_searchText:(NSString *)text limit:(NSUInteger)limit
+{
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[self class]];
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    
+    // Without a usable full text index just do a like on the searchable columns
+    if ( !collection.fullTextEnabled || text.length < 3 ) {
+        NSArray *columns = collection.fullTextColumns.count > 0 ? collection.fullTextColumns : @[@"objKey",@"objTitle"];
+        NSString *criteria = [NSString stringWithFormat:@"(%@ like :text)",[columns componentsJoinedByString:@" like :text or "]];
+        return [self MB_search:@[criteria] parameters:@{@"text":[NSString stringWithFormat:@"%%%@%%",text]} limit:limit orderBy:DHMambaObjectOrderByOrderNumber];
+    }
+    
+    NSString *querySql = [NSString stringWithFormat:@"select %@.* from %@ join %@ on %@.objTextID = %@.rowid where %@ match ? order by %@.rank",collection.name,collection.name,collection.fullTextName,collection.name,collection.fullTextName,collection.fullTextName,collection.fullTextName];
+    NSArray *arguments = @[[collection fullTextQueryForColumn:nil term:text]];
+    if ( limit > 0 ) {
+        querySql = [querySql stringByAppendingString:@" limit ?"];
+        arguments = [arguments arrayByAddingObject:[NSNumber numberWithUnsignedInteger:limit]];
+    }
+    
+    NSMutableArray *resultArray = [[NSMutableArray alloc] init];
+    [DHMambaStore selectWithSQL:querySql arguments:arguments resultBlock:^(FMResultSet *results) {
+        id resultObject = [self MB_unarchive_withResults:results];
+        if ( resultObject ) {
+            [resultArray addObject:resultObject];
+        }
+    }];
+    [self MB_performAfterLoadOnArray:resultArray];
+    return resultArray;
+}
+
+#pragma mark - Query Methods
+
++ (NSArray *)MB_find:(DHMambaQuery *)query
+{
+    NSArray *arguments = nil;
+    NSString *querySql = [self MB_sqlForQuery:query selecting:@"*" arguments:&arguments];
+    if ( !querySql ) {
+        return nil;
+    }
+    
+    NSMutableArray *resultArray = [[NSMutableArray alloc] init];
+    [DHMambaStore selectWithSQL:querySql arguments:arguments resultBlock:^(FMResultSet *results) {
+        id resultObject = [self MB_unarchive_withResults:results];
+        if ( resultObject ) {
+            [resultArray addObject:resultObject];
+        }
+    }];
+    [self MB_performAfterLoadOnArray:resultArray];
+    return resultArray;
+}
+
++ (NSNumber *)MB_countFor:(DHMambaQuery *)query
+{
+    DHMambaQuery *countQuery = [DHMambaQuery queryForClass:query.objectClass condition:query.condition];
+    NSArray *arguments = nil;
+    NSString *querySql = [self MB_sqlForQuery:countQuery selecting:@"count(*)" arguments:&arguments];
+    if ( !querySql ) {
+        return nil;
+    }
+    
+    __block NSNumber *count = nil;
+    [DHMambaStore selectWithSQL:querySql arguments:arguments resultBlock:^(FMResultSet *results) {
+        count = [NSNumber numberWithLongLong:[results longLongIntForColumnIndex:0]];
+    }];
+    return count;
+}
+
++ (NSArray *)MB_findMatching:(NSPredicate *)predicate limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy
+{
+    DHMambaCondition *condition = [DHMambaCondition conditionWithPredicate:predicate];
+    if ( !condition ) {
+        return nil;
+    }
+    
+    DHMambaQuery *query = [DHMambaQuery queryForClass:[self class] condition:condition];
+    [query orderBy:[DHMambaStore orderColumnFor:orderBy] descending:[DHMambaStore orderIsDescending:orderBy]];
+    query.limit = limit;
+    return [self MB_find:query];
+}
+
+#pragma mark - Live Query Methods
+
++ (DHMambaLiveQuery *)MB_liveQuery:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy
+{
+    return [DHMambaLiveQuery liveQueryForClass:[self class] criteria:criteria parameters:parameters orderBy:orderBy limit:limit];
+}
+
+#pragma mark - Projection Methods
+
++ (NSArray *)MB_select:(NSArray *)columns criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy
+{
+    NSMutableArray *quoted = [[NSMutableArray alloc] init];
+    for ( NSString *column in columns ) {
+        if ( ![self MB_checkColumn:column] ) {
+            return nil;
+        }
+        [quoted addObject:[NSString stringWithFormat:@"\"%@\"",column]];
+    }
+    
+    NSMutableArray *rows = [[NSMutableArray alloc] init];
+    [self MB_selectColumns:[quoted componentsJoinedByString:@", "] criteria:criteria parameters:parameters limit:limit orderBy:orderBy resultBlock:^(FMResultSet *results) {
+        [rows addObject:[self MB_valuesOfColumns:columns withResults:results]];
+    }];
+    return rows;
+}
+
++ (NSArray *)MB_searchFaults:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy
+{
+    // Everything but the body
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[self class]];
+    NSMutableArray *columns = [NSMutableArray arrayWithObjects:@"objID",@"objKey",@"objForeignKey",@"objTitle",@"orderNumber",@"createTime",@"updateTime",nil];
+    [columns addObjectsFromArray:collection.indexedProperties];
+    NSMutableArray *quoted = [[NSMutableArray alloc] init];
+    for ( NSString *column in columns ) {
+        [quoted addObject:[NSString stringWithFormat:@"\"%@\"",column]];
+    }
+    
+    NSMutableArray *faults = [[NSMutableArray alloc] init];
+    [self MB_selectColumns:[quoted componentsJoinedByString:@", "] criteria:criteria parameters:parameters limit:limit orderBy:orderBy resultBlock:^(FMResultSet *results) {
+        [faults addObject:[DHMambaFault faultForClass:[self class] values:[self MB_valuesOfColumns:columns withResults:results]]];
+    }];
+    return faults;
+}
+
+#pragma mark - Async Methods
+
++ (NSOperation *)MB_saveAsync:(NSArray *)objects queue:(dispatch_queue_t)queue completion:(void (^)(void))completion
+{
+    return [DHMambaStore performAsync:^id{
+        [self MB_saveAll:objects];
+        return nil;
+    } queue:queue completion:completion ? ^(id result) { completion(); } : nil];
+}
+
++ (NSOperation *)MB_deleteAsync:(NSArray *)objects queue:(dispatch_queue_t)queue completion:(void (^)(void))completion
+{
+    return [DHMambaStore performAsync:^id{
+        for ( id object in objects ) {
+            [object MB_delete];
+        }
+        return nil;
+    } queue:queue completion:completion ? ^(id result) { completion(); } : nil];
+}
+
++ (NSOperation *)MB_loadWithIDAsync:(NSString *)objectID queue:(dispatch_queue_t)queue completion:(void (^)(id object))completion
+{
+    return [DHMambaStore performAsync:^id{
+        return [self MB_loadWithID:objectID];
+    } writes:NO queue:queue completion:completion];
+}
+
++ (NSOperation *)MB_findAllAsync:(dispatch_queue_t)queue completion:(void (^)(NSArray *objects))completion
+{
+    return [self MB_searchAsync:@[] parameters:@{} limit:0 orderBy:DHMambaObjectOrderByOrderNumber queue:queue completion:completion];
+}
+
++ (NSOperation *)MB_searchAsync:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy queue:(dispatch_queue_t)queue completion:(void (^)(NSArray *objects))completion
+{
+    return [DHMambaStore performAsync:^id{
+        return [self MB_search:criteria parameters:parameters limit:limit orderBy:orderBy];
+    } writes:NO queue:queue completion:completion];
+}
+
++ (NSOperation *)MB_countAsync:(NSString *)criteria parameters:(NSDictionary *)parameters queue:(dispatch_queue_t)queue completion:(void (^)(NSNumber *count))completion
+{
+    return [DHMambaStore performAsync:^id{
+        return [self MB_count:criteria parameters:parameters];
+    } writes:NO queue:queue completion:completion];
+}
+
+#pragma mark - Cache Methods
+
++ (NSUInteger)MB_cacheHits
+{
+    return [DHMambaCollection collectionForClass:[self class]].cacheHits;
+}
+
++ (NSUInteger)MB_cacheMisses
+{
+    return [DHMambaCollection collectionForClass:[self class]].cacheMisses;
+}
+
++ (void)MB_clearCache
+{
+    [[DHMambaCollection collectionForClass:[self class]] removeAllCachedObjects];
+}
+
+#pragma mark - Enumerate Methods
+
++ (void)MB_enumerateAllUsingBlock:(void (^)(id object, BOOL *stop))block
+{
+    [self MB_enumerate:@[] parameters:@{} orderBy:DHMambaObjectOrderByOrderNumber usingBlock:block];
+}
+
++ (void)MB_enumerate:(NSArray *)criteria parameters:(NSDictionary *)parameters orderBy:(DHMambaObjectOrderBy)orderBy usingBlock:(void (^)(id object, BOOL *stop))block
+{
+    if ( !block ) {
+        return;
+    }
+    
+    NSString *collection = [NSStringFromClass([self class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    NSString *where = [criteria componentsJoinedByString:@" and "];
+    
+    NSString *token = nil;
+    BOOL stop = NO;
+    do {
+        
+        // Only one chunk is decoded at a time, and the read is finished
+        // before the block sees any of it.
+        @autoreleasepool {
+            
+            NSMutableArray *chunk = [[NSMutableArray alloc] initWithCapacity:kDHMambaObjectEnumerateChunkSize];
+            token = [DHMambaStore selectPageFromCollection:collection where:where parameters:parameters order:orderBy limit:kDHMambaObjectEnumerateChunkSize after:token resultBlock:^(FMResultSet *results) {
+                
+                id object = [self MB_unarchive_withResults:results];
+                if ( object ) {
+                    [chunk addObject:object];
+                }
+            }];
+            [self MB_performAfterLoadOnArray:chunk];
+            
+            for ( id object in chunk ) {
+                block(object, &stop);
+                if ( stop ) {
+                    break;
+                }
+            }
+        }
+    } while ( token && !stop );
+}
 
 #pragma mark - Count Methods
 
@@ -427,7 +735,7 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 
 + (NSNumber *)MB_countLikeKey:(NSString *)key
 {
-    return [self MB_count:@"objKey like :objKey" parameters:@{@"objKey":[NSString stringWithFormat:@"%%%@%%",key]}];
+    return [self MB_count:[self MB_criteriaForColumn:@"objKey" containing:key] parameters:@{@"objKey":[self MB_parameterForColumn:@"objKey" containing:key]}];
 }
 
 + (NSNumber *)MB_countWithTitle:(NSString *)title
@@ -437,7 +745,7 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 
 + (NSNumber *)MB_countLikeTitle:(NSString *)title
 {
-    return [self MB_count:@"objTitle like :objTitle" parameters:@{@"objTitle":[NSString stringWithFormat:@"%%%@%%",title]}];
+    return [self MB_count:[self MB_criteriaForColumn:@"objTitle" containing:title] parameters:@{@"objTitle":[self MB_parameterForColumn:@"objTitle" containing:title]}];
 }
 
 + (NSNumber *)MB_countWithForeignKey:(NSString *)foreignKey
@@ -447,7 +755,7 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
 
 + (NSNumber *)MB_countLikeForeignKey:(NSString *)foreignKey
 {
-    return [self MB_count:@"objForeignKey like :objForeignKey" parameters:@{@"objForeignKey":[NSString stringWithFormat:@"%%%@%%",foreignKey]}];
+    return [self MB_count:[self MB_criteriaForColumn:@"objForeignKey" containing:foreignKey] parameters:@{@"objForeignKey":[self MB_parameterForColumn:@"objForeignKey" containing:foreignKey]}];
 }
 
 + (NSNumber *)MB_countOrderedFrom:(NSNumber *)fromOrderNumber to:(NSNumber *)toOrderNumber
@@ -465,18 +773,91 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     return [self MB_count:@"updateTime >= :fromDate and updateTime <= :toDate" parameters:@{@"fromDate":fromDate,@"toDate":toDate}];
 }
 
+#pragma mark - Aggregate Methods
+
++ (id)MB_aggregate:(DHMambaObjectAggregate)aggregate ofColumn:(NSString *)column criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters
+{
+    NSString *expression = [self MB_expressionForAggregate:aggregate ofColumn:column];
+    if ( !expression ) {
+        return nil;
+    }
+    
+    __block id result = nil;
+    [DHMambaStore selectWithSQL:[self MB_sqlSelecting:expression criteria:criteria groupedBy:nil] parameters:parameters resultBlock:^(FMResultSet *results) {
+        result = [self MB_valueOfAggregate:aggregate ofColumn:column value:[results objectForColumnIndex:0]];
+    }];
+    return result == [NSNull null] ? nil : result;
+}
+
++ (NSDictionary *)MB_aggregate:(DHMambaObjectAggregate)aggregate ofColumn:(NSString *)column groupedBy:(NSString *)groupColumn criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters
+{
+    NSString *expression = [self MB_expressionForAggregate:aggregate ofColumn:column];
+    if ( !expression || ![self MB_checkColumn:groupColumn] ) {
+        return nil;
+    }
+    
+    NSMutableDictionary *groups = [[NSMutableDictionary alloc] init];
+    NSString *querySql = [self MB_sqlSelecting:[NSString stringWithFormat:@"\"%@\", %@",groupColumn,expression] criteria:criteria groupedBy:groupColumn];
+    [DHMambaStore selectWithSQL:querySql parameters:parameters resultBlock:^(FMResultSet *results) {
+        
+        id group = [self MB_valueOfAggregate:DHMambaObjectAggregateMinimum ofColumn:groupColumn value:[results objectForColumnIndex:0]];
+        groups[group] = [self MB_valueOfAggregate:aggregate ofColumn:column value:[results objectForColumnIndex:1]];
+    }];
+    return groups;
+}
+
++ (NSDictionary *)MB_countGroupedBy:(NSString *)column
+{
+    return [self MB_aggregate:DHMambaObjectAggregateCount ofColumn:nil groupedBy:column criteria:@[] parameters:@{}];
+}
+
++ (NSArray *)MB_distinct:(NSString *)column criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters
+{
+    if ( ![self MB_checkColumn:column] ) {
+        return nil;
+    }
+    
+    NSMutableArray *values = [[NSMutableArray alloc] init];
+    NSString *querySql = [self MB_sqlSelecting:[NSString stringWithFormat:@"distinct \"%@\"",column] criteria:criteria groupedBy:nil];
+    querySql = [querySql stringByAppendingFormat:@" order by \"%@\"",column];
+    [DHMambaStore selectWithSQL:querySql parameters:parameters resultBlock:^(FMResultSet *results) {
+        [values addObject:[self MB_valueOfAggregate:DHMambaObjectAggregateMinimum ofColumn:column value:[results objectForColumnIndex:0]]];
+    }];
+    return values;
+}
+
 #pragma mark - Private methods
 
 - (id)MB_unarchive_withResults:(FMResultSet *)results {
     
+    CFAbsoluteTime start = [DHMambaMetrics start];
     id resultObject;
     BOOL decoded = NO;
     
+    // Compressed and uncompressed bodies can be mixed in a collection
+    NSData *body = [results dataForColumn:@"objBody"];
+    BOOL readable = YES;
+    if ( [DHMambaCompressor isCompressedData:body] ) {
+        body = [DHMambaCompressor decompressData:body dictionary:[DHMambaCollection collectionForClass:[self class]].compressionDictionary];
+        readable = body != nil;
+    }
+    
+    // A row whose body can't be read is skipped rather than loaded empty,
+    // since saving an empty object would overwrite the stored body.
+    if ( !readable ) {
+        NSLog(@"error loading %@ %@, its body could not be decompressed",NSStringFromClass([self class]),[results stringForColumn:@"objID"]);
+        return nil;
+    }
+    
     // If the object can decode itself, then go ahead and
     // let it!
     if ( [[self class] conformsToProtocol:@protocol(NSCoding)] ) {
-        resultObject = [NSKeyedUnarchiver unarchiveObjectWithData:[results objectForColumnName:@"objBody"]];
+        resultObject = [NSKeyedUnarchiver unarchiveObjectWithData:body];
         decoded = YES;
+        if ( !resultObject ) {
+            NSLog(@"error loading %@ %@, its body could not be unarchived",NSStringFromClass([self class]),[results stringForColumn:@"objID"]);
+            return nil;
+        }
     }
     else {
         resultObject = [[[self class] alloc] init];
@@ -489,91 +870,228 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     NSDate *updateDate = [NSDate dateWithTimeIntervalSince1970:[[results objectForColumnName:@"updateTime"] doubleValue]];
     objc_setAssociatedObject(resultObject, DHMambaObjectUpdateTimeKey, updateDate, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
     
-    // if object can't decode itself, we need to do it
+    // Classes that track changes remember what was loaded
+    DHMambaCollection *trackingCollection = nil;
+    NSMutableData *digests = nil;
+    if ( [[self class] respondsToSelector:@selector(mambaObjectTracksChanges)] ) {
+        trackingCollection = [DHMambaCollection collectionForClass:[self class]];
+        if ( trackingCollection.tracksChanges && !decoded ) {
+            digests = [[NSMutableData alloc] init];
+        }
+    }
+    
+    // if object can't decode itself, we need to do it. Rows saved by older
+    // versions of the store are keyed archives.
     if ( !decoded ) {
-        NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:[results objectForColumnName:@"objBody"]];
-        NSArray *properties = [self MB_class_propertyNames];
-        for ( NSString *property in properties ) {
-            [resultObject setValue:[unarchiver decodeObjectForKey:property] forKey:property];
+        if ( [DHMambaCoder canDecodeData:body] ) {
+            [DHMambaCoder decodeData:body intoObject:resultObject fieldDigests:digests];
+        }
+        else {
+            NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:body];
+            for ( NSString *property in [self MB_class_propertyNames] ) {
+                [resultObject setValue:[unarchiver decodeObjectForKey:property] forKey:property];
+            }
+            [unarchiver finishDecoding];
+            digests = nil;
         }
-        [unarchiver finishDecoding];
+    }
+    [trackingCollection rememberLoadedObject:resultObject results:results body:body fieldDigests:digests];
+    
+    if ( start != 0 ) {
+        [DHMambaMetrics record:DHMambaMetricDecode collection:[DHMambaCollection collectionNameForClass:[self class]] since:start];
     }
     return resultObject;
 }
 
 + (void)MB_performAfterLoad:(id)loadedObject
 {
-    // Give object a chance to do anything special after load
-    if ( [loadedObject respondsToSelector:@selector(mambaAfterLoad)]) {
-        [loadedObject performSelector:@selector(mambaAfterLoad)];
+    if ( loadedObject ) {
+        [self MB_performAfterLoadOnArray:@[loadedObject] including:nil];
     }
 }
 
 + (void)MB_performAfterLoadOnArray:(NSArray *)loadedObjects
 {
+    [self MB_performAfterLoadOnArray:loadedObjects including:nil];
+}
+
++ (void)MB_performAfterLoadOnArray:(NSArray *)loadedObjects including:(NSArray *)relationships
+{
+    // Children are loaded first so mambaAfterLoad can use them
+    for ( DHMambaRelationship *relationship in [DHMambaCollection collectionForClass:[self class]].relationships ) {
+        if ( !relationships || [relationships containsObject:relationship.name] ) {
+            [self MB_loadRelationship:relationship ofObjects:loadedObjects];
+        }
+    }
+    
+    // Give objects a chance to do anything special after load
     for ( id loadedObject in loadedObjects ) {
-        [self MB_performAfterLoad:loadedObject];
+        if ( [loadedObject respondsToSelector:@selector(mambaAfterLoad)]) {
+            [loadedObject performSelector:@selector(mambaAfterLoad)];
+        }
     }
 }
 
-//
-// This method ripped uncerimoniously from a blog post here:
-// http://iosdevelopertips.com/cocoa/nscoding-without-boilerplate.html?utm_source=iOSDevTips&utm_campaign=wordtwit&utm_medium=twitter
-//
-- (NSArray *)MB_class_propertyNames
++ (void)MB_loadRelationship:(DHMambaRelationship *)relationship ofObjects:(NSArray *)parents
 {
-    // Check for a cached value (we use _cmd as the cache key,
-    // which represents @selector(propertyNames))
-    NSMutableArray *array = objc_getAssociatedObject([self class], _cmd);
-    if (array)
-    {
-        return array;
-    }
-    
-    // Loop through our superclasses until we hit NSObject
-    array = [NSMutableArray array];
-    Class subclass = [self class];
-    while (subclass != [NSObject class])
-    {
-        unsigned int propertyCount;
-        objc_property_t *properties = class_copyPropertyList(subclass,
-                                                             &propertyCount);
-        for (int i = 0; i < propertyCount; i++)
-        {
-            // Get property name
-            objc_property_t property = properties[i];
-            const char *propertyName = property_getName(property);
-            NSString *key = @(propertyName);
+    Class childClass = relationship.childClass;
+    DHMambaCollection *childCollection = [DHMambaCollection collectionForClass:childClass];
+    if ( ![relationship.foreignKey isEqualToString:@"objForeignKey"] && ![childCollection.indexedProperties containsObject:relationship.foreignKey] ) {
+        NSLog(@"Can't load %@ for %@, %@ isn't an indexed property of %@",relationship.name,NSStringFromClass([self class]),relationship.foreignKey,NSStringFromClass(childClass));
+        return;
+    }
+    if ( parents.count == 0 ) {
+        return;
+    }
+    [DHMambaStore createCollectionIfDoesntExist:childClass];
+    
+    // parent key -> parents with that key
+    NSMutableDictionary *parentsByKey = [[NSMutableDictionary alloc] init];
+    for ( id parent in parents ) {
+        NSString *key = [parent MB_objKey];
+        if ( !key ) {
+            continue;
+        }
+        if ( !parentsByKey[key] ) {
+            parentsByKey[key] = [[NSMutableArray alloc] init];
+        }
+        [parentsByKey[key] addObject:parent];
+    }
+    
+    // One query for every chunk of parents instead of one per parent
+    NSArray *keys = [parentsByKey allKeys];
+    NSMutableArray *children = [[NSMutableArray alloc] init];
+    NSMutableDictionary *childrenByKey = [[NSMutableDictionary alloc] init];
+    for ( NSUInteger location = 0; location < keys.count; location += kDHMambaObjectRelationshipChunkSize ) {
+        
+        NSArray *chunk = [keys subarrayWithRange:NSMakeRange(location, MIN(kDHMambaObjectRelationshipChunkSize, keys.count - location))];
+        NSString *placeholders = [@"" stringByPaddingToLength:chunk.count * 2 - 1 withString:@"?," startingAtIndex:0];
+        NSString *querySql = [NSString stringWithFormat:@"select * from %@ where \"%@\" in (%@) order by orderNumber, objID",childCollection.name,relationship.foreignKey,placeholders];
+        [DHMambaStore selectWithSQL:querySql arguments:chunk resultBlock:^(FMResultSet *results) {
             
-            // Check if there is a backing ivar
-            char *ivar = property_copyAttributeValue(property, "V");
-            if (ivar)
-            {
-                // Check if ivar has KVC-compliant name
-                NSString *ivarName = @(ivar);
-                if ([ivarName isEqualToString:key] ||
-                    [ivarName isEqualToString:[@"_" stringByAppendingString:key]])
-                {
-                    // setValue:forKey: will work
-                    [array addObject:key];
+            id child = [childClass MB_unarchive_withResults:results];
+            if ( !child ) {
+                return;
+            }
+            NSString *key = [NSString stringWithFormat:@"%@",[results objectForColumnName:relationship.foreignKey]];
+            if ( !childrenByKey[key] ) {
+                childrenByKey[key] = [[NSMutableArray alloc] init];
+            }
+            [childrenByKey[key] addObject:child];
+            [children addObject:child];
+        }];
+    }
+    
+    // Grandchildren are loaded the same way, for all the children at once
+    [childClass MB_performAfterLoadOnArray:children];
+    
+    for ( NSString *key in parentsByKey ) {
+        for ( id parent in parentsByKey[key] ) {
+            [relationship setChildren:childrenByKey[key] ? childrenByKey[key] : @[] ofParent:parent];
+        }
+    }
+}
+
++ (BOOL)MB_objectsHaveRelationships:(NSArray *)objects
+{
+    Class lastClass = nil;
+    for ( id object in objects ) {
+        if ( [object class] != lastClass ) {
+            lastClass = [object class];
+            if ( [DHMambaCollection collectionForClass:lastClass].relationships.count > 0 ) {
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
++ (NSArray *)MB_objectGraph:(NSArray *)objects inserts:(NSMutableSet *)inserts
+{
+    // Parents come before their children. When saving, new objects are
+    // recorded before any keys are handed out, since a key can be the objID
+    // and creating one makes the object look like it has been stored.
+    NSMutableArray *graph = [[NSMutableArray alloc] init];
+    NSHashTable *visited = [[NSHashTable alloc] initWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality capacity:objects.count];
+    for ( id object in objects ) {
+        if ( ![visited containsObject:object] ) {
+            [visited addObject:object];
+            [graph addObject:object];
+        }
+    }
+    
+    for ( NSUInteger index = 0; index < graph.count; index++ ) {
+        
+        id object = graph[index];
+        if ( inserts && ![object MB_has_objID] ) {
+            [inserts addObject:[object MB_objID]];
+        }
+        
+        for ( DHMambaRelationship *relationship in [DHMambaCollection collectionForClass:[object class]].relationships ) {
+            for ( id child in [relationship childrenOfParent:object] ) {
+                if ( inserts ) {
+                    [relationship setParent:object ofChild:child];
+                }
+                if ( ![visited containsObject:child] ) {
+                    [visited addObject:child];
+                    [graph addObject:child];
                 }
-                free(ivar);
             }
         }
-        free(properties);
-        subclass = [subclass superclass];
+    }
+    return graph;
+}
+
++ (void)MB_saveObjectGraph:(NSArray *)objects
+{
+    NSMutableSet *inserts = [[NSMutableSet alloc] init];
+    NSArray *graph = [self MB_objectGraph:objects inserts:inserts];
+    if ( [DHMambaStore saveObjects:graph inserts:inserts] ) {
+        return;
     }
     
-    // Cache and return array
-    objc_setAssociatedObject([self class], _cmd, array, 
-                             OBJC_ASSOCIATION_RETAIN_NONATOMIC);
-    return array;
+    for ( id object in graph ) {
+        if ( [object respondsToSelector:@selector(mambaAfterSave)] ) {
+            [object performSelector:@selector(mambaAfterSave)];
+        }
+    }
+}
+
++ (void)MB_deleteObjectGraph:(NSArray *)objects
+{
+    NSArray *graph = [self MB_objectGraph:objects inserts:nil];
+    [DHMambaStore deleteObjects:graph];
+    
+    for ( id object in graph ) {
+        if ( [object respondsToSelector:@selector(mambaAfterDelete)] ) {
+            [object performSelector:@selector(mambaAfterDelete)];
+        }
+    }
+}
+
+//
+// This method ripped uncerimoniously from a blog post here:
+// http://iosdevelopertips.com/cocoa/nscoding-without-boilerplate.html?utm_source=iOSDevTips&utm_campaign=wordtwit&utm_medium=twitter
+//
+- (NSArray *)MB_class_propertyNames
+{
+    // The access plan finds the properties with backing iVars and caches
+    // them per class
+    return [DHMambaAccessPlan planForClass:[self class]].propertyNames;
 }
 
 + (NSArray *)MB_search:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy {
     
+    return [self MB_search:criteria parameters:parameters limit:limit orderBy:orderBy including:nil];
+}
+
++ (NSArray *)MB_search:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy including:(NSArray *)relationships {
+    
     NSString *collection = [NSStringFromClass([self class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
     
+    // Criteria can use the indexed property columns, so make sure they exist
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    
     // setup the where clause
     NSString *where = @"";
     for ( NSString *whereCriteria in criteria ) {
@@ -587,15 +1105,149 @@ static char const * const DHMambaObjectUpdateTimeKey = "MambaObjectUpdateTime";
     [DHMambaStore selectFromCollection:collection where:where parameters:parameters order:orderBy limit:limit resultBlock:^(FMResultSet *results) {
 
         id resultObject = [self MB_unarchive_withResults:results];
-        [resultArray addObject:resultObject];
+        if ( resultObject ) {
+            [resultArray addObject:resultObject];
+        }
+    }];
+    [self MB_performAfterLoadOnArray:resultArray including:relationships];
+    return resultArray;
+}
+
++ (NSArray *)MB_search:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy after:(NSString *)token nextToken:(NSString **)nextToken {
+    
+    NSString *collection = [NSStringFromClass([self class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    
+    NSMutableArray *resultArray = [[NSMutableArray alloc] init];
+    NSString *next = [DHMambaStore selectPageFromCollection:collection where:[criteria componentsJoinedByString:@" and "] parameters:parameters order:orderBy limit:limit after:token resultBlock:^(FMResultSet *results) {
+        
+        id resultObject = [self MB_unarchive_withResults:results];
+        if ( resultObject ) {
+            [resultArray addObject:resultObject];
+        }
     }];
+    if ( nextToken ) {
+        *nextToken = next;
+    }
     [self MB_performAfterLoadOnArray:resultArray];
     return resultArray;
 }
 
++ (NSString *)MB_criteriaForColumn:(NSString *)column containing:(NSString *)value {
+    
+    // Use the full text index when we can, since a like with a leading
+    // wildcard has to scan every row.
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[self class]];
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    if ( [collection canSearchFullText:column term:value] ) {
+        return [NSString stringWithFormat:@"objTextID in (select rowid from %@ where %@ match :%@)",collection.fullTextName,collection.fullTextName,column];
+    }
+    else {
+        return [NSString stringWithFormat:@"%@ like :%@",column,column];
+    }
+}
+
++ (NSString *)MB_parameterForColumn:(NSString *)column containing:(NSString *)value {
+    
+    DHMambaCollection *collection = [DHMambaCollection collectionForClass:[self class]];
+    if ( [collection canSearchFullText:column term:value] ) {
+        return [collection fullTextQueryForColumn:column term:value];
+    }
+    else {
+        return [NSString stringWithFormat:@"%%%@%%",value];
+    }
+}
+
++ (void)MB_selectColumns:(NSString *)columns criteria:(NSArray *)criteria parameters:(NSDictionary *)parameters limit:(NSUInteger)limit orderBy:(DHMambaObjectOrderBy)orderBy resultBlock:(void (^)(FMResultSet *results))resultBlock {
+    
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    NSString *collection = [DHMambaCollection collectionNameForClass:[self class]];
+    [DHMambaStore selectColumns:columns fromCollection:collection where:[criteria componentsJoinedByString:@" and "] parameters:parameters order:orderBy limit:limit resultBlock:resultBlock];
+}
+
++ (NSDictionary *)MB_valuesOfColumns:(NSArray *)columns withResults:(FMResultSet *)results {
+    
+    NSMutableDictionary *values = [[NSMutableDictionary alloc] initWithCapacity:columns.count];
+    for ( NSUInteger index = 0; index < columns.count; index++ ) {
+        id value = [self MB_storedValue:[results objectForColumnIndex:(int)index] ofColumn:columns[index]];
+        if ( value != [NSNull null] ) {
+            values[columns[index]] = value;
+        }
+    }
+    return values;
+}
+
++ (id)MB_storedValue:(id)value ofColumn:(NSString *)column {
+    
+    // Dates are stored as seconds since 1970
+    if ( [value isKindOfClass:[NSNumber class]] && [[DHMambaCollection collectionForClass:[self class]].dateColumns containsObject:column] ) {
+        return [NSDate dateWithTimeIntervalSince1970:[value doubleValue]];
+    }
+    return value ? value : [NSNull null];
+}
+
++ (NSString *)MB_sqlForQuery:(DHMambaQuery *)query selecting:(NSString *)columns arguments:(NSArray **)arguments {
+    
+    if ( query.objectClass != [self class] ) {
+        NSLog(@"Error: query is for %@, not %@",NSStringFromClass(query.objectClass),NSStringFromClass([self class]));
+        return nil;
+    }
+    
+    // Conditions can use the indexed property columns, so make sure they exist
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    return [query sqlSelecting:columns arguments:arguments];
+}
+
++ (BOOL)MB_checkColumn:(NSString *)column {
+    
+    // Column names go into the SQL, so only allow real columns
+    if ( ![[DHMambaCollection collectionForClass:[self class]] hasColumn:column] ) {
+        NSLog(@"Error: %@ isn't a built in column or indexed property of %@",column,NSStringFromClass([self class]));
+        return NO;
+    }
+    return YES;
+}
+
++ (NSString *)MB_expressionForAggregate:(DHMambaObjectAggregate)aggregate ofColumn:(NSString *)column {
+    
+    if ( aggregate == DHMambaObjectAggregateCount && !column ) {
+        return @"count(*)";
+    }
+    if ( ![self MB_checkColumn:column] ) {
+        return nil;
+    }
+    
+    NSArray *functions = @[@"count",@"sum",@"min",@"max",@"avg"];
+    return [NSString stringWithFormat:@"%@(\"%@\")",functions[aggregate],column];
+}
+
++ (NSString *)MB_sqlSelecting:(NSString *)expression criteria:(NSArray *)criteria groupedBy:(NSString *)groupColumn {
+    
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
+    NSString *querySql = [NSString stringWithFormat:@"select %@ from %@",expression,[DHMambaCollection collectionNameForClass:[self class]]];
+    if ( criteria.count > 0 ) {
+        querySql = [querySql stringByAppendingFormat:@" where %@",[criteria componentsJoinedByString:@" and "]];
+    }
+    if ( groupColumn ) {
+        querySql = [querySql stringByAppendingFormat:@" group by \"%@\"",groupColumn];
+    }
+    return querySql;
+}
+
++ (id)MB_valueOfAggregate:(DHMambaObjectAggregate)aggregate ofColumn:(NSString *)column value:(id)value {
+    
+    // Min, max and average of a date are still a date
+    BOOL keepsType = aggregate == DHMambaObjectAggregateMinimum || aggregate == DHMambaObjectAggregateMaximum || aggregate == DHMambaObjectAggregateAverage;
+    if ( keepsType ) {
+        return [self MB_storedValue:value ofColumn:column];
+    }
+    return value ? value : [NSNull null];
+}
+
 + (NSNumber *)MB_count:(NSString *)criteria parameters:(NSDictionary *)parameters {
     
     NSString *collection = [NSStringFromClass([self class]) stringByReplacingOccurrencesOfString:@"." withString:@"_"];
+    [DHMambaStore createCollectionIfDoesntExist:[self class]];
     return [DHMambaStore countFromCollection:collection where:criteria parameters:parameters];
 }
 
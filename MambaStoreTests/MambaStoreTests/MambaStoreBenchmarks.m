@@ -0,0 +1,372 @@
+//
+//  MambaStoreBenchmarks.m
+//  MambaStoreTests
+//
+//  Created by David House on 10/17/26.
+//
+//
+
+#import <XCTest/XCTest.h>
+#import <sys/resource.h>
+#import "DHMambaStore.h"
+#import "NSObject+DHMambaObject.h"
+#import "State.h"
+#import "ParentObject.h"
+#import "ChildObject.h"
+#import "SelfCodedObject.h"
+#import "DHMambaCoder.h"
+
+//
+// Benchmarks for the store. By default they run at 1,000 rows on 1 and 2
+// threads, which is quick enough to run with the tests. Set these in the
+// scheme's environment to run the full suite:
+//
+//   MAMBA_BENCHMARK_ROWS     row counts, such as 1000,100000,1000000
+//   MAMBA_BENCHMARK_THREADS  reader thread counts, such as 1,2,4,8
+//   MAMBA_BENCHMARK_OUTPUT   where to write the results
+//
+// Results are written as JSON, one record per model, operation, row count
+// and thread count, to the output path or to MambaStoreBenchmarks.json in the
+// temporary directory. Compression is compared on States with and without
+// each codec, recording the size of the store file and the CPU time used.
+// Lookups use a fixed sequence of rows, so runs on the
+// same machine can be compared. Inserts and updates always run on one thread,
+// since the store has a single writer.
+//
+
+// Lookups timed per measurement
+static NSUInteger const kBenchmarkLookups = 1000;
+
+// Searches and counts timed per measurement, since these can read every row
+static NSUInteger const kBenchmarkScans = 20;
+
+static NSString * const kBenchmarkStoreName = @"benchmark.db";
+
+static NSMutableArray *staticBenchmarkResults;
+
+static State *BenchmarkState(Class stateClass, NSUInteger index)
+{
+    State *state = [[stateClass alloc] init];
+    state.name = [NSString stringWithFormat:@"STATE %lu",(unsigned long)index];
+    state.abbreviation = [NSString stringWithFormat:@"S%lu",(unsigned long)index];
+    state.population = [NSString stringWithFormat:@"%lu",(unsigned long)(index * 7919 % 40000000)];
+    state.squareMiles = [NSString stringWithFormat:@"%lu",(unsigned long)(index % 700000)];
+    state.capital = [NSString stringWithFormat:@"CAPITAL %lu",(unsigned long)(index % 1000)];
+    state.mostPopulousCity = [NSString stringWithFormat:@"CITY %lu",(unsigned long)(index % 5000)];
+    return state;
+}
+
+@interface LZ4State : State
+
+@end
+
+@implementation LZ4State
+
++ (DHMambaCompression)mambaObjectCompression {
+    return DHMambaCompressionLZ4;
+}
+
+@end
+
+@interface ZlibState : State
+
+@end
+
+@implementation ZlibState
+
++ (DHMambaCompression)mambaObjectCompression {
+    return DHMambaCompressionZlib;
+}
+
++ (NSData *)mambaObjectCompressionDictionary {
+    return [DHMambaCoder encodeObject:BenchmarkState([State class], 0) ignoring:nil];
+}
+
+@end
+
+@interface MambaStoreBenchmarks : XCTestCase
+
+@end
+
+@implementation MambaStoreBenchmarks
+
++ (void)setUp
+{
+    [super setUp];
+    staticBenchmarkResults = [[NSMutableArray alloc] init];
+}
+
++ (void)tearDown
+{
+    NSProcessInfo *processInfo = [NSProcessInfo processInfo];
+    NSDictionary *report = @{@"date":[NSNumber numberWithDouble:[[NSDate date] timeIntervalSince1970]],
+                             @"os":processInfo.operatingSystemVersionString,
+                             @"processors":[NSNumber numberWithUnsignedInteger:processInfo.activeProcessorCount],
+                             @"results":staticBenchmarkResults};
+    
+    NSString *outputPath = processInfo.environment[@"MAMBA_BENCHMARK_OUTPUT"];
+    if ( !outputPath ) {
+        outputPath = [NSTemporaryDirectory() stringByAppendingPathComponent:@"MambaStoreBenchmarks.json"];
+    }
+    
+    NSError *error = nil;
+    NSData *json = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+    if ( ![json writeToFile:outputPath options:NSDataWritingAtomic error:&error] ) {
+        NSLog(@"error writing benchmark results: %@",[error localizedDescription]);
+    }
+    else {
+        NSLog(@"benchmark results written to %@",outputPath);
+    }
+    [super tearDown];
+}
+
+- (void)tearDown
+{
+    [DHMambaStore removeStore:kBenchmarkStoreName];
+    [super tearDown];
+}
+
+#pragma mark - Benchmarks
+
+- (void)testStateBenchmarks
+{
+    [self benchmarkClass:[State class] newObject:^id(NSUInteger index) {
+        return BenchmarkState([State class], index);
+    } changeObject:^(id object) {
+        State *state = object;
+        state.capital = [state.capital stringByAppendingString:@" NEW"];
+    } keyOfIndex:^NSString *(NSUInteger index) {
+        return [NSString stringWithFormat:@"S%lu",(unsigned long)index];
+    }];
+}
+
+- (void)testParentChildBenchmarks
+{
+    [self benchmarkClass:[ParentObject class] newObject:^id(NSUInteger index) {
+        ParentObject *parent = [[ParentObject alloc] init];
+        parent.parentName = [NSString stringWithFormat:@"PARENT %lu",(unsigned long)index];
+        for ( NSUInteger child = 0; child < 2; child++ ) {
+            ChildObject *childObject = [[ChildObject alloc] init];
+            childObject.childName = [NSString stringWithFormat:@"CHILD %lu-%lu",(unsigned long)index,(unsigned long)child];
+            [parent.children addObject:childObject];
+        }
+        return parent;
+    } changeObject:^(id object) {
+        ParentObject *parent = object;
+        parent.parentName = [parent.parentName stringByAppendingString:@" NEW"];
+    } keyOfIndex:nil];
+}
+
+- (void)testSelfCodedBenchmarks
+{
+    [self benchmarkClass:[SelfCodedObject class] newObject:^id(NSUInteger index) {
+        SelfCodedObject *object = [[SelfCodedObject alloc] init];
+        object.title = [NSString stringWithFormat:@"OBJECT %lu",(unsigned long)index];
+        object.frame = CGRectMake(index % 320, index % 480, 100, 44);
+        return object;
+    } changeObject:^(id object) {
+        SelfCodedObject *selfCoded = object;
+        selfCoded.frame = CGRectOffset(selfCoded.frame, 1, 1);
+    } keyOfIndex:nil];
+}
+
+- (void)testCompressionBenchmarks
+{
+    for ( Class stateClass in @[[State class],[LZ4State class],[ZlibState class]] ) {
+        [self benchmarkCompressionOfClass:stateClass];
+    }
+}
+
+#pragma mark - Private Methods
+
+- (void)benchmarkClass:(Class)objectClass newObject:(id (^)(NSUInteger index))newObject changeObject:(void (^)(id object))changeObject keyOfIndex:(NSString *(^)(NSUInteger index))keyOfIndex
+{
+    NSString *model = NSStringFromClass(objectClass);
+    NSArray *threadCounts = [self settingNamed:@"MAMBA_BENCHMARK_THREADS" defaults:@[@1,@2]];
+    NSUInteger maximumThreads = [[threadCounts valueForKeyPath:@"@max.unsignedIntegerValue"] unsignedIntegerValue];
+    
+    for ( NSNumber *rowCount in [self settingNamed:@"MAMBA_BENCHMARK_ROWS" defaults:@[@1000]] ) {
+        
+        NSUInteger rows = [rowCount unsignedIntegerValue];
+        [DHMambaStore removeStore:kBenchmarkStoreName];
+        [DHMambaStore openStore:kBenchmarkStoreName maximumReaders:maximumThreads];
+        
+        NSMutableArray *objects = [[NSMutableArray alloc] initWithCapacity:rows];
+        for ( NSUInteger index = 0; index < rows; index++ ) {
+            @autoreleasepool {
+                [objects addObject:newObject(index)];
+            }
+        }
+        
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [objectClass MB_saveAll:objects];
+        [self recordModel:model operation:@"insert" rows:rows threads:1 operations:rows seconds:CFAbsoluteTimeGetCurrent() - start];
+        XCTAssertTrue([[objectClass MB_countAll] unsignedIntegerValue] == rows, @"Should have inserted %lu %@ objects",(unsigned long)rows,model);
+        
+        for ( id object in objects ) {
+            changeObject(object);
+        }
+        start = CFAbsoluteTimeGetCurrent();
+        [objectClass MB_saveAll:objects];
+        [self recordModel:model operation:@"update" rows:rows threads:1 operations:rows seconds:CFAbsoluteTimeGetCurrent() - start];
+        
+        NSArray *objIDs = [objects valueForKey:@"MB_objID"];
+        objects = nil;
+        
+        for ( NSNumber *threadCount in threadCounts ) {
+            
+            NSUInteger threads = [threadCount unsignedIntegerValue];
+            [objectClass MB_clearCache];
+            [self measureModel:model operation:@"loadByID" rows:rows threads:threads operations:kBenchmarkLookups block:^BOOL(NSUInteger index) {
+                return [objectClass MB_loadWithID:objIDs[index]] != nil;
+            }];
+            
+            if ( keyOfIndex ) {
+                [objectClass MB_clearCache];
+                [self measureModel:model operation:@"findByKey" rows:rows threads:threads operations:kBenchmarkLookups block:^BOOL(NSUInteger index) {
+                    return [objectClass MB_findWithKey:keyOfIndex(index)] != nil;
+                }];
+            }
+            
+            // a leading wildcard can't use an index
+            [self measureModel:model operation:@"likeSearch" rows:rows threads:threads operations:kBenchmarkScans block:^BOOL(NSUInteger index) {
+                NSString *pattern = [NSString stringWithFormat:@"%%%lu%%",(unsigned long)index];
+                return [objectClass MB_search:@[@"objTitle like :pattern"] parameters:@{@"pattern":pattern} limit:10 orderBy:DHMambaObjectOrderByKey] != nil;
+            }];
+            
+            [self measureModel:model operation:@"count" rows:rows threads:threads operations:kBenchmarkScans block:^BOOL(NSUInteger index) {
+                return [[objectClass MB_countAll] unsignedIntegerValue] == rows;
+            }];
+        }
+        
+        start = CFAbsoluteTimeGetCurrent();
+        NSUInteger found = [[objectClass MB_findAll] count];
+        [self recordModel:model operation:@"findAll" rows:rows threads:1 operations:1 seconds:CFAbsoluteTimeGetCurrent() - start];
+        XCTAssertTrue(found == rows, @"Should have found all %lu %@ objects, but found %lu",(unsigned long)rows,model,(unsigned long)found);
+        
+        [DHMambaStore closeStore];
+    }
+}
+
+- (void)benchmarkCompressionOfClass:(Class)stateClass
+{
+    NSString *model = NSStringFromClass(stateClass);
+    NSString *documentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
+    NSString *storePath = [documentsDirectory stringByAppendingPathComponent:kBenchmarkStoreName];
+    
+    for ( NSNumber *rowCount in [self settingNamed:@"MAMBA_BENCHMARK_ROWS" defaults:@[@1000]] ) {
+        
+        NSUInteger rows = [rowCount unsignedIntegerValue];
+        [DHMambaStore removeStore:kBenchmarkStoreName];
+        [DHMambaStore openStore:kBenchmarkStoreName];
+        
+        NSMutableArray *objects = [[NSMutableArray alloc] initWithCapacity:rows];
+        for ( NSUInteger index = 0; index < rows; index++ ) {
+            @autoreleasepool {
+                [objects addObject:BenchmarkState(stateClass, index)];
+            }
+        }
+        
+        NSTimeInterval cpuStart = [self cpuSeconds];
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        [stateClass MB_saveAll:objects];
+        [self recordModel:model operation:@"compressedInsert" rows:rows threads:1 operations:rows seconds:CFAbsoluteTimeGetCurrent() - start
+                    extra:@{@"cpuSeconds":[NSNumber numberWithDouble:[self cpuSeconds] - cpuStart]}];
+        objects = nil;
+        [DHMambaStore closeStore];
+        
+        NSNumber *fileBytes = [self sizeOfStoreAtPath:storePath];
+        
+        // A store that was just opened has nothing in SQLite's page cache
+        [DHMambaStore openStore:kBenchmarkStoreName];
+        cpuStart = [self cpuSeconds];
+        start = CFAbsoluteTimeGetCurrent();
+        NSUInteger found = [[stateClass MB_findAll] count];
+        [self recordModel:model operation:@"coldLoad" rows:rows threads:1 operations:rows seconds:CFAbsoluteTimeGetCurrent() - start
+                    extra:@{@"cpuSeconds":[NSNumber numberWithDouble:[self cpuSeconds] - cpuStart],@"fileBytes":fileBytes}];
+        XCTAssertTrue(found == rows, @"Should have loaded all %lu %@ objects, but loaded %lu",(unsigned long)rows,model,(unsigned long)found);
+        
+        [DHMambaStore closeStore];
+    }
+}
+
+- (void)measureModel:(NSString *)model operation:(NSString *)operation rows:(NSUInteger)rows threads:(NSUInteger)threads operations:(NSUInteger)operations block:(BOOL (^)(NSUInteger index))block
+{
+    // The same spread of rows every run
+    __block NSUInteger failures = 0;
+    NSUInteger perThread = operations / threads;
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    dispatch_apply(threads, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        for ( NSUInteger call = 0; call < perThread; call++ ) {
+            @autoreleasepool {
+                NSUInteger index = ((thread * perThread + call) * 7919) % rows;
+                if ( !block(index) ) {
+                    @synchronized(model) {
+                        failures++;
+                    }
+                }
+            }
+        }
+    });
+    CFAbsoluteTime elapsed = CFAbsoluteTimeGetCurrent() - start;
+    
+    XCTAssertTrue(failures == 0, @"%@ %@ failed %lu times",model,operation,(unsigned long)failures);
+    [self recordModel:model operation:operation rows:rows threads:threads operations:perThread * threads seconds:elapsed];
+}
+
+- (void)recordModel:(NSString *)model operation:(NSString *)operation rows:(NSUInteger)rows threads:(NSUInteger)threads operations:(NSUInteger)operations seconds:(NSTimeInterval)seconds
+{
+    [self recordModel:model operation:operation rows:rows threads:threads operations:operations seconds:seconds extra:nil];
+}
+
+- (void)recordModel:(NSString *)model operation:(NSString *)operation rows:(NSUInteger)rows threads:(NSUInteger)threads operations:(NSUInteger)operations seconds:(NSTimeInterval)seconds extra:(NSDictionary *)extra
+{
+    NSLog(@"%@ %@: %lu rows, %lu threads, %.0f operations/second %@",model,operation,(unsigned long)rows,(unsigned long)threads,operations / seconds,extra ? extra : @"");
+    NSMutableDictionary *result = [@{@"model":model,
+                                     @"operation":operation,
+                                     @"rows":[NSNumber numberWithUnsignedInteger:rows],
+                                     @"threads":[NSNumber numberWithUnsignedInteger:threads],
+                                     @"operations":[NSNumber numberWithUnsignedInteger:operations],
+                                     @"seconds":[NSNumber numberWithDouble:seconds],
+                                     @"operationsPerSecond":[NSNumber numberWithDouble:operations / seconds]} mutableCopy];
+    [result addEntriesFromDictionary:extra];
+    [staticBenchmarkResults addObject:result];
+}
+
+- (NSTimeInterval)cpuSeconds
+{
+    struct rusage usage;
+    if ( getrusage(RUSAGE_SELF, &usage) != 0 ) {
+        return 0;
+    }
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0;
+}
+
+- (NSNumber *)sizeOfStoreAtPath:(NSString *)storePath
+{
+    // Anything left in the write ahead log is part of the store too
+    unsigned long long bytes = 0;
+    for ( NSString *path in @[storePath,[storePath stringByAppendingString:@"-wal"]] ) {
+        bytes += [[[NSFileManager defaultManager] attributesOfItemAtPath:path error:nil] fileSize];
+    }
+    return [NSNumber numberWithUnsignedLongLong:bytes];
+}
+
+- (NSArray *)settingNamed:(NSString *)name defaults:(NSArray *)defaults
+{
+    NSString *setting = [NSProcessInfo processInfo].environment[name];
+    if ( setting.length == 0 ) {
+        return defaults;
+    }
+    
+    NSMutableArray *values = [[NSMutableArray alloc] init];
+    for ( NSString *value in [setting componentsSeparatedByString:@","] ) {
+        long long number = [value longLongValue];
+        if ( number > 0 ) {
+            [values addObject:[NSNumber numberWithLongLong:number]];
+        }
+    }
+    return values.count > 0 ? values : defaults;
+}
+
+@end
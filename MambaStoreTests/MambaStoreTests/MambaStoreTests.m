@@ -12,10 +12,91 @@
 #import "NSObject+DHMambaObject.h"
 #import "ParentObject.h"
 #import "ChildObject.h"
+#import "DHMambaLiveQuery.h"
+#import "DHMambaFault.h"
+#import "DHMambaQuery.h"
+#import "DHMambaQueryStats.h"
+#import "DHMambaMetrics.h"
 #import "SelfCodedObject.h"
+#import "ScalarObject.h"
+#import "FMDatabase.h"
+#import "FMDatabaseAdditions.h"
+#import "DHMambaCoder.h"
+#import "DHMambaCompressor.h"
+
+// States whose bodies are compressed with a dictionary
+@interface CompressedState : State
+
+@end
+
+@implementation CompressedState
+
++ (DHMambaCompression)mambaObjectCompression {
+    return DHMambaCompressionZlib;
+}
+
++ (NSData *)mambaObjectCompressionDictionary {
+    State *sample = [[State alloc] init];
+    sample.name = @"NORTH CAROLINA";
+    sample.abbreviation = @"NC";
+    sample.population = @"9380884";
+    sample.squareMiles = @"53819";
+    sample.capital = @"Raleigh";
+    sample.mostPopulousCity = @"Charlotte";
+    return [DHMambaCoder encodeObject:sample ignoring:nil];
+}
+
+@end
+
+// Scalar objects whose count setter has a limit
+@interface LimitedScalarObject : ScalarObject
+
+@end
+
+@implementation LimitedScalarObject
+
+- (void)setCount:(NSInteger)count {
+    [super setCount:MIN(count, 100)];
+}
+
+@end
+
+// Scalar objects that keep half their ratio and double it on the way out
+@interface HalvedScalarObject : ScalarObject
+
+@end
+
+@implementation HalvedScalarObject
+
+- (double)ratio {
+    return [super ratio] * 2;
+}
+
+- (void)setRatio:(double)ratio {
+    [super setRatio:ratio / 2];
+}
+
+@end
+
+// States that count how many times they have been saved
+@interface SavedState : State
+
+@property (nonatomic) NSUInteger savedCount;
+
+@end
+
+@implementation SavedState
+
+- (void)mambaAfterSave {
+    self.savedCount++;
+}
+
+@end
 
 @interface MambaStoreTests : XCTestCase
 
+@property (nonatomic,assign) NSUInteger observedChanges;
+
 @end
 
 @implementation MambaStoreTests
@@ -54,6 +135,23 @@
     XCTAssertTrue([[bState MB_objID] isEqualToString:sID], @"ObjectIDs don't match, whats up with that?");
 }
 
+- (void)testRepeatedLookups {
+    
+    // the lookups reuse cached statements, so make sure interleaving
+    // them with writes still returns the right objects
+    for ( State *state in [State MB_findAll] ) {
+        
+        State *byKey = [State MB_findWithKey:state.abbreviation];
+        XCTAssertTrue([byKey.name isEqualToString:state.name], @"Found %@ instead of %@",byKey.name,state.name);
+        
+        byKey.capital = [byKey.capital uppercaseString];
+        [byKey MB_save];
+        
+        State *byID = [State MB_loadWithID:[state MB_objID]];
+        XCTAssertTrue([byID.capital isEqualToString:[state.capital uppercaseString]], @"Capital for %@ was not updated",state.name);
+    }
+}
+
 - (void)testFindAll {
 
     NSArray *allStates = [State MB_findAll];
@@ -112,6 +210,66 @@
     XCTAssertTrue([found count] >= 1, @"Should have found 1 state, but found %ld instead",[found count]);
 }
 
+- (void)testFullTextSearch {
+    
+    NSArray *found = [State MB_findInTitle:@"CAROLINA"];
+    XCTAssertTrue([found count] == 2, @"Should have found 2 states, but found %ld instead",[found count]);
+    
+    found = [State MB_findInTitle:@"arolin"];
+    XCTAssertTrue([found count] == 2, @"Substring search should have found 2 states, but found %ld instead",[found count]);
+    
+    NSNumber *count = [State MB_countLikeTitle:@"DAKOTA"];
+    XCTAssertTrue([count intValue] == 2, @"Should have counted 2 states, but counted %@",count);
+    
+    // the index has to follow renames and deletes
+    State *georgia = [State MB_findWithKey:@"GA"];
+    georgia.name = @"PEACH STATE";
+    [georgia MB_save];
+    XCTAssertTrue([[State MB_findInTitle:@"GEORGIA"] count] == 0, @"Old title is still in the index");
+    XCTAssertTrue([[State MB_findInTitle:@"PEACH"] count] == 1, @"New title is not in the index");
+    [georgia MB_delete];
+    XCTAssertTrue([[State MB_findInTitle:@"PEACH"] count] == 0, @"Deleted state is still in the index");
+    
+    NSArray *ranked = [State MB_searchText:@"NEW" limit:2];
+    XCTAssertTrue([ranked count] == 2, @"Should have returned 2 ranked states, but returned %ld",[ranked count]);
+    
+    // VACUUM can renumber rows, which mustn't move the index to other objects
+    [[State MB_findWithKey:@"AL"] MB_delete];
+    [[State MB_findWithKey:@"AK"] MB_delete];
+    NSString *documentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
+    FMDatabase *db = [FMDatabase databaseWithPath:[documentsDirectory stringByAppendingPathComponent:@"mamba.db"]];
+    XCTAssertTrue([db open], @"Couldn't open the store directly");
+    XCTAssertTrue([db executeUpdate:@"vacuum"], @"Couldn't vacuum the store: %@",[db lastErrorMessage]);
+    [db close];
+    
+    NSArray *carolinas = [[State MB_findInTitle:@"CAROLINA"] valueForKey:@"abbreviation"];
+    XCTAssertTrue(carolinas.count == 2 && [carolinas containsObject:@"NC"] && [carolinas containsObject:@"SC"], @"Found the wrong states after a vacuum: %@",carolinas);
+    State *added = [[State alloc] init];
+    added.abbreviation = @"VV";
+    added.name = @"VACUUMED";
+    [added MB_save];
+    XCTAssertEqualObjects([[[State MB_findInTitle:@"VACUUM"] firstObject] abbreviation], @"VV", @"State added after a vacuum isn't in the index");
+    XCTAssertTrue([[State MB_countLikeTitle:@"CAROLINA"] intValue] == 2, @"Should still count 2 states after a vacuum");
+}
+
+- (void)testIndexedProperties {
+    
+    NSArray *found = [State MB_search:@[@"capital = :capital"] parameters:@{@"capital":@"Atlanta"} limit:0 orderBy:DHMambaObjectOrderByKey];
+    XCTAssertTrue([found count] == 1, @"Should have found 1 state, but found %ld instead",[found count]);
+    XCTAssertEqualObjects([[found firstObject] abbreviation], @"GA", @"Found the wrong state");
+    
+    // the column has to follow updates
+    State *georgia = [found firstObject];
+    georgia.capital = @"Savannah";
+    [georgia MB_save];
+    NSNumber *count = [State MB_count:@"capital = :capital" parameters:@{@"capital":@"Atlanta"}];
+    XCTAssertTrue([count intValue] == 0, @"Old capital is still in the column");
+    
+    // and can be compared with other columns
+    count = [State MB_count:@"capital = mostPopulousCity" parameters:@{}];
+    XCTAssertTrue([count intValue] > 0, @"Should have found states where the capital is the biggest city");
+}
+
 - (void)testDelete {
 
     
@@ -270,6 +428,48 @@
     XCTAssertTrue(remainingChildren.count == 0, @"ChildObjects didn't get deleted, there are %lu left",remainingChildren.count);
 }
 
+- (void)testRelationships
+{
+    __block NSUInteger childInserts = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:kDHMambaStoreNotification object:[ChildObject class] queue:nil usingBlock:^(NSNotification *note) {
+        if ( [note.userInfo[kDHMambaStoreNotificationOperationKey] isEqualToString:@"insert"] ) {
+            childInserts++;
+        }
+    }];
+    
+    NSMutableArray *parents = [[NSMutableArray alloc] init];
+    for ( int i = 0; i < 600; i++ ) {
+        ParentObject *parent = [[ParentObject alloc] init];
+        parent.parentName = [NSString stringWithFormat:@"parent %d",i];
+        for ( int j = 0; j < 3; j++ ) {
+            ChildObject *child = [[ChildObject alloc] init];
+            child.childName = [NSString stringWithFormat:@"%d-%d",i,j];
+            [parent.children addObject:child];
+        }
+        [parents addObject:parent];
+    }
+    [ParentObject MB_saveAll:parents];
+    XCTAssertTrue(childInserts == 1, @"Children should be written along with their parents, but were written %lu times",childInserts);
+    XCTAssertTrue([[ChildObject MB_countAll] intValue] == 1800, @"Should have saved 1800 children, but found %@",[ChildObject MB_countAll]);
+    
+    // Loaded in more than one chunk of parents
+    NSArray *loaded = [ParentObject MB_findAll];
+    XCTAssertTrue(loaded.count == 600, @"Should have loaded 600 parents, but found %lu",loaded.count);
+    for ( ParentObject *parent in loaded ) {
+        XCTAssertTrue(parent.children.count == 3, @"%@ should have 3 children, but has %lu",parent.parentName,parent.children.count);
+        ChildObject *child = parent.children[0];
+        XCTAssertTrue([child.childName hasPrefix:[[parent.parentName substringFromIndex:7] stringByAppendingString:@"-"]], @"%@ has the wrong child %@",parent.parentName,child.childName);
+    }
+    
+    NSArray *withoutChildren = [ParentObject MB_search:@[] parameters:@{} limit:10 orderBy:DHMambaObjectOrderByOrderNumber including:@[]];
+    XCTAssertTrue([withoutChildren[0] children].count == 0, @"Children shouldn't be loaded");
+    
+    [parents[0] MB_delete];
+    XCTAssertTrue([[ChildObject MB_countAll] intValue] == 1797, @"Deleting a parent should delete its children, but found %@",[ChildObject MB_countAll]);
+    
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+}
+
 - (void)testSelfEncoding
 {
     SelfCodedObject *sco = [[SelfCodedObject alloc] init];
@@ -287,12 +487,104 @@
     XCTAssertTrue(first.frame.size.height == 40, @"frame HEIGHT was incorrect, was %f instead",first.frame.size.height);
 }
 
-- (void)testInsertSpeed
+- (void)testSaveAll
 {
-    for ( int i =0; i < 10000; i++ ) {
+    NSMutableArray *parents = [[NSMutableArray alloc] init];
+    for ( int i = 0; i < 2500; i++ ) {
         ParentObject *newObj = [[ParentObject alloc] init];
-        [newObj MB_save];
+        newObj.parentName = [NSString stringWithFormat:@"parent %d",i];
+        [parents addObject:newObj];
+    }
+    [ParentObject MB_saveAll:parents];
+    
+    NSNumber *parentCount = [ParentObject MB_countAll];
+    XCTAssertTrue([parentCount intValue] == 2500, @"Should have saved 2500 parents, but found %@",parentCount);
+    
+    ParentObject *first = parents[0];
+    first.parentName = @"renamed";
+    [ParentObject MB_saveAll:@[first]];
+    
+    NSArray *renamed = [ParentObject MB_findWithTitle:@"renamed"];
+    XCTAssertTrue(renamed.count == 1, @"Should have found 1 renamed parent, but found %lu",renamed.count);
+    parentCount = [ParentObject MB_countAll];
+    XCTAssertTrue([parentCount intValue] == 2500, @"Saving an existing parent should update, but count is now %@",parentCount);
+}
+
+- (void)testBatchInsert
+{
+    NSMutableArray *parents = [[NSMutableArray alloc] init];
+    for ( int i = 0; i < 10000; i++ ) {
+        [parents addObject:[[ParentObject alloc] init]];
+    }
+    
+    __block NSUInteger notifications = 0;
+    __block NSArray *insertedIDs = nil;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:kDHMambaStoreNotification object:[ParentObject class] queue:nil usingBlock:^(NSNotification *note) {
+        notifications++;
+        insertedIDs = note.userInfo[kDHMambaStoreNotificationObjectsKey];
+        XCTAssertEqualObjects(note.userInfo[kDHMambaStoreNotificationOperationKey], @"insert", @"Batch should be an insert");
+    }];
+    [ParentObject MB_saveAll:parents];
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    
+    XCTAssertTrue([[ParentObject MB_countAll] unsignedIntegerValue] == parents.count, @"Should have stored %lu parents, but stored %@",(unsigned long)parents.count,[ParentObject MB_countAll]);
+    XCTAssertTrue(notifications == 1, @"Should have posted one notification for the batch, but posted %lu",(unsigned long)notifications);
+    XCTAssertTrue(insertedIDs.count == parents.count, @"Notification should list every inserted objID");
+}
+
+- (void)testConcurrentReads
+{
+    // reopen the same store with a pool of read connections
+    [DHMambaStore openStore:@"mamba.db" maximumReaders:4];
+    
+    NSArray *allStates = [State MB_findAll];
+    XCTAssertTrue(allStates.count == 50, @"Should have found 50 states, but found %lu",allStates.count);
+    
+    for ( size_t threads = 1; threads <= 8; threads *= 2 ) {
+        
+        NSUInteger queriesPerThread = 100;
+        NSDate *start = [NSDate date];
+        dispatch_apply(threads, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+            for ( NSUInteger i = 0; i < queriesPerThread; i++ ) {
+                [State MB_findWithForeignKey:@"N"];
+            }
+        });
+        NSTimeInterval elapsed = -[start timeIntervalSinceNow];
+        NSLog(@"%zu threads: %.0f queries/second",threads,(threads * queriesPerThread) / elapsed);
+    }
+    
+    // writes still go through the single writer and are visible to readers
+    State *newState = [[State alloc] init];
+    newState.abbreviation = @"NXX";
+    newState.name = @"NEW STATE";
+    [newState MB_save];
+    XCTAssertNotNil([State MB_findWithKey:@"NXX"], @"Readers should see the new state");
+}
+
+- (void)testIndexes
+{
+    NSString *documentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
+    FMDatabase *db = [FMDatabase databaseWithPath:[documentsDirectory stringByAppendingPathComponent:@"mamba.db"]];
+    XCTAssertTrue([db open], @"Couldn't open the store directly");
+    
+    NSMutableArray *indexNames = [[NSMutableArray alloc] init];
+    FMResultSet *results = [db executeQuery:@"select name from sqlite_master where type = 'index' and tbl_name = 'State'"];
+    while ( [results next] ) {
+        [indexNames addObject:[results stringForColumnIndex:0]];
     }
+    for ( NSString *column in @[@"objKey",@"objForeignKey",@"objTitle",@"orderNumber",@"createTime",@"updateTime"] ) {
+        NSString *indexName = [NSString stringWithFormat:@"State_idx_%@",column];
+        XCTAssertTrue([indexNames containsObject:indexName], @"Missing index %@, found %@",indexName,indexNames);
+    }
+    
+    // finding by key should use the index instead of scanning the table
+    NSString *plan = @"";
+    results = [db executeQuery:@"explain query plan select * from State where objKey = ?",@"GA"];
+    while ( [results next] ) {
+        plan = [plan stringByAppendingString:[results stringForColumn:@"detail"]];
+    }
+    XCTAssertTrue([plan rangeOfString:@"State_idx_objKey"].location != NSNotFound, @"objKey lookup isn't using the index: %@",plan);
+    [db close];
 }
 
 - (void)testCount
@@ -337,4 +629,773 @@
     XCTAssertTrue([updateCount intValue] == 50, @"There should be 50 states updated today");
 }
 
+- (void)testKeyedArchiveRows
+{
+    // rows saved before the binary encoding existed must still load
+    State *georgia = [State MB_findWithKey:@"GA"];
+    NSMutableData *keyedArchive = [NSMutableData data];
+    NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:keyedArchive];
+    [archiver encodeObject:@"OLD GEORGIA" forKey:@"name"];
+    [archiver encodeObject:@"GA" forKey:@"abbreviation"];
+    [archiver finishEncoding];
+    XCTAssertFalse([DHMambaCoder canDecodeData:keyedArchive], @"Keyed archive mistaken for binary data");
+    
+    NSString *documentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
+    FMDatabase *db = [FMDatabase databaseWithPath:[documentsDirectory stringByAppendingPathComponent:@"mamba.db"]];
+    XCTAssertTrue([db open], @"Couldn't open the store directly");
+    XCTAssertTrue([db executeUpdate:@"update State set objBody = ? where objID = ?",keyedArchive,[georgia MB_objID]], @"Couldn't replace the body");
+    [db close];
+    
+    State *loaded = [State MB_loadWithID:[georgia MB_objID]];
+    XCTAssertEqualObjects(loaded.name, @"OLD GEORGIA", @"Keyed archive row didn't load");
+    XCTAssertEqualObjects(loaded.abbreviation, @"GA", @"Keyed archive row didn't load");
+}
+
+- (void)testFillNewIndexedProperties
+{
+    // a store saved before capital was an indexed property
+    [DHMambaStore closeStore];
+    NSString *documentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
+    FMDatabase *db = [FMDatabase databaseWithPath:[documentsDirectory stringByAppendingPathComponent:@"mamba.db"]];
+    XCTAssertTrue([db open], @"Couldn't open the store directly");
+    BOOL rebuilt = [db executeUpdate:@"create table State_old as select objID, objKey, objForeignKey, objTitle, createTime, updateTime, orderNumber, objBody, mostPopulousCity from State"] &&
+                   [db executeUpdate:@"drop table State"] &&
+                   [db executeUpdate:@"alter table State_old rename to State"];
+    [db close];
+    XCTAssertTrue(rebuilt, @"Couldn't remove the capital column");
+    
+    // every reader is the first to use the collection, and all of them wait
+    // for the one fill
+    [DHMambaStore openStore:@"mamba.db" maximumReaders:4];
+    NSMutableArray *counts = [[NSMutableArray alloc] init];
+    dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t thread) {
+        NSNumber *count = [State MB_count:@"capital = :capital" parameters:@{@"capital":@"Atlanta"}];
+        @synchronized(counts) {
+            [counts addObject:count];
+        }
+    });
+    XCTAssertTrue(counts.count == 8, @"Every reader should have finished, but %lu did",(unsigned long)counts.count);
+    for ( NSNumber *count in counts ) {
+        XCTAssertTrue([count integerValue] == 1, @"A reader ran before the fill finished and found %@",count);
+    }
+    
+    NSArray *found = [State MB_search:@[@"capital = :capital"] parameters:@{@"capital":@"Atlanta"} limit:0 orderBy:DHMambaObjectOrderByKey];
+    XCTAssertTrue(found.count == 1, @"Should have filled in capital for every state, but found %lu",(unsigned long)found.count);
+    XCTAssertEqualObjects([found.firstObject abbreviation], @"GA", @"Found the wrong state");
+}
+
+- (void)testDecodingUsesSetters
+{
+    ScalarObject *object = [[ScalarObject alloc] init];
+    object.count = 500;
+    object.weight = 1.5;
+    NSData *data = [DHMambaCoder encodeObject:object ignoring:nil];
+    
+    LimitedScalarObject *limited = [[LimitedScalarObject alloc] init];
+    XCTAssertTrue([DHMambaCoder decodeData:data intoObject:limited], @"Couldn't decode");
+    XCTAssertTrue(limited.count == 100, @"Custom setter should have run, but count is %ld",(long)limited.count);
+    XCTAssertTrue(limited.weight == 1.5f, @"Weight wasn't decoded");
+    
+    ScalarObject *observed = [[ScalarObject alloc] init];
+    self.observedChanges = 0;
+    [observed addObserver:self forKeyPath:@"count" options:0 context:NULL];
+    XCTAssertTrue([DHMambaCoder decodeData:data intoObject:observed], @"Couldn't decode an observed object");
+    [observed removeObserver:self forKeyPath:@"count"];
+    XCTAssertTrue(observed.count == 500 && observed.weight == 1.5f, @"Observed object wasn't decoded");
+    XCTAssertTrue(self.observedChanges == 1, @"Observer should have seen count change once, but saw %lu changes",(unsigned long)self.observedChanges);
+    
+    // encoding goes through the getter, so accessors run both ways
+    HalvedScalarObject *halved = [[HalvedScalarObject alloc] init];
+    halved.ratio = 3;
+    NSData *halvedData = [DHMambaCoder encodeObject:halved ignoring:nil];
+    HalvedScalarObject *decodedHalved = [[HalvedScalarObject alloc] init];
+    XCTAssertTrue([DHMambaCoder decodeData:halvedData intoObject:decodedHalved], @"Couldn't decode");
+    XCTAssertTrue(decodedHalved.ratio == 3, @"Ratio should round trip through the accessors, but is %f",decodedHalved.ratio);
+    ScalarObject *plain = [[ScalarObject alloc] init];
+    XCTAssertTrue([DHMambaCoder decodeData:halvedData intoObject:plain], @"Couldn't decode");
+    XCTAssertTrue(plain.ratio == 3, @"The getter's value should be stored, but %f was",plain.ratio);
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath ofObject:(id)object change:(NSDictionary *)change context:(void *)context
+{
+    self.observedChanges++;
+}
+
+- (void)testSerializerBenchmark
+{
+    NSArray *states = [State MB_findAll];
+    NSArray *properties = @[@"name",@"abbreviation",@"population",@"squareMiles",@"capital",@"mostPopulousCity"];
+    NSUInteger rounds = 100;
+    
+    // the keyed archive encoding the store used to use
+    NSUInteger keyedSize = 0;
+    NSMutableArray *keyedArchives = [[NSMutableArray alloc] init];
+    NSDate *start = [NSDate date];
+    for ( NSUInteger round = 0; round < rounds; round++ ) {
+        for ( State *state in states ) {
+            NSMutableData *archive = [NSMutableData data];
+            NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:archive];
+            for ( NSString *property in properties ) {
+                [archiver encodeObject:[state valueForKey:property] forKey:property];
+            }
+            [archiver finishEncoding];
+            if ( round == 0 ) {
+                keyedSize += archive.length;
+                [keyedArchives addObject:archive];
+            }
+        }
+    }
+    NSTimeInterval keyedEncodeTime = -[start timeIntervalSinceNow];
+    
+    start = [NSDate date];
+    for ( NSUInteger round = 0; round < rounds; round++ ) {
+        for ( NSData *archive in keyedArchives ) {
+            State *state = [[State alloc] init];
+            NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:archive];
+            for ( NSString *property in properties ) {
+                [state setValue:[unarchiver decodeObjectForKey:property] forKey:property];
+            }
+            [unarchiver finishDecoding];
+        }
+    }
+    NSTimeInterval keyedDecodeTime = -[start timeIntervalSinceNow];
+    
+    // and the binary encoding
+    NSUInteger binarySize = 0;
+    NSMutableArray *binaryArchives = [[NSMutableArray alloc] init];
+    start = [NSDate date];
+    for ( NSUInteger round = 0; round < rounds; round++ ) {
+        for ( State *state in states ) {
+            NSData *archive = [DHMambaCoder encodeObject:state ignoring:nil];
+            if ( round == 0 ) {
+                binarySize += archive.length;
+                [binaryArchives addObject:archive];
+            }
+        }
+    }
+    NSTimeInterval binaryEncodeTime = -[start timeIntervalSinceNow];
+    
+    start = [NSDate date];
+    for ( NSUInteger round = 0; round < rounds; round++ ) {
+        for ( NSData *archive in binaryArchives ) {
+            State *state = [[State alloc] init];
+            [DHMambaCoder decodeData:archive intoObject:state];
+        }
+    }
+    NSTimeInterval binaryDecodeTime = -[start timeIntervalSinceNow];
+    
+    NSLog(@"keyed archive: %lu bytes, encode %f seconds, decode %f seconds",keyedSize,keyedEncodeTime,keyedDecodeTime);
+    NSLog(@"binary: %lu bytes, encode %f seconds, decode %f seconds",binarySize,binaryEncodeTime,binaryDecodeTime);
+    XCTAssertTrue(binarySize < keyedSize, @"Binary encoding should be smaller than the keyed archive");
+    
+    // make sure the values survive the trip
+    State *decoded = [[State alloc] init];
+    XCTAssertTrue([DHMambaCoder decodeData:binaryArchives[0] intoObject:decoded], @"Couldn't decode");
+    for ( NSString *property in properties ) {
+        XCTAssertEqualObjects([decoded valueForKey:property], [states[0] valueForKey:property], @"%@ didn't round trip",property);
+    }
+}
+
+- (void)testScalarProperties
+{
+    ScalarObject *scalars = [[ScalarObject alloc] init];
+    scalars.count = -42;
+    scalars.bigCount = 1ULL << 63;
+    scalars.ratio = 0.25;
+    scalars.weight = 1.5f;
+    scalars.enabled = YES;
+    scalars.label = @"scalars";
+    scalars.when = [NSDate dateWithTimeIntervalSinceReferenceDate:1000];
+    [scalars MB_save];
+    
+    ScalarObject *loaded = [ScalarObject MB_loadWithID:[scalars MB_objID]];
+    XCTAssertTrue(loaded.count == -42, @"count was %ld",(long)loaded.count);
+    XCTAssertTrue(loaded.bigCount == 1ULL << 63, @"bigCount was %llu",loaded.bigCount);
+    XCTAssertEqual(loaded.ratio, 0.25, @"ratio didn't round trip");
+    XCTAssertEqual(loaded.weight, 1.5f, @"weight didn't round trip");
+    XCTAssertTrue(loaded.enabled, @"enabled didn't round trip");
+    XCTAssertEqualObjects(loaded.label, @"scalars", @"label didn't round trip");
+    XCTAssertEqualObjects(loaded.when, scalars.when, @"when didn't round trip");
+}
+
+- (void)testEnumerate
+{
+    NSMutableArray *parents = [[NSMutableArray alloc] init];
+    for ( int i = 0; i < 250; i++ ) {
+        [parents addObject:[[ParentObject alloc] init]];
+    }
+    [ParentObject MB_saveAll:parents];
+    
+    // every object once, across several chunks
+    NSMutableSet *seen = [[NSMutableSet alloc] init];
+    [ParentObject MB_enumerateAllUsingBlock:^(id object, BOOL *stop) {
+        [seen addObject:[object MB_objID]];
+    }];
+    XCTAssertTrue(seen.count == 250, @"Should have enumerated 250 objects, but enumerated %lu",seen.count);
+    
+    // and stopping early
+    __block NSUInteger count = 0;
+    [State MB_enumerate:@[@"objForeignKey = :objForeignKey"] parameters:@{@"objForeignKey":@"N"} orderBy:DHMambaObjectOrderByKey usingBlock:^(id object, BOOL *stop) {
+        count++;
+        *stop = count == 3;
+    }];
+    XCTAssertTrue(count == 3, @"Should have stopped after 3 objects, but saw %lu",count);
+}
+
+- (void)testPages
+{
+    NSMutableSet *seen = [[NSMutableSet alloc] init];
+    NSString *token = nil;
+    NSUInteger pages = 0;
+    do {
+        NSArray *page = [State MB_findAllLimit:7 orderBy:DHMambaObjectOrderByOrderNumber after:token nextToken:&token];
+        for ( State *state in page ) {
+            XCTAssertFalse([seen containsObject:state.abbreviation], @"%@ was on more than one page",state.abbreviation);
+            [seen addObject:state.abbreviation];
+        }
+        
+        // inserting in front of the current position shouldn't shift the next page
+        if ( pages++ == 2 ) {
+            State *tiny = [[State alloc] init];
+            tiny.abbreviation = @"XX";
+            tiny.population = @"1";
+            [tiny MB_save];
+        }
+    } while ( token );
+    XCTAssertTrue(seen.count == 50, @"Should have paged through 50 states, but saw %lu",seen.count);
+    
+    // descending, through objects that have no order number
+    NSMutableArray *parents = [[NSMutableArray alloc] init];
+    for ( int i = 0; i < 25; i++ ) {
+        [parents addObject:[[ParentObject alloc] init]];
+    }
+    [ParentObject MB_saveAll:parents];
+    [seen removeAllObjects];
+    do {
+        NSArray *page = [ParentObject MB_findAllLimit:10 orderBy:DHMambaObjectOrderByOrderNumberDescending after:token nextToken:&token];
+        for ( ParentObject *parent in page ) {
+            [seen addObject:[parent MB_objID]];
+        }
+    } while ( token );
+    XCTAssertTrue(seen.count == 25, @"Should have paged through 25 parents, but saw %lu",seen.count);
+}
+
+- (void)testObjectCache
+{
+    ScalarObject *hot = [[ScalarObject alloc] init];
+    hot.label = @"hot";
+    [hot MB_save];
+    XCTAssertNotNil([hot MB_createTime], @"Save should set the create time");
+    
+    NSUInteger hits = [ScalarObject MB_cacheHits];
+    XCTAssertTrue([ScalarObject MB_loadWithID:[hot MB_objID]] == hot, @"Saved instance should be cached");
+    XCTAssertTrue([ScalarObject MB_findWithKey:@"hot"] == hot, @"Lookup by key should return the cached instance");
+    XCTAssertTrue([ScalarObject MB_findWithKey:@"hot"] == hot, @"Lookup by key should return the cached instance");
+    XCTAssertTrue([ScalarObject MB_cacheHits] == hits + 2, @"Expected 2 more hits, got %lu",[ScalarObject MB_cacheHits] - hits);
+    
+    // changing the key and deleting have to invalidate
+    hot.label = @"cold";
+    [hot MB_save];
+    XCTAssertNil([ScalarObject MB_findWithKey:@"hot"], @"Old key still found");
+    XCTAssertTrue([ScalarObject MB_findWithKey:@"cold"] == hot, @"New key not found");
+    [hot MB_delete];
+    XCTAssertNil([ScalarObject MB_loadWithID:[hot MB_objID]], @"Deleted object still cached");
+    
+    // cleared objects are loaded as new instances
+    ScalarObject *other = [[ScalarObject alloc] init];
+    [other MB_save];
+    [ScalarObject MB_clearCache];
+    ScalarObject *loaded = [ScalarObject MB_loadWithID:[other MB_objID]];
+    XCTAssertTrue(loaded != other && loaded != nil, @"Cleared cache should load a new instance");
+    XCTAssertTrue([ScalarObject MB_loadWithID:[other MB_objID]] == loaded, @"Loaded instance should be cached");
+    
+    // a full cache drops the least recently used object
+    [ScalarObject MB_clearCache];
+    NSMutableArray *saved = [[NSMutableArray alloc] init];
+    for ( NSUInteger i = 0; i < [ScalarObject mambaObjectCacheLimit]; i++ ) {
+        ScalarObject *object = [[ScalarObject alloc] init];
+        object.label = [NSString stringWithFormat:@"recent%lu",(unsigned long)i];
+        [object MB_save];
+        [saved addObject:object];
+    }
+    XCTAssertTrue([ScalarObject MB_loadWithID:[saved[0] MB_objID]] == saved[0], @"Oldest object should still be cached");
+    ScalarObject *extra = [[ScalarObject alloc] init];
+    [extra MB_save];
+    XCTAssertTrue([ScalarObject MB_loadWithID:[saved[0] MB_objID]] == saved[0], @"Recently used object was evicted");
+    XCTAssertTrue([ScalarObject MB_loadWithID:[saved[1] MB_objID]] != saved[1], @"Least recently used object should have been evicted");
+}
+
+- (void)testAsync
+{
+    dispatch_queue_t queue = dispatch_queue_create("MambaStoreTests", DISPATCH_QUEUE_SERIAL);
+    dispatch_semaphore_t done = dispatch_semaphore_create(0);
+    
+    NSMutableArray *parents = [[NSMutableArray alloc] init];
+    for ( int i = 0; i < 100; i++ ) {
+        [parents addObject:[[ParentObject alloc] init]];
+    }
+    
+    // queued work runs in order, so the find sees the save
+    __block BOOL saved = NO;
+    __block NSArray *found = nil;
+    [ParentObject MB_saveAsync:parents queue:queue completion:^{
+        saved = YES;
+    }];
+    [ParentObject MB_findAllAsync:queue completion:^(NSArray *objects) {
+        found = objects;
+        dispatch_semaphore_signal(done);
+    }];
+    
+    XCTAssertTrue(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)) == 0, @"Async find never finished");
+    XCTAssertTrue(saved, @"Save completion should be called before the find completion");
+    XCTAssertTrue(found.count == 100, @"Should have found 100 parents, but found %lu",found.count);
+    
+    __block NSNumber *count = nil;
+    [State MB_countAsync:@"objForeignKey = :objForeignKey" parameters:@{@"objForeignKey":@"N"} queue:queue completion:^(NSNumber *result) {
+        count = result;
+        dispatch_semaphore_signal(done);
+    }];
+    XCTAssertTrue(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)) == 0, @"Async count never finished");
+    XCTAssertTrue([count intValue] == 8, @"Should have counted 8 states, but counted %@",count);
+    
+    // closing from an operation is refused instead of waiting on itself
+    [DHMambaStore performAsync:^id{
+        [DHMambaStore closeStore];
+        dispatch_semaphore_signal(done);
+        return nil;
+    } queue:queue completion:nil];
+    XCTAssertTrue(dispatch_semaphore_wait(done, dispatch_time(DISPATCH_TIME_NOW, 10 * NSEC_PER_SEC)) == 0, @"Closing from an operation deadlocked");
+    XCTAssertTrue([[State MB_countAll] intValue] == 50, @"Store should still be open");
+    
+    // a full queue turns work away instead of blocking
+    for ( int wait = 0; wait < 1000 && [DHMambaStore pendingAsyncOperationCount] > 0; wait++ ) {
+        [NSThread sleepForTimeInterval:0.01];
+    }
+    dispatch_semaphore_t gate = dispatch_semaphore_create(0);
+    [DHMambaStore performAsync:^id{
+        dispatch_semaphore_wait(gate, DISPATCH_TIME_FOREVER);
+        return nil;
+    } queue:queue completion:nil];
+    NSUInteger queued = 1;
+    while ( [DHMambaStore performAsync:^id{ return nil; } writes:NO queue:queue completion:nil] ) {
+        queued++;
+    }
+    XCTAssertFalse([DHMambaStore canPerformAsync], @"Queue should be full");
+    XCTAssertTrue([DHMambaStore pendingAsyncOperationCount] == queued, @"Expected %lu pending operations, but have %lu",(unsigned long)queued,(unsigned long)[DHMambaStore pendingAsyncOperationCount]);
+    dispatch_semaphore_signal(gate);
+}
+
+- (void)testWriteBehind
+{
+    [DHMambaStore enableWriteBehindWithInterval:60 threshold:1000];
+    
+    __block NSUInteger writes = 0;
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:kDHMambaStoreNotification object:[SavedState class] queue:nil usingBlock:^(NSNotification *note) {
+        writes += [note.userInfo[kDHMambaStoreNotificationObjectsKey] count];
+    }];
+    
+    SavedState *state = [[SavedState alloc] init];
+    state.abbreviation = @"WB";
+    for ( int i = 0; i < 5; i++ ) {
+        state.population = [NSString stringWithFormat:@"%d",i];
+        [state MB_save];
+    }
+    XCTAssertTrue(writes == 0, @"Saves should still be waiting");
+    XCTAssertTrue(state.savedCount == 0, @"mambaAfterSave should wait for the write");
+    XCTAssertTrue([SavedState MB_loadWithID:[state MB_objID]] == state, @"Waiting object should be returned by ID");
+    XCTAssertTrue([SavedState MB_findWithKey:@"WB"] == state, @"Waiting object should be returned by key");
+    
+    // reading another collection leaves the waiting objects alone
+    [State MB_countAll];
+    XCTAssertTrue(writes == 0, @"Reading states shouldn't write saved states, but wrote %lu",writes);
+    
+    // a query of the collection writes everything waiting first
+    NSNumber *count = [SavedState MB_countAll];
+    XCTAssertTrue([count integerValue] == 1, @"Should have found 1 saved state, but found %@",count);
+    XCTAssertTrue(writes == 1, @"5 saves should have been 1 write, but were %lu",writes);
+    XCTAssertTrue(state.savedCount == 1, @"mambaAfterSave should be called once per write, but was called %lu times",state.savedCount);
+    
+    // turning it on again writes what was waiting instead of dropping it
+    state.population = @"5";
+    [state MB_save];
+    [DHMambaStore enableWriteBehindWithInterval:60 threshold:1000];
+    XCTAssertTrue(writes == 2, @"Waiting save should have been written, but writes were %lu",writes);
+    [DHMambaStore disableWriteBehind];
+    
+    SavedState *found = [SavedState MB_loadWithID:[state MB_objID]];
+    XCTAssertEqualObjects(found.population, @"5", @"Read didn't see the last save");
+    
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+}
+
+- (void)testChangeSets
+{
+    [DHMambaStore setChangeInterval:0.1 queue:nil];
+    
+    NSMutableArray *received = [[NSMutableArray alloc] init];
+    id observer = [[NSNotificationCenter defaultCenter] addObserverForName:kDHMambaStoreChangesNotification object:[ParentObject class] queue:nil usingBlock:^(NSNotification *note) {
+        [received addObject:note.userInfo[@"changes"]];
+    }];
+    
+    ParentObject *kept = [[ParentObject alloc] init];
+    [kept MB_save];
+    ParentObject *removed = [[ParentObject alloc] init];
+    [removed MB_save];
+    kept.parentName = @"updated";
+    [kept MB_save];
+    [removed MB_delete];
+    for ( int i = 0; i < 100; i++ ) {
+        [[[ParentObject alloc] init] MB_save];
+    }
+    XCTAssertTrue(received.count == 0, @"Changes should be posted after the writes");
+    
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:5];
+    while ( received.count == 0 && [timeout timeIntervalSinceNow] > 0 ) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    }
+    XCTAssertTrue(received.count == 1, @"Should have gotten 1 change set, but got %lu",received.count);
+    
+    DHMambaChangeSet *changes = [received firstObject];
+    XCTAssertTrue(changes.insertedIDs.count == 101, @"Should have 101 inserts, but has %lu",changes.insertedIDs.count);
+    XCTAssertTrue([changes.insertedIDs containsObject:[kept MB_objID]], @"Inserted and updated object should be listed as inserted");
+    XCTAssertTrue(changes.updatedIDs.count == 0, @"Should have no updates, but has %lu",changes.updatedIDs.count);
+    XCTAssertTrue(changes.deletedIDs.count == 0, @"Inserted and deleted object shouldn't be listed, but has %lu deletes",changes.deletedIDs.count);
+    
+    [[NSNotificationCenter defaultCenter] removeObserver:observer];
+    [DHMambaStore setChangeInterval:0 queue:nil];
+}
+
+- (void)testLiveQuery
+{
+    DHMambaLiveQuery *query = [State MB_liveQuery:@[@"objForeignKey = :objForeignKey"] parameters:@{@"objForeignKey":@"N"} limit:3 orderBy:DHMambaObjectOrderByOrderNumberDescending];
+    XCTAssertTrue(query.objects.count == 3, @"Should have found 3 states, but found %lu",query.objects.count);
+    NSArray *before = [query.objects valueForKey:@"abbreviation"];
+    
+    __block DHMambaLiveQueryChanges *lastChanges = nil;
+    query.changeBlock = ^(DHMambaLiveQuery *liveQuery, DHMambaLiveQueryChanges *changes) {
+        lastChanges = changes;
+    };
+    BOOL (^waitForChanges)(void) = ^BOOL{
+        NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:5];
+        while ( !lastChanges && [timeout timeIntervalSinceNow] > 0 ) {
+            [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+        }
+        return lastChanges != nil;
+    };
+    
+    // Goes in at the top and pushes the last state out
+    State *biggest = [[State alloc] init];
+    biggest.abbreviation = @"NZ";
+    biggest.name = @"NEW ZEALAND";
+    biggest.population = @"999999999";
+    [biggest MB_save];
+    XCTAssertTrue(waitForChanges(), @"Live query never changed");
+    XCTAssertEqualObjects([query.objects[0] abbreviation], @"NZ", @"New state should be first");
+    XCTAssertTrue(query.objects.count == 3, @"Should still have 3 states, but has %lu",query.objects.count);
+    XCTAssertTrue([lastChanges.insertedIndexes containsIndex:0] && [lastChanges.removedIndexes containsIndex:2], @"Wrong changes for the insert");
+    
+    // Removing it brings the old last state back from the store
+    lastChanges = nil;
+    [biggest MB_delete];
+    XCTAssertTrue(waitForChanges(), @"Live query never changed");
+    XCTAssertEqualObjects([query.objects valueForKey:@"abbreviation"], before, @"Should be back to the original states");
+    XCTAssertTrue([lastChanges.removedIndexes containsIndex:0] && [lastChanges.insertedIndexes containsIndex:2], @"Wrong changes for the delete");
+    
+    // Text is kept in the order SQLite sorts it, by UTF-8 bytes. In UTF-16
+    // the emoji would come first.
+    DHMambaLiveQuery *titleQuery = [State MB_liveQuery:@[@"objForeignKey = :objForeignKey"] parameters:@{@"objForeignKey":@"Q"} limit:0 orderBy:DHMambaObjectOrderByTitle];
+    titleQuery.changeBlock = query.changeBlock;
+    query.changeBlock = nil;
+    lastChanges = nil;
+    State *emoji = [[State alloc] init];
+    emoji.abbreviation = @"QE";
+    emoji.name = @"\U0001F600";
+    State *halfwidth = [[State alloc] init];
+    halfwidth.abbreviation = @"QH";
+    halfwidth.name = @"\uFF61";
+    [State MB_saveAll:@[emoji,halfwidth]];
+    XCTAssertTrue(waitForChanges(), @"Live query never changed");
+    NSArray *stored = [[State MB_findWithForeignKey:@"Q" limit:0 orderBy:DHMambaObjectOrderByTitle] valueForKey:@"abbreviation"];
+    XCTAssertEqualObjects(stored, (@[@"QH",@"QE"]), @"Store sorted titles wrong %@",stored);
+    XCTAssertEqualObjects([titleQuery.objects valueForKey:@"abbreviation"], stored, @"Live query should match the store");
+    [emoji MB_delete];
+    [halfwidth MB_delete];
+}
+
+- (void)testAggregates
+{
+    NSArray *allStates = [State MB_findAll];
+    long long totalPopulation = 0;
+    for ( State *state in allStates ) {
+        totalPopulation += [state.population longLongValue];
+    }
+    
+    NSNumber *sum = [State MB_aggregate:DHMambaObjectAggregateSum ofColumn:@"orderNumber" criteria:@[] parameters:@{}];
+    XCTAssertTrue([sum longLongValue] == totalPopulation, @"Sum should be %lld, but was %@",totalPopulation,sum);
+    
+    NSNumber *largest = [State MB_aggregate:DHMambaObjectAggregateMaximum ofColumn:@"orderNumber" criteria:@[@"objForeignKey = :objForeignKey"] parameters:@{@"objForeignKey":@"N"}];
+    XCTAssertTrue([largest longLongValue] == [[[State MB_findWithForeignKey:@"N" limit:1 orderBy:DHMambaObjectOrderByOrderNumberDescending][0] population] longLongValue], @"Wrong largest population %@",largest);
+    
+    id newest = [State MB_aggregate:DHMambaObjectAggregateMaximum ofColumn:@"updateTime" criteria:@[] parameters:@{}];
+    XCTAssertTrue([newest isKindOfClass:[NSDate class]], @"Maximum update time should be a date, but was %@",newest);
+    
+    NSDictionary *counts = [State MB_countGroupedBy:@"objForeignKey"];
+    XCTAssertTrue([counts[@"N"] intValue] == 8, @"Should have counted 8 N states, but counted %@",counts[@"N"]);
+    NSArray *letters = [State MB_distinct:@"objForeignKey" criteria:@[] parameters:@{}];
+    XCTAssertTrue(letters.count == counts.count, @"Should have %lu distinct letters, but found %lu",counts.count,letters.count);
+    
+    XCTAssertNil([State MB_aggregate:DHMambaObjectAggregateSum ofColumn:@"population; drop table State" criteria:@[] parameters:@{}], @"Unknown columns should be refused");
+}
+
+- (void)testProjections
+{
+    NSArray *rows = [State MB_select:@[@"objKey",@"capital",@"updateTime"] criteria:@[@"objForeignKey = :objForeignKey"] parameters:@{@"objForeignKey":@"T"} limit:0 orderBy:DHMambaObjectOrderByKey];
+    XCTAssertTrue(rows.count == 2, @"Should have found 2 T states, but found %lu",rows.count);
+    XCTAssertEqualObjects(rows[1][@"objKey"], @"TX", @"Rows are in the wrong order");
+    XCTAssertEqualObjects(rows[1][@"capital"], @"Austin", @"Wrong capital %@",rows[1][@"capital"]);
+    XCTAssertTrue([rows[1][@"updateTime"] isKindOfClass:[NSDate class]], @"Update time should be a date");
+    XCTAssertNil([State MB_select:@[@"objBody"] criteria:@[] parameters:@{} limit:0 orderBy:DHMambaObjectOrderByKey], @"Only columns that can be searched should be selectable");
+    
+    NSArray *faults = [State MB_searchFaults:@[@"objKey = :objKey"] parameters:@{@"objKey":@"TX"} limit:0 orderBy:DHMambaObjectOrderByKey];
+    State *texas = [faults firstObject];
+    XCTAssertTrue([texas isKindOfClass:[State class]], @"A fault should pass for its class");
+    XCTAssertEqualObjects([texas MB_objTitle], @"Texas", @"Wrong title %@",[texas MB_objTitle]);
+    XCTAssertEqualObjects(texas.capital, @"Austin", @"Wrong capital %@",texas.capital);
+    XCTAssertFalse([(DHMambaFault *)texas isLoaded], @"Reading columns shouldn't load the object");
+    XCTAssertEqualObjects(texas.abbreviation, @"TX", @"Wrong abbreviation %@",texas.abbreviation);
+    XCTAssertTrue([(DHMambaFault *)texas isLoaded], @"Other properties should load the object");
+}
+
+
+- (void)testQueryBuilder
+{
+    DHMambaCondition *condition = [DHMambaCondition anyOf:@[[DHMambaCondition column:@"objKey" inValues:@[@"GA",@"TX"]],
+                                                            [DHMambaCondition allOf:@[[DHMambaCondition column:@"objForeignKey" equalTo:@"N"],
+                                                                                      [DHMambaCondition noneOf:@[[DHMambaCondition column:@"capital" like:@"%City"]]]]]]];
+    DHMambaQuery *query = [DHMambaQuery queryForClass:[State class] condition:condition];
+    [query orderBy:@"objForeignKey" descending:YES];
+    [query orderBy:@"objKey" descending:NO];
+    NSArray *found = [State MB_find:query];
+    NSNumber *count = [State MB_countFor:query];
+    XCTAssertTrue(found.count == [count unsignedIntegerValue], @"Found %lu states but counted %@",found.count,count);
+    XCTAssertEqualObjects([[found firstObject] abbreviation], @"TX", @"States are in the wrong order");
+    XCTAssertEqualObjects([[found lastObject] abbreviation], @"GA", @"States are in the wrong order");
+    for ( State *state in found ) {
+        XCTAssertFalse([state.capital hasSuffix:@"City"], @"%@ should have been left out",state.name);
+    }
+    
+    // the same shape of query compiles to the same SQL
+    NSArray *arguments = nil;
+    query.limit = 2;
+    query.offset = 1;
+    NSString *firstSql = [query sqlSelecting:@"*" arguments:&arguments];
+    query.limit = 5;
+    NSString *secondSql = [query sqlSelecting:@"*" arguments:&arguments];
+    XCTAssertEqualObjects(firstSql, secondSql, @"Values shouldn't change the SQL");
+    XCTAssertTrue([State MB_find:query].count == 5, @"Should have found a page of 5 states");
+    
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"objTitle BEGINSWITH[c] %@ AND NOT (objKey IN %@)",@"new",@[@"NY"]];
+    found = [State MB_findMatching:predicate limit:0 orderBy:DHMambaObjectOrderByKey];
+    XCTAssertTrue(found.count == 3, @"Should have found 3 New states, but found %lu",found.count);
+    XCTAssertNil([State MB_findMatching:[NSPredicate predicateWithFormat:@"population > 1000"] limit:0 orderBy:DHMambaObjectOrderByKey], @"Properties without a column can't be searched");
+}
+
+
+- (void)testDiagnostics
+{
+    NSString *objID = [[[State MB_findAllLimit:1] firstObject] MB_objID];
+    
+    // everything counts as slow so every plan is captured
+    [DHMambaStore resetDiagnostics];
+    [DHMambaStore enableDiagnosticsWithSlowQueryThreshold:0];
+    [State MB_count:@"objBody is not null" parameters:@{}];
+    [State MB_loadWithID:objID];
+    [State MB_loadWithID:objID];
+    [DHMambaStore disableDiagnostics];
+    [State MB_findAll];
+    
+    NSArray *queryStats = [DHMambaStore queryStats];
+    XCTAssertTrue(queryStats.count == 2, @"Should have stats for 2 statements, but have %lu",queryStats.count);
+    for ( DHMambaQueryStats *stats in queryStats ) {
+        XCTAssertTrue(stats.plan.count > 0, @"Should have captured a plan for %@",stats.sql);
+        if ( [stats.sql rangeOfString:@"objBody is not null"].location != NSNotFound ) {
+            XCTAssertTrue(stats.fullTableScan, @"Counting on the body has to read every row: %@",stats.plan);
+            XCTAssertTrue(stats.executions == 1 && stats.rows == 1, @"Wrong counts %@",stats);
+        }
+        else {
+            XCTAssertFalse(stats.fullTableScan, @"Loading by ID should use the index: %@",stats.plan);
+            XCTAssertTrue(stats.executions == 2 && stats.rows == 2, @"Wrong counts %@",stats);
+        }
+    }
+    [DHMambaStore resetDiagnostics];
+}
+
+
+- (void)testMetrics
+{
+    [DHMambaMetrics reset];
+    [DHMambaMetrics enable];
+    NSArray *states = [State MB_findAll];
+    [[states firstObject] MB_save];
+    [DHMambaMetrics disable];
+    [State MB_findAll];
+    
+    NSDictionary *snapshot = [DHMambaMetrics snapshot];
+    NSDictionary *stateMetrics = snapshot[@"State"];
+    DHMambaHistogram *decode = stateMetrics[@"decode"];
+    XCTAssertTrue(decode.count == states.count, @"Should have decoded %lu states, but decoded %lu",states.count,decode.count);
+    DHMambaHistogram *rows = stateMetrics[@"rows"];
+    XCTAssertTrue(rows.count == 1 && rows.maximum == states.count, @"Wrong rows %@",rows);
+    XCTAssertTrue([stateMetrics[@"encode"] count] == 1, @"Should have encoded the saved state");
+    XCTAssertTrue([stateMetrics[@"execute"] count] == 2, @"Should have run a select and an update, but ran %@",stateMetrics[@"execute"]);
+    XCTAssertTrue([stateMetrics[@"notify"] count] >= 1, @"Should have timed the update notification");
+    XCTAssertTrue([snapshot[kDHMambaMetricsStoreCollection][@"queueWait"] count] == 2, @"Should have waited for the database twice");
+    XCTAssertTrue([decode valueAtPercentile:50] <= decode.maximum, @"Percentiles can't be over the maximum");
+    
+    [DHMambaMetrics reset];
+    XCTAssertTrue([DHMambaMetrics snapshot].count == 0, @"Reset should throw everything away");
+}
+
+- (void)testUniqueKey
+{
+    ScalarObject *first = [[ScalarObject alloc] init];
+    first.label = @"synced";
+    first.count = 1;
+    [first MB_save];
+    NSDate *createTime = [first MB_createTime];
+    
+    // the same object rebuilt from a sync updates the stored one
+    ScalarObject *again = [[ScalarObject alloc] init];
+    again.label = @"synced";
+    again.count = 2;
+    [again MB_save];
+    XCTAssertEqualObjects([again MB_objID], [first MB_objID], @"Same key should keep the stored objID");
+    XCTAssertEqualWithAccuracy([[again MB_createTime] timeIntervalSince1970], [createTime timeIntervalSince1970], 0.001, @"Same key should keep the stored create time");
+    XCTAssertTrue([[ScalarObject MB_countAll] integerValue] == 1, @"Should still have one object, but have %@",[ScalarObject MB_countAll]);
+    [ScalarObject MB_clearCache];
+    ScalarObject *stored = [ScalarObject MB_findWithKey:@"synced"];
+    XCTAssertTrue(stored.count == 2, @"The stored object wasn't updated");
+    
+    // saving a whole batch twice doesn't add anything
+    NSMutableArray *batch = [[NSMutableArray alloc] init];
+    for ( NSUInteger resync = 0; resync < 2; resync++ ) {
+        [batch removeAllObjects];
+        for ( NSInteger index = 0; index < 20; index++ ) {
+            ScalarObject *object = [[ScalarObject alloc] init];
+            object.label = [NSString stringWithFormat:@"batch%ld",(long)index];
+            object.count = index;
+            [batch addObject:object];
+        }
+        [ScalarObject MB_saveAll:batch];
+    }
+    XCTAssertTrue([[ScalarObject MB_countAll] integerValue] == 21, @"Re-syncing shouldn't add objects, but have %@",[ScalarObject MB_countAll]);
+    
+    // an update of a row that is gone puts it back
+    [DHMambaStore emptyCollection:@"ScalarObject"];
+    first.count = 3;
+    [first MB_save];
+    [ScalarObject MB_clearCache];
+    stored = [ScalarObject MB_loadWithID:[first MB_objID]];
+    XCTAssertTrue(stored.count == 3, @"Missing row should have been inserted again");
+}
+
+- (void)testChangeTracking
+{
+    ScalarObject *object = [[ScalarObject alloc] init];
+    object.label = @"tracked";
+    object.count = 1;
+    XCTAssertNil([object MB_changedProperties], @"Unsaved objects have nothing to compare with");
+    [object MB_save];
+    XCTAssertTrue([object MB_changedProperties].count == 0, @"Nothing changed since the save");
+    object.weight = 2.5;
+    XCTAssertEqualObjects([object MB_changedProperties], [NSSet setWithObject:@"weight"], @"Only weight changed");
+    [object MB_save];
+    
+    // saving again without changes doesn't write anything
+    NSDate *updateTime = [object MB_updateTime];
+    [NSThread sleepForTimeInterval:0.01];
+    [object MB_save];
+    XCTAssertEqualObjects([object MB_updateTime], updateTime, @"Unchanged object shouldn't have been written");
+    
+    // a loaded object starts out unchanged, and only writes what changes
+    [ScalarObject MB_clearCache];
+    ScalarObject *loaded = [ScalarObject MB_loadWithID:[object MB_objID]];
+    XCTAssertTrue(loaded != object, @"Should have loaded a new instance");
+    XCTAssertTrue([loaded MB_changedProperties].count == 0, @"Loaded object shouldn't have changes, but has %@",[loaded MB_changedProperties]);
+    loaded.enabled = YES;
+    [loaded MB_save];
+    [ScalarObject MB_clearCache];
+    ScalarObject *reloaded = [ScalarObject MB_loadWithID:[object MB_objID]];
+    XCTAssertTrue(reloaded.isEnabled && reloaded.weight == 2.5f && reloaded.count == 1, @"Changes weren't saved");
+}
+
+- (void)testCompression
+{
+    NSMutableData *repeated = [NSMutableData data];
+    for ( NSUInteger index = 0; index < 100; index++ ) {
+        [repeated appendData:[@"capital mostPopulousCity " dataUsingEncoding:NSUTF8StringEncoding]];
+    }
+    NSData *dictionary = [CompressedState mambaObjectCompressionDictionary];
+    for ( NSNumber *compression in @[@(DHMambaCompressionLZ4),@(DHMambaCompressionZlib)] ) {
+        NSData *compressed = [DHMambaCompressor compressData:repeated compression:[compression unsignedCharValue] dictionary:nil];
+        XCTAssertTrue([DHMambaCompressor isCompressedData:compressed] && compressed.length < repeated.length, @"Codec %@ didn't compress",compression);
+        XCTAssertEqualObjects([DHMambaCompressor decompressData:compressed dictionary:nil], repeated, @"Codec %@ didn't round trip",compression);
+    }
+    NSData *withDictionary = [DHMambaCompressor compressData:repeated compression:DHMambaCompressionZlib dictionary:dictionary];
+    XCTAssertEqualObjects([DHMambaCompressor decompressData:withDictionary dictionary:dictionary], repeated, @"Dictionary didn't round trip");
+    XCTAssertNil([DHMambaCompressor decompressData:withDictionary dictionary:nil], @"Should need the dictionary");
+    NSMutableData *changedDictionary = [dictionary mutableCopy];
+    [changedDictionary appendData:[@"changed" dataUsingEncoding:NSUTF8StringEncoding]];
+    XCTAssertNil([DHMambaCompressor decompressData:withDictionary dictionary:changedDictionary], @"Should refuse a different dictionary");
+    NSData *tiny = [@"tiny" dataUsingEncoding:NSUTF8StringEncoding];
+    XCTAssertEqualObjects([DHMambaCompressor compressData:tiny compression:DHMambaCompressionZlib dictionary:nil], tiny, @"Short data should be left alone");
+    XCTAssertFalse([DHMambaCompressor isCompressedData:[DHMambaCoder encodeObject:[State MB_findWithKey:@"GA"] ignoring:nil]], @"Encoded object mistaken for compressed data");
+    
+    for ( State *state in [State MB_findAll] ) {
+        CompressedState *compressed = [[CompressedState alloc] init];
+        compressed.name = state.name;
+        compressed.abbreviation = state.abbreviation;
+        compressed.population = state.population;
+        compressed.squareMiles = state.squareMiles;
+        compressed.capital = state.capital;
+        compressed.mostPopulousCity = state.mostPopulousCity;
+        [compressed MB_save];
+    }
+    CompressedState *georgia = [CompressedState MB_findWithKey:@"GA"];
+    XCTAssertEqualObjects(georgia.capital, @"Atlanta", @"Compressed state didn't load");
+    
+    // rows saved before compression was turned on still load
+    NSString *documentsDirectory = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) lastObject];
+    FMDatabase *db = [FMDatabase databaseWithPath:[documentsDirectory stringByAppendingPathComponent:@"mamba.db"]];
+    XCTAssertTrue([db open], @"Couldn't open the store directly");
+    NSData *body = [db dataForQuery:@"select objBody from CompressedState where objID = ?",[georgia MB_objID]];
+    XCTAssertTrue([DHMambaCompressor isCompressedData:body], @"Body wasn't compressed");
+    georgia.capital = @"OLD ATLANTA";
+    BOOL replaced = [db executeUpdate:@"update CompressedState set objBody = ? where objID = ?",[DHMambaCoder encodeObject:georgia ignoring:nil],[georgia MB_objID]];
+    XCTAssertTrue(replaced, @"Couldn't replace the body");
+    [db close];
+    
+    CompressedState *loaded = [CompressedState MB_loadWithID:[georgia MB_objID]];
+    XCTAssertEqualObjects(loaded.capital, @"OLD ATLANTA", @"Uncompressed row didn't load");
+    XCTAssertTrue([[CompressedState MB_findAll] count] == [[State MB_countAll] unsignedIntegerValue], @"Should load every compressed state");
+    
+    // a row compressed with another dictionary is skipped, and saving what
+    // did load leaves its body alone
+    NSMutableData *changedDictionary = [[CompressedState mambaObjectCompressionDictionary] mutableCopy];
+    [changedDictionary appendData:[@"changed" dataUsingEncoding:NSUTF8StringEncoding]];
+    NSData *unreadable = [DHMambaCompressor compressData:[DHMambaCoder encodeObject:georgia ignoring:nil] compression:DHMambaCompressionZlib dictionary:changedDictionary];
+    XCTAssertTrue([DHMambaCompressor isCompressedData:unreadable], @"Body wasn't compressed");
+    XCTAssertTrue([db open], @"Couldn't open the store directly");
+    replaced = [db executeUpdate:@"update CompressedState set objBody = ? where objID = ?",unreadable,[georgia MB_objID]];
+    XCTAssertTrue(replaced, @"Couldn't replace the body");
+    
+    XCTAssertNil([CompressedState MB_loadWithID:[georgia MB_objID]], @"Unreadable row shouldn't load");
+    NSArray *readable = [CompressedState MB_findAll];
+    XCTAssertTrue(readable.count == [[State MB_countAll] unsignedIntegerValue] - 1, @"Unreadable row should be left out, but loaded %lu",readable.count);
+    [CompressedState MB_saveAll:readable];
+    body = [db dataForQuery:@"select objBody from CompressedState where objID = ?",[georgia MB_objID]];
+    XCTAssertEqualObjects(body, unreadable, @"Unreadable body was overwritten");
+    [db close];
+}
+
 @end
@@ -9,7 +9,7 @@
 #import <Foundation/Foundation.h>
 #import "NSObject+DHMambaObject.h"
 
-@interface ParentObject : NSObject<DHMambaObjectProperties,DHMambaObjectMethods>
+@interface ParentObject : NSObject<DHMambaObjectProperties>
 
 #pragma mark - Properties
 @property (nonatomic,strong) NSString *parentName;
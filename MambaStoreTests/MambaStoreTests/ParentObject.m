@@ -30,29 +30,8 @@
     return @[@"children"];
 }
 
-#pragma mark - MambaObjectMethods
-- (void)mambaAfterLoad
-{
-    NSArray *childObjects = [ChildObject MB_findWithForeignKey:[self MB_objKey]];
-    for ( ChildObject *child in childObjects ) {
-        [self.children addObject:child];
-    }
-}
-
-- (void)mambaAfterSave
-{
-    for ( ChildObject *child in self.children ) {
-        [child setMambaObjectForeignKey:[self MB_objKey]];
-        [child MB_save];
-    }
++ (NSArray *)mambaObjectRelationships {
+    return @[[DHMambaRelationship relationshipNamed:@"children" childClass:[ChildObject class]]];
 }
 
-- (void)mambaAfterDelete
-{
-    for ( ChildObject *child in self.children ) {
-        [child MB_delete];
-    }
-}
-
-
 @end
@@ -0,0 +1,23 @@
+//
+//  ScalarObject.h
+//  MambaStoreTests
+//
+//  Created by David House on 10/17/26.
+//
+//
+
+#import <Foundation/Foundation.h>
+#import "NSObject+DHMambaObject.h"
+
+@interface ScalarObject : NSObject<DHMambaObjectProperties>
+
+#pragma mark - Properties
+@property (nonatomic,assign) NSInteger count;
+@property (nonatomic,assign) unsigned long long bigCount;
+@property (nonatomic,assign) double ratio;
+@property (nonatomic,assign) float weight;
+@property (nonatomic,assign,getter=isEnabled) BOOL enabled;
+@property (nonatomic,copy) NSString *label;
+@property (nonatomic,strong) NSDate *when;
+
+@end
@@ -0,0 +1,30 @@
+//
+//  ScalarObject.m
+//  MambaStoreTests
+//
+//  Created by David House on 10/17/26.
+//
+//
+
+#import "ScalarObject.h"
+
+@implementation ScalarObject
+
+#pragma mark - Mamba Object Properties
+- (NSString *)mambaObjectKey {
+    return self.label;
+}
+
++ (NSUInteger)mambaObjectCacheLimit {
+    return 10;
+}
+
++ (BOOL)mambaObjectUniqueKey {
+    return YES;
+}
+
++ (BOOL)mambaObjectTracksChanges {
+    return YES;
+}
+
+@end
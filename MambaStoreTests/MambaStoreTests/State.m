@@ -29,6 +29,14 @@
     return [NSNumber numberWithInt:[self.population intValue]];
 }
 
++ (NSArray *)mambaObjectFullTextColumns {
+    return @[@"objKey",@"objTitle"];
+}
+
++ (NSArray *)mambaObjectIndexedProperties {
+    return @[@"capital",@"mostPopulousCity"];
+}
+
 #pragma mark - Public Methods
 + (void)loadTestStates {
     